@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		ClockBenchmark.cpp
+//!
+//! @brief		Measures the per call cost of each timestamp clock policy
+//!				against the Timer singleton the logger used before.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogClock.h"				// Clock policies
+#include	"../CPP_Timer/Timer.h"		// Singleton baseline
+#include	<chrono>					// Timing
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+using Clock = std::chrono::steady_clock;
+
+// Calls read() iterations times, returns nanoseconds per call
+template <typename Read>
+static double Measure(Read read, long iterations)
+{
+	// The sum keeps the compiler from dropping the reads
+	volatile uint64_t sink = 0;
+	uint64_t sum = 0;
+
+	Clock::time_point start = Clock::now();
+	for (long i = 0; i < iterations; i++)
+	{
+		sum += read();
+	}
+	Clock::time_point end = Clock::now();
+
+	sink = sum;
+	(void)sink;
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+template <typename Policy>
+static void Report(long iterations)
+{
+	Policy::Calibrate();
+	double ns = Measure([] { return Policy::NowUSecs(); }, iterations);
+	printf("  %-18s %8.2f ns/call\n", Policy::Name, ns);
+}
+
+int main(int argc, char* argv[])
+{
+	long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+
+	printf("Clock read cost, %ld calls each\n", iterations);
+	Report<LogClockNone>(iterations);
+	Report<LogClockCoarse>(iterations);
+	Report<LogClockSteady>(iterations);
+	Report<LogClockTsc>(iterations);
+
+	double ns = Measure([] { return (uint64_t)Timer::GetInstance()->GetUSecTicks(); }, iterations);
+	printf("  %-18s %8.2f ns/call\n", "Timer singleton", ns);
+
+	printf("Logger built with the %s clock\n", LogClock::Name);
+	return 0;
+}
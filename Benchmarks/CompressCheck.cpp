@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		CompressCheck.cpp
+//!
+//! @brief		Exercises the block codec with generated input: every block
+//!				must decode back to its text, and truncated or corrupted
+//!				blocks must be rejected without writing past the output.
+//!				Prints the seed, so a failing run can be repeated.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogCompress.h"			// Block codec
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// memcmp
+#include	<random>					// Generated input
+#include	<string>					// Strings
+#include	<vector>					// Buffers
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+constexpr size_t GUARD_BYTES = 64;				// Canary past each output buffer
+constexpr char GUARD_FILL = '\x5A';				// Canary value
+
+// Shapes of generated text, each stressing a different part of the format
+enum class SHAPE : const int
+{
+	SHAPE_LINES,				// Log lines, the real workload
+	SHAPE_RANDOM,				// Incompressible bytes, long literal runs
+	SHAPE_RUNS,					// Repeated bytes, overlapping matches
+	SHAPE_TINY,					// Blocks shorter than a match
+	SHAPE_COUNT,
+};
+
+static std::string Generate(SHAPE shape, std::mt19937_64& rng)
+{
+	std::string text;
+	switch (shape)
+	{
+	case SHAPE::SHAPE_LINES:
+	{
+		static const char* const levels[] = { "INFO", "WARN", "ERROR", "DEBUG" };
+		size_t lines = 1 + rng() % 4000;
+		for (size_t i = 0; i < lines && text.size() < LOG_COMPRESS_BLOCK_BYTES; ++i)
+		{
+			text += "12:34:" + std::to_string(rng() % 60) + "." + std::to_string(rng() % 1000) + " - " +
+				levels[rng() % 4] + " - Component" + std::to_string(rng() % 8) + " - request " +
+				std::to_string(rng()) + " took " + std::to_string(rng() % 10000) + " us\n";
+		}
+		break;
+	}
+	case SHAPE::SHAPE_RANDOM:
+	{
+		text.resize(1 + rng() % 70000);
+		for (char& c : text)
+		{
+			c = static_cast<char>(rng());
+		}
+		break;
+	}
+	case SHAPE::SHAPE_RUNS:
+	{
+		size_t length = 1 + rng() % 70000;
+		while (text.size() < length)
+		{
+			text.append(1 + rng() % 600, static_cast<char>('a' + rng() % 3));
+		}
+		break;
+	}
+	default:
+	{
+		text.resize(1 + rng() % 24);
+		for (char& c : text)
+		{
+			c = static_cast<char>('a' + rng() % 2);
+		}
+		break;
+	}
+	}
+	return text;
+}
+
+// Whether the canary behind the first used bytes of a buffer is untouched
+static bool Guarded(const std::vector<char>& buffer, size_t used)
+{
+	for (size_t i = used; i < buffer.size(); ++i)
+	{
+		if (buffer[i] != GUARD_FILL)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Decodes into a buffer with a canary behind it, returns false if the canary was touched
+static bool DecodeGuarded(const std::vector<char>& packed, size_t length, size_t rawBytes, bool& decoded, std::vector<char>& out)
+{
+	out.assign(rawBytes + GUARD_BYTES, GUARD_FILL);
+	decoded = LogDecompressBlock(packed.data(), length, out.data(), rawBytes);
+	return Guarded(out, rawBytes);
+}
+
+int main(int argc, char* argv[])
+{
+	long iterations = argc > 1 ? atol(argv[1]) : 2000;
+	uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : std::random_device()();
+	if (iterations <= 0)
+	{
+		printf("Usage: %s [iterations] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%ld blocks, seed %llu\n", iterations, static_cast<unsigned long long>(seed));
+	std::mt19937_64 rng(seed);
+	std::vector<uint32_t> table(LOG_COMPRESS_HASH_SIZE);
+	std::vector<char> packed;
+	std::vector<char> out;
+	uint64_t failures = 0;
+	uint64_t stored = 0;
+	uint64_t rawTotal = 0;
+	uint64_t packedTotal = 0;
+	uint64_t corruptAccepted = 0;
+
+	for (long i = 0; i < iterations; ++i)
+	{
+		SHAPE shape = static_cast<SHAPE>(i % static_cast<int>(SHAPE::SHAPE_COUNT));
+		std::string text = Generate(shape, rng);
+
+		// The sink gives the encoder only the text's size, a block that does not shrink is stored
+		packed.assign(text.size() + GUARD_BYTES, GUARD_FILL);
+		size_t length = LogCompressBlock(text.data(), text.size(), packed.data(), text.size(), table.data());
+		bool intact = Guarded(packed, text.size());
+		if (length == 0)
+		{
+			stored++;
+			packed.assign(LogCompressBound(text.size()) + GUARD_BYTES, GUARD_FILL);
+			length = LogCompressBlock(text.data(), text.size(), packed.data(), LogCompressBound(text.size()), table.data());
+			intact &= Guarded(packed, LogCompressBound(text.size()));
+		}
+		if (length == 0 || !intact)
+		{
+			printf("block %ld (shape %d, %zu bytes): encoder failed or overran\n", i, static_cast<int>(shape), text.size());
+			failures++;
+			continue;
+		}
+		rawTotal += text.size();
+		packedTotal += length;
+
+		bool decoded = false;
+		if (!DecodeGuarded(packed, length, text.size(), decoded, out) || !decoded || memcmp(out.data(), text.data(), text.size()) != 0)
+		{
+			printf("block %ld (shape %d, %zu bytes): did not decode back to its text\n", i, static_cast<int>(shape), text.size());
+			failures++;
+			continue;
+		}
+
+		// A cut short block always decodes to fewer bytes than recorded
+		size_t cut = rng() % length;
+		if (!DecodeGuarded(packed, cut, text.size(), decoded, out) || decoded)
+		{
+			printf("block %ld (shape %d): truncated to %zu of %zu bytes and %s\n", i, static_cast<int>(shape), cut, length,
+				decoded ? "accepted" : "overran");
+			failures++;
+			continue;
+		}
+
+		// A flipped byte may still decode to some text, but never past the buffer
+		std::vector<char> corrupt(packed.begin(), packed.begin() + length);
+		for (int flips = 1 + static_cast<int>(rng() % 4); flips > 0; --flips)
+		{
+			corrupt[rng() % length] ^= static_cast<char>(1 + rng() % 255);
+		}
+		if (!DecodeGuarded(corrupt, length, text.size(), decoded, out))
+		{
+			printf("block %ld (shape %d): corrupted block overran the output\n", i, static_cast<int>(shape));
+			failures++;
+			continue;
+		}
+		corruptAccepted += decoded ? 1 : 0;
+
+		// The recorded size is corrupt too
+		if (!DecodeGuarded(packed, length, text.size() / 2, decoded, out) || decoded)
+		{
+			printf("block %ld (shape %d): accepted a short recorded size\n", i, static_cast<int>(shape));
+			failures++;
+		}
+	}
+
+	printf("%llu round trips failed, %llu stored as is, ratio %.2f, %llu corrupted blocks still decoded\n",
+		static_cast<unsigned long long>(failures), static_cast<unsigned long long>(stored),
+		(packedTotal > 0) ? static_cast<double>(rawTotal) / packedTotal : 0.0, static_cast<unsigned long long>(corruptAccepted));
+	return (failures == 0) ? 0 : 1;
+}
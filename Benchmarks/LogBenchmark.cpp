@@ -0,0 +1,329 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogBenchmark.cpp
+//!
+//! @brief		End to end logger benchmark - producer throughput, per call
+//!				latency, the cost of a filtered call and time to disk, with
+//!				JSON output to track across versions.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../Log.h"					// Logger
+#include	"../LogFileSink.h"			// Backend selection
+#include	<algorithm>					// Sorting samples
+#include	<chrono>					// Timing
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// Argument compares
+#include	<string>					// Strings
+#include	<thread>					// Producer threads
+#include	<tuple>						// std::tie
+#include	<vector>					// Samples
+#ifndef _WIN32
+#include	<sys/resource.h>			// Page fault counts
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+using Clock = std::chrono::steady_clock;
+
+// Percentiles of a set of samples
+struct Percentiles
+{
+	double		p50;
+	double		p90;
+	double		p99;
+	double		p999;
+	double		max;
+};
+
+// Every figure the run produces
+struct Results
+{
+	size_t		entries;
+	int			threads;
+	double		singleQueued;			// Entries/s handed to the logger by one thread
+	double		singleWritten;			// Entries/s including the writer catching up
+	double		multiQueued;			// Entries/s handed to the logger by all threads
+	double		multiWritten;			// Entries/s including the writer catching up
+	long		steadyFaults;			// Minor page faults over a run once the logger is warm, -1 if unknown
+	Percentiles	latencyNs;				// AddEntry call time
+	double		disabledNs;				// Filtered AddEntry call
+	double		disabledComponentNs;	// Filtered component AddEntry call
+	Percentiles	diskUs;					// AddEntry to WaitDurable returning
+	size_t		diskSamples;
+};
+
+static Percentiles Summarize(std::vector<double>& samples)
+{
+	Percentiles result = {};
+	if (samples.empty())
+	{
+		return result;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto at = [&](double fraction) { return samples[static_cast<size_t>(fraction * (samples.size() - 1))]; };
+	result.p50 = at(0.50);
+	result.p90 = at(0.90);
+	result.p99 = at(0.99);
+	result.p999 = at(0.999);
+	result.max = samples.back();
+	return result;
+}
+
+static double Seconds(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double>(end - start).count();
+}
+
+// Producers log entries/threads each, returns {queued/s, written/s}
+static std::pair<double, double> Throughput(Log* log, size_t entries, int threads)
+{
+	std::vector<std::thread> producers;
+	size_t each = entries / threads;
+
+	Clock::time_point start = Clock::now();
+	for (int t = 0; t < threads; ++t)
+	{
+		producers.emplace_back([log, each, t]
+		{
+			for (size_t i = 0; i < each; ++i)
+			{
+				log->AddEntry(LOG_LEVEL::LOG_INFO, "Bench", "producer %d entry %zu with a typical amount of message text", t, i);
+			}
+		});
+	}
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+	Clock::time_point queued = Clock::now();
+	log->Flush();
+	Clock::time_point written = Clock::now();
+
+	double total = static_cast<double>(each * threads);
+	return { total / Seconds(start, queued), total / Seconds(start, written) };
+}
+
+// Minor page faults taken by the process so far, -1 where the count is unavailable
+static long MinorFaults()
+{
+#ifdef _WIN32
+	return -1;
+#else
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt;
+#endif
+}
+
+// Backend for a -b name, false if the name is not one of them
+static bool ParseBackend(const char* name, LOG_BACKEND& backend)
+{
+	static const std::pair<const char*, LOG_BACKEND> names[] =
+	{
+		{ "stream", LOG_BACKEND::LOG_BACKEND_STREAM },
+		{ "fd", LOG_BACKEND::LOG_BACKEND_FD },
+		{ "uring", LOG_BACKEND::LOG_BACKEND_IO_URING },
+		{ "direct", LOG_BACKEND::LOG_BACKEND_IO_URING_DIRECT },
+		{ "mmap", LOG_BACKEND::LOG_BACKEND_MMAP },
+		{ "lzb", LOG_BACKEND::LOG_BACKEND_COMPRESSED },
+	};
+
+	for (const auto& entry : names)
+	{
+		if (strcmp(name, entry.first) == 0)
+		{
+			backend = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void PrintPercentiles(const char* name, const Percentiles& p, const char* unit)
+{
+	printf("  %-22s p50 %9.1f  p90 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f %s\n", name, p.p50, p.p90, p.p99, p.p999, p.max, unit);
+}
+
+static void WriteJson(FILE* out, const Results& r, const char* backend)
+{
+	auto percentiles = [out](const char* name, const Percentiles& p, const char* tail)
+	{
+		fprintf(out, "  \"%s\": { \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f }%s\n",
+			name, p.p50, p.p90, p.p99, p.p999, p.max, tail);
+	};
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"schema\": 1,\n");
+	fprintf(out, "  \"clock\": \"%s\",\n", LogClock::Name);
+	fprintf(out, "  \"backend\": \"%s\",\n", backend);
+	fprintf(out, "  \"entries\": %zu,\n", r.entries);
+	fprintf(out, "  \"threads\": %d,\n", r.threads);
+	fprintf(out, "  \"single_producer\": { \"queued_per_sec\": %.0f, \"written_per_sec\": %.0f },\n", r.singleQueued, r.singleWritten);
+	fprintf(out, "  \"multi_producer\": { \"queued_per_sec\": %.0f, \"written_per_sec\": %.0f },\n", r.multiQueued, r.multiWritten);
+	fprintf(out, "  \"steady_state_minor_faults\": %ld,\n", r.steadyFaults);
+	percentiles("call_latency_ns", r.latencyNs, ",");
+	fprintf(out, "  \"disabled_level_ns\": { \"string\": %.2f, \"component\": %.2f },\n", r.disabledNs, r.disabledComponentNs);
+	fprintf(out, "  \"time_to_disk_samples\": %zu,\n", r.diskSamples);
+	percentiles("time_to_disk_us", r.diskUs, "");
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	Results results = {};
+	results.entries = 1000000;
+	results.threads = 4;
+	results.diskSamples = 200;
+	std::string directory = "./BenchmarkOutput";
+	const char* jsonPath = nullptr;
+	const char* backendName = "stream";
+	LOG_BACKEND backend = LOG_BACKEND::LOG_BACKEND_STREAM;
+
+	bool usage = false;
+	for (int arg = 1; arg < argc && !usage; ++arg)
+	{
+		bool hasValue = arg + 1 < argc;
+		if (strcmp(argv[arg], "-n") == 0 && hasValue)
+		{
+			results.entries = strtoull(argv[++arg], nullptr, 10);
+		}
+		else if (strcmp(argv[arg], "-t") == 0 && hasValue)
+		{
+			results.threads = atoi(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "-d") == 0 && hasValue)
+		{
+			results.diskSamples = strtoull(argv[++arg], nullptr, 10);
+		}
+		else if (strcmp(argv[arg], "-o") == 0 && hasValue)
+		{
+			directory = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "-j") == 0 && hasValue)
+		{
+			jsonPath = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "-b") == 0 && hasValue)
+		{
+			// An unknown name would run one backend while the results name another
+			backendName = argv[++arg];
+			usage = !ParseBackend(backendName, backend);
+		}
+		else
+		{
+			usage = true;
+		}
+	}
+
+	if (usage)
+	{
+		printf("Usage: %s [-n entries] [-t threads] [-d disk samples] [-b stream|fd|uring|direct|mmap|lzb] [-o directory] [-j json file|-]\n", argv[0]);
+		return 1;
+	}
+	results.threads = std::max(1, results.threads);
+
+	Log* log = Log::GetInstance();
+	log->SetFileBackend(backend);
+	if (log->Initialize(directory + "/bench", false, true) != 1)
+	{
+		printf("Failed to initialize the logger in %s\n", directory.c_str());
+		return 1;
+	}
+	log->SetFileLogLevel(LOG_LEVEL::LOG_INFO);
+
+	// Throughput - the written rate includes waiting for the writer to drain
+	std::tie(results.singleQueued, results.singleWritten) = Throughput(log, results.entries, 1);
+	std::tie(results.multiQueued, results.multiWritten) = Throughput(log, results.entries, results.threads);
+
+	// Page faults once warm - pool blocks and queues are already faulted in, so this should stay near zero
+	{
+		long before = MinorFaults();
+		Throughput(log, results.entries, results.threads);
+		results.steadyFaults = (before < 0) ? -1 : MinorFaults() - before;
+	}
+
+	// Per call latency, each call timed on its own
+	{
+		size_t calls = std::min<size_t>(results.entries, 200000);
+		std::vector<double> samples;
+		samples.reserve(calls);
+		for (size_t i = 0; i < calls; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			log->AddEntry(LOG_LEVEL::LOG_INFO, "Bench", "latency entry %zu with a typical amount of message text", i);
+			samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+		}
+		results.latencyNs = Summarize(samples);
+		log->Flush();
+	}
+
+	// A call below the file level - the cost every disabled DEBUG statement pays
+	{
+		LOG_COMPONENT component = log->RegisterComponent("BenchComponent");
+		size_t calls = results.entries * 10;
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < calls; ++i)
+		{
+			log->AddEntry(LOG_LEVEL::LOG_DEBUG, "Bench", "disabled entry %zu", i);
+		}
+		results.disabledNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+
+		start = Clock::now();
+		for (size_t i = 0; i < calls; ++i)
+		{
+			log->AddEntry(component, LOG_LEVEL::LOG_DEBUG, "disabled entry %zu", i);
+		}
+		results.disabledComponentNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+	}
+
+	// Time to disk - from the call until the entry is synced
+	{
+		std::vector<double> samples;
+		for (size_t i = 0; i < results.diskSamples; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			log->AddEntry(LOG_LEVEL::LOG_ERROR, "Bench", "durable entry %zu", i);
+			log->WaitDurable(Log::LastEntrySequence());
+			samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		}
+		results.diskUs = Summarize(samples);
+	}
+
+	Log::ReleaseInstance();
+
+	printf("Logger benchmark, %s backend, %s clock\n", backendName, LogClock::Name);
+	printf("  %-22s %12.0f queued/s %12.0f written/s\n", "1 producer", results.singleQueued, results.singleWritten);
+	printf("  %d %-20s %12.0f queued/s %12.0f written/s\n", results.threads, "producers", results.multiQueued, results.multiWritten);
+	printf("  %-22s %12ld minor faults\n", "steady state", results.steadyFaults);
+	PrintPercentiles("call latency", results.latencyNs, "ns");
+	printf("  %-22s %9.2f ns string API, %9.2f ns component API\n", "disabled level", results.disabledNs, results.disabledComponentNs);
+	PrintPercentiles("time to disk", results.diskUs, "us");
+
+	if (jsonPath != nullptr)
+	{
+		FILE* out = (strcmp(jsonPath, "-") == 0) ? stdout : fopen(jsonPath, "w");
+		if (out == nullptr)
+		{
+			printf("Failed to write %s\n", jsonPath);
+			return 1;
+		}
+		WriteJson(out, results, backendName);
+		if (out != stdout)
+		{
+			fclose(out);
+		}
+	}
+	return 0;
+}
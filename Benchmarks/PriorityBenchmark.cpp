@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		PriorityBenchmark.cpp
+//! 
+//! @brief		Measures how long ERROR entries take to reach the file and the 
+//!				disk while other threads flood the logger with DEBUG entries,
+//!				with and without the priority lanes.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../Log.h"					// Logger
+#include	"../LogSink.h"				// Probe sink
+#include	<algorithm>					// Sorting samples
+#include	<atomic>					// Flood stop flag
+#include	<chrono>					// Timing
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+#include	<map>						// Samples by sequence
+#include	<mutex>						// Sample hand off
+#include	<thread>					// Flood threads
+#include	<vector>					// Samples
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+using Clock = std::chrono::steady_clock;
+
+// Send, written and synced times of each ERROR entry, keyed by sequence
+struct ErrorSample
+{
+	Clock::time_point	sent;
+	Clock::time_point	written;
+	Clock::time_point	synced;
+};
+
+static std::mutex gSampleMutex;
+static std::map<uint64_t, ErrorSample> gSamples;
+
+// Sink fed by the writer right after the log file, stamping ERROR entries as they pass
+class ProbeSink : public LogSink
+{
+public:
+	void Write(const std::vector<LogEntry>& batch) override
+	{
+		Clock::time_point now = Clock::now();
+		std::lock_guard<std::mutex> lock(gSampleMutex);
+		for (const LogEntry& entry : batch)
+		{
+			if (entry.level == LOG_LEVEL::LOG_ERROR)
+			{
+				gSamples[entry.seq].written = now;
+				mUnsynced.push_back(entry.seq);
+			}
+		}
+	}
+
+	void Sync() override
+	{
+		Clock::time_point now = Clock::now();
+		std::lock_guard<std::mutex> lock(gSampleMutex);
+		for (uint64_t seq : mUnsynced)
+		{
+			gSamples[seq].synced = now;
+		}
+		mUnsynced.clear();
+	}
+
+private:
+	std::vector<uint64_t> mUnsynced;
+};
+
+// Prints the 50th, 99th percentile and max of a set of microsecond samples
+static void PrintPercentiles(const char* name, std::vector<double>& samples)
+{
+	if (samples.empty())
+	{
+		printf("  %-14s no samples\n", name);
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	printf("  %-14s p50 %10.1f us   p99 %10.1f us   max %10.1f us\n", name,
+		samples[samples.size() / 2], samples[samples.size() * 99 / 100], samples.back());
+}
+
+static void Run(bool lanes, int floodThreads, int floodMSecs)
+{
+	gSamples.clear();
+
+	Log* log = Log::GetInstance();
+	log->SetPriorityLanes(lanes);
+	log->SetFileLogLevel(LOG_LEVEL::LOG_DEBUG);
+	log->Initialize("PriorityBenchmark/flood", false, true);
+	log->AddSink(new ProbeSink);
+
+	std::atomic<bool> flooding(true);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < floodThreads; ++t)
+	{
+		threads.emplace_back([&, t]
+		{
+			uint64_t count = 0;
+			while (flooding.load(std::memory_order_relaxed))
+			{
+				log->AddEntry(LOG_LEVEL::LOG_DEBUG, "Flood", "thread %d debug entry %llu with some padding text", t, (unsigned long long)count++);
+			}
+		});
+	}
+
+	// One ERROR every 5 msecs while the flood runs
+	Clock::time_point end = Clock::now() + std::chrono::milliseconds(floodMSecs);
+	while (Clock::now() < end)
+	{
+		Clock::time_point sent = Clock::now();
+		log->AddEntry(LOG_LEVEL::LOG_ERROR, "Probe", "error entry");
+		{
+			std::lock_guard<std::mutex> lock(gSampleMutex);
+			gSamples[Log::LastEntrySequence()].sent = sent;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	flooding = false;
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	Log::ReleaseInstance();
+
+	std::vector<double> written;
+	std::vector<double> synced;
+	for (const auto& sample : gSamples)
+	{
+		if (sample.second.written >= sample.second.sent)
+		{
+			written.push_back(std::chrono::duration<double, std::micro>(sample.second.written - sample.second.sent).count());
+		}
+		if (sample.second.synced >= sample.second.sent)
+		{
+			synced.push_back(std::chrono::duration<double, std::micro>(sample.second.synced - sample.second.sent).count());
+		}
+	}
+
+	printf("%s, %d DEBUG flood threads, %zu ERROR entries\n", lanes ? "Priority lanes" : "Single queue", floodThreads, gSamples.size());
+	PrintPercentiles("time to write", written);
+	PrintPercentiles("time to disk", synced);
+}
+
+int main(int argc, char* argv[])
+{
+	int floodThreads = argc > 1 ? atoi(argv[1]) : 4;
+	int floodMSecs = argc > 2 ? atoi(argv[2]) : 2000;
+
+	Run(false, floodThreads, floodMSecs);
+	Run(true, floodThreads, floodMSecs);
+	return 0;
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		SocketBenchmark.cpp
+//!
+//! @brief		Runs the socket sink against the stand-in listener on every
+//!				transport. The listener goes down part way through, so each
+//!				run covers batching, the reconnect backoff and the replay of
+//!				the spill file, and reports whether every entry arrived once
+//!				and in order.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogSocketSink.h"		// Socket sink
+#include	"../Tools/LogListener.h"	// Stand-in listener
+#include	<atomic>					// Listener thread control
+#include	<chrono>					// Timing
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+#include	<string>					// Strings
+#include	<thread>					// Listener thread
+#include	<vector>					// Batches
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+constexpr uint16_t BENCH_PORT = 47391;				// Loopback port for TCP and UDP
+constexpr uint32_t OUTAGE_MSECS = 500;				// How long the listener stays down
+constexpr uint32_t BATCH_GAP_USECS = 200;			// Pause between batches, so the outage spans many
+
+// Sends the batches through one transport with an outage in the middle, then prints what arrived
+static bool RunTransport(const char* name, LOG_SOCKET type, const std::string& address, size_t lines, size_t batchSize)
+{
+	std::string spillPath = std::string("SocketBenchmark_") + name + ".spill";
+	remove(spillPath.c_str());
+
+	LogListener listener(type, address, BENCH_PORT, true);
+	if (!listener.Open())
+	{
+		printf("%-10s could not listen\n", name);
+		return false;
+	}
+
+	// The listener drains on its own thread and goes down when asked
+	std::atomic<bool> outage(false);
+	std::atomic<bool> done(false);
+	std::atomic<bool> reopened(false);
+	std::atomic<uint64_t> lastSeq(0);
+	std::thread agent([&]
+	{
+		while (!done || listener.Poll(0, nullptr) > 0)
+		{
+			listener.Poll(10, nullptr);
+			lastSeq = listener.Counts().lastSeq;
+			if (outage.exchange(false))
+			{
+				listener.Close();
+				std::this_thread::sleep_for(std::chrono::milliseconds(OUTAGE_MSECS));
+				listener.Open();
+				reopened = true;
+			}
+		}
+	});
+
+	LogSocketSink sink(type, address, BENCH_PORT, LOG_FRAME::LOG_FRAME_BINARY, spillPath);
+	std::vector<LogEntry> batch;
+	batch.reserve(batchSize);
+	uint64_t batches = 0;
+	uint64_t seq = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (seq < lines)
+	{
+		for (size_t i = 0; i < batchSize && seq < lines; ++i)
+		{
+			++seq;
+			batch.push_back(LogEntry{ seq, LOG_LEVEL::LOG_INFO, "12:34:56.789 - Benchmark - Entry " + std::to_string(seq) + " with a typical amount of message text" });
+		}
+		sink.Write(batch);
+		batch.clear();
+		batches++;
+
+		if (seq >= lines / 3 && seq - batchSize < lines / 3)
+		{
+			outage = true;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(BATCH_GAP_USECS));
+	}
+
+	// Entries still spilled go out with the next batch once the backoff allows a reconnect
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (std::chrono::steady_clock::now() < deadline && (!reopened || lastSeq < seq))
+	{
+		++seq;
+		batch.push_back(LogEntry{ seq, LOG_LEVEL::LOG_INFO, "12:34:56.789 - Benchmark - Final entry " + std::to_string(seq) });
+		sink.Write(batch);
+		batch.clear();
+		batches++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	sink.Close();
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	done = true;
+	agent.join();
+
+	// Datagrams sent into a closed UDP port are lost without an error, every other transport spills them
+	const LogListenCounts& counts = listener.Counts();
+	bool lossless = (type != LOG_SOCKET::LOG_SOCKET_UDP);
+	bool ok = counts.outOfOrder == 0 && counts.lastSeq == seq && (!lossless || (counts.gaps == 0 && counts.entries == seq));
+	printf("%-10s %8llu sent %8llu received %7.1f per read %4llu connections %6llu missing %4llu out of order %4llu dropped %8.0f entries/s  %s\n",
+		name, static_cast<unsigned long long>(seq), static_cast<unsigned long long>(counts.entries),
+		(counts.reads > 0) ? static_cast<double>(counts.entries) / counts.reads : 0.0,
+		static_cast<unsigned long long>(counts.connections), static_cast<unsigned long long>(counts.gaps),
+		static_cast<unsigned long long>(counts.outOfOrder), static_cast<unsigned long long>(sink.Dropped()),
+		seq / seconds, ok ? "ok" : "FAILED");
+	remove(spillPath.c_str());
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t lines = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	size_t batchSize = argc > 2 ? strtoull(argv[2], nullptr, 10) : 64;
+	if (lines == 0 || batchSize == 0)
+	{
+		printf("Usage: %s [lines] [batch size]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%zu lines, %zu per batch, listener down for %u ms after a third\n", lines, batchSize, OUTAGE_MSECS);
+	bool ok = true;
+	ok &= RunTransport("unix", LOG_SOCKET::LOG_SOCKET_UNIX, "SocketBenchmark.sock", lines, batchSize);
+	ok &= RunTransport("unix-dgram", LOG_SOCKET::LOG_SOCKET_UNIX_DGRAM, "SocketBenchmark.dgram", lines, batchSize);
+	ok &= RunTransport("tcp", LOG_SOCKET::LOG_SOCKET_TCP, "127.0.0.1", lines, batchSize);
+	ok &= RunTransport("udp", LOG_SOCKET::LOG_SOCKET_UDP, "127.0.0.1", lines, batchSize);
+	return ok ? 0 : 1;
+}
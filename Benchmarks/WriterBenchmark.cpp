@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		WriterBenchmark.cpp
+//! 
+//! @brief		Compares the log file backends by writing the same batches 
+//!				through each and timing them.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogFileSink.h"			// File backends
+#include	<cstdio>					// Results
+#include	<cstdlib>					// Arguments
+#include	<chrono>					// Timing
+#include	<fstream>					// Output file size
+#include	<memory>					// Sink ownership
+#include	<string>					// Strings
+#include	<vector>					// Batches
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+// Writes every batch through one backend, including the final flush, and prints the rates
+static void RunBackend(const char* name, LOG_BACKEND backend, const std::string& path,
+	const std::vector<std::vector<LogEntry>>& batches, size_t lines, size_t bytes, int compressThreads = LOG_COMPRESS_THREADS)
+{
+	std::unique_ptr<LogSink> sink(CreateFileSink(backend, path, compressThreads));
+	if (!sink->IsOpen())
+	{
+		printf("%-8s failed to create %s\n", name, path.c_str());
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (const std::vector<LogEntry>& batch : batches)
+	{
+		sink->Write(batch);
+	}
+	sink->Flush();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	sink->Close();
+
+	std::ifstream written(path, std::ios::binary | std::ios::ate);
+	double fileBytes = written.is_open() ? static_cast<double>(written.tellg()) : 0.0;
+	written.close();
+
+	printf("%-8s %10.1f MB/s %12.0f lines/s %8.2fx smaller\n", name,
+		bytes / seconds / (1024.0 * 1024.0), lines / seconds, (fileBytes > 0) ? bytes / fileBytes : 0.0);
+	remove(path.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+	size_t lines = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	size_t batchSize = argc > 2 ? strtoull(argv[2], nullptr, 10) : 256;
+	if (lines == 0 || batchSize == 0)
+	{
+		printf("Usage: %s [lines] [batch size]\n", argv[0]);
+		return 1;
+	}
+
+	// Entries shaped like the logger's own lines, built up front so only the writes are timed
+	std::vector<std::vector<LogEntry>> batches;
+	size_t bytes = 0;
+	for (size_t i = 0; i < lines; ++i)
+	{
+		if (i % batchSize == 0)
+		{
+			batches.emplace_back();
+			batches.back().reserve(batchSize);
+		}
+
+		std::string text = "12:34:56.789 - Benchmark - Entry " + std::to_string(i) + " with a typical amount of message text";
+		bytes += text.size() + 1;
+		batches.back().push_back(LogEntry{ i + 1, LOG_LEVEL::LOG_INFO, text });
+	}
+
+	printf("%zu lines, %zu per batch, %.1f MB\n", lines, batchSize, bytes / (1024.0 * 1024.0));
+	RunBackend("ofstream", LOG_BACKEND::LOG_BACKEND_STREAM, "WriterBenchmark_stream.txt", batches, lines, bytes);
+	RunBackend("fd", LOG_BACKEND::LOG_BACKEND_FD, "WriterBenchmark_fd.txt", batches, lines, bytes);
+	RunBackend("uring", LOG_BACKEND::LOG_BACKEND_IO_URING, "WriterBenchmark_uring.txt", batches, lines, bytes);
+	RunBackend("mmap", LOG_BACKEND::LOG_BACKEND_MMAP, "WriterBenchmark_mmap.txt", batches, lines, bytes);
+	RunBackend("direct", LOG_BACKEND::LOG_BACKEND_IO_URING_DIRECT, "WriterBenchmark_direct.txt", batches, lines, bytes);
+	RunBackend("lzb", LOG_BACKEND::LOG_BACKEND_COMPRESSED, "WriterBenchmark_lzb.txt.lzb", batches, lines, bytes);
+	RunBackend("lzb/0", LOG_BACKEND::LOG_BACKEND_COMPRESSED, "WriterBenchmark_lzb0.txt.lzb", batches, lines, bytes, 0);
+	return 0;
+}
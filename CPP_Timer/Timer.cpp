@@ -24,6 +24,7 @@ namespace Essentials
 {
 	// Initialize static class variables.
 	Timer* Timer::mInstance = NULL;
+	Timer* Timer::mForking = NULL;
 
 	Timer* Timer::GetInstance()
 	{
@@ -55,7 +56,7 @@ namespace Essentials
 		uint32_t now;
 		bool firstTime;
 
-		if (firstTime = !mInitialzied)
+		if ((firstTime = !mInitialzied))
 		{
 			Initialize();
 		}
@@ -74,12 +75,12 @@ namespace Essentials
 
 				if (elapsed < 0)
 				{
-					tickOffset += elapsed;
+					mTickOffset += elapsed;
 #ifdef USE_STDIO
 					printf("System time went backwards %d msec\n", -elapsed);
 #else
 					Log* mLog = Log::GetInstance();
-					mLog->AddEntry(LOG_WARN, mUser, "System time went backwards %d msec", -elapsed);
+					mLog->AddEntry(LOG_LEVEL::LOG_WARN, mUser, "System time went backwards %d msec", -elapsed);
 #endif // USE_STDIO
 				}
 			}
@@ -100,7 +101,7 @@ namespace Essentials
 		// Catch not initialized
 		if (!mInitialzied)
 		{
-			int time = GetMSecTicks();
+			GetMSecTicks();
 		}
 
 #if defined _WIN32
@@ -111,7 +112,7 @@ namespace Essentials
 		struct timeval tv;
 		gettimeofday(&tv, NULL);
 
-		unit64_t uSecs = tv.tv_sec * 1000000 + tv.tv_usec;
+		uint64_t uSecs = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 		return (uSecs & 0xffffffff);
 #endif
 	}
@@ -134,6 +135,32 @@ namespace Essentials
 #endif
 	}
 
+	TIMER_HANDLE Timer::Schedule(uint32_t delayMSecs, uint32_t periodMSecs, std::function<void()> callback)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWheelMutex);
+			if (mWheel == nullptr)
+			{
+				mWheel = new TimerWheel;
+			}
+		}
+
+		return mWheel->Schedule(delayMSecs, periodMSecs, std::move(callback));
+	}
+
+	bool Timer::Cancel(TIMER_HANDLE handle)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWheelMutex);
+			if (mWheel == nullptr)
+			{
+				return false;
+			}
+		}
+
+		return mWheel->Cancel(handle);
+	}
+
 	Timer::Timer() 
 	{
 		mInitialzied = false;
@@ -145,23 +172,39 @@ namespace Essentials
 		mTimerFactor = 0;
 		mInstance = NULL;
 		mThread = nullptr;
+		mWheel = nullptr;
 		mUser = "";
+
+		// Keep scheduling working in forked children, registered once per process
+		static std::once_flag hooks;
+		std::call_once(hooks, []
+		{
+#ifndef _WIN32
+			pthread_atfork(&Timer::PrepareFork, &Timer::AfterForkParent, &Timer::AfterForkChild);
+#endif
+		});
 	}
 
 	Timer::~Timer()
 	{
 		// Notify close and wait for thread
 #ifdef USE_STDIO
-		printf_s("Timer Closing.\n");
+		printf("Timer Closing.\n");
 #else
 		Log* mLog = Log::GetInstance();
 		mLog->AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Closing.");
 #endif // USE_STDIO
 
+		// Scheduled callbacks never run once the wheel is gone
+		delete mWheel;
+
 		mInitialzied = false;
 		mClosing = true;
-		mThread->join();
-		delete mThread;
+		if (mThread != nullptr)
+		{
+			mThread->join();
+			delete mThread;
+		}
 	}
 
 	void Timer::Initialize()
@@ -196,6 +239,7 @@ namespace Essentials
 			Fatal("Failed to start timer thread!");
 		}
 
+#ifdef _WIN32
 		// Set thread to time critical
 		if (!SetThreadPriority(mThread->native_handle(), THREAD_PRIORITY_TIME_CRITICAL))
 		{
@@ -207,6 +251,7 @@ namespace Essentials
 		{
 			Fatal("Failed to resume timer thread");
 		}
+#endif
 
 		// Wait for timer thread to become ready
 		while (!mTimerThreadReady)
@@ -265,15 +310,71 @@ namespace Essentials
 			}
 		}
 #else
+		// gettimeofday is read directly, there is no tick to keep
+		mTimerThreadReady = true;
 #endif
 
 		return 0;
 	}
 
+	void Timer::PrepareFork()
+	{
+		// Callbacks run without the wheel lock, so holding it never waits on a callback's locks
+		mForking = mInstance;
+		if (mForking != NULL)
+		{
+			mForking->mWheelMutex.lock();
+			if (mForking->mWheel != nullptr)
+			{
+				mForking->mWheel->Lock();
+			}
+		}
+	}
+
+	void Timer::AfterForkParent()
+	{
+		if (mForking != NULL)
+		{
+			if (mForking->mWheel != nullptr)
+			{
+				mForking->mWheel->Unlock();
+			}
+			mForking->mWheelMutex.unlock();
+		}
+		mForking = NULL;
+	}
+
+	void Timer::AfterForkChild()
+	{
+		Timer* timer = mForking;
+		mForking = NULL;
+		if (timer == NULL)
+		{
+			return;
+		}
+
+		// Only the forking thread exists here. The old wheel and thread objects belong to threads
+		// that stayed in the parent, so they are left alone rather than joined or destroyed.
+		if (timer->mWheel != nullptr)
+		{
+			timer->mWheel = timer->mWheel->ForkChild();
+		}
+		if (timer->mThread != nullptr)
+		{
+			timer->mTimerThreadReady = false;
+			timer->mThread = new std::thread(&Timer::HandleTrueMSec, timer);
+			while (!timer->mTimerThreadReady)
+			{
+				timer->MSecSleep(1);
+			}
+		}
+		timer->mWheelMutex.unlock();
+	}
+
 	void Timer::Fatal(std::string msg)
 	{
 #ifdef USE_STDIO
-		fprintf_s(stderr, "%s\n", msg.c_str());
+		fprintf(stderr, "%s\n", msg.c_str());
 #else
 		Log* mLog = Log::GetInstance();
 		mLog->AddEntry(LOG_LEVEL::LOG_ERROR, mUser, "Fatal Error: %s", msg.c_str());
@@ -15,19 +15,22 @@
 //  Includes:
 //          name                        reason included
 //          --------------------        ---------------------------------------
-#pragma comment(lib, "Winmm.lib")		
 #ifdef _WIN32
+#pragma comment(lib, "Winmm.lib")		// Multimedia timer
 #include <iostream>						// IO stream
 #include <windows.h>					// Windows 
 #else
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>					// pthread_atfork
 #endif
 //
 #include <stdint.h>						// Standard integer types
 #include <string>						// Strings
 #include <thread>						// Threading
+#include <mutex>						// Timer wheel creation
+#include "TimerWheel.h"					// Scheduled callbacks
 #include "../Log.h"						// Logging
 //
 // 
@@ -74,6 +77,18 @@ namespace Essentials
 		//! @brief Microseconds sleep command
 		void			USecSleep(const uint32_t uSecs);
 
+		//! @brief Runs a callback on the shared timer thread after a delay, optionally repeating.
+		//! @param delayMSecs - milliseconds until the first call.
+		//! @param periodMSecs - milliseconds between later calls, 0 for a one shot.
+		//! @param callback - function to call, keep it short - it delays every other timer.
+		//! @return handle to cancel with
+		TIMER_HANDLE	Schedule(uint32_t delayMSecs, uint32_t periodMSecs, std::function<void()> callback);
+
+		//! @brief Cancels a scheduled callback, waiting for it if it is running on another thread.
+		//! @param handle - handle from Schedule.
+		//! @return false if the handle already fired or was cancelled, true if cancelled
+		bool			Cancel(TIMER_HANDLE handle);
+
 	protected:
 	private:
 		//<! FUNCTIONS
@@ -89,6 +104,12 @@ namespace Essentials
 		//! @brief Error output
 		void			Fatal(std::string msg);
 
+		//! @brief pthread_atfork() handlers - the wheel is held still across fork, and the child
+		//!		   gets a new wheel and thread since the timer threads stay in the parent.
+		static void		PrepareFork();
+		static void		AfterForkParent();
+		static void		AfterForkChild();
+
 		//!< VARIABLES
 		bool			mInitialzied;				// Track if initialized
 		bool			mClosing;					// Track if closing.
@@ -98,7 +119,10 @@ namespace Essentials
 		volatile uint32_t	mTickCount;				// Tick count
 		double			mTimerFactor;				// Timer factor
 		static Timer*	mInstance;					// Instance of Logger
+		static Timer*	mForking;					// Instance locked by PrepareFork
 		std::thread*	mThread;					// Pointer to a thread object
+		TimerWheel*		mWheel;						// Scheduled callbacks, created on first use
+		std::mutex		mWheelMutex;				// Protects the wheel creation
 		std::string		mUser;						// System User for Log information location 
 	};
 }
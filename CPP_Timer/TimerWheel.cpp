@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		TimerWheel.cpp
+//!
+//! @brief		Implementation of the hashed hierarchical timer wheel. Level n
+//!				holds timers due within 256^(n+1) ticks, hashed by bits 8n..8n+7
+//!				of their expiry; a higher level slot is moved down whenever the
+//!				level below it wraps.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 1 / 12 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"TimerWheel.h"				// Timer wheel class header
+#include	<cstring>					// memset
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// End of a slot or free list
+	static constexpr uint32_t TIMER_NIL = 0xFFFFFFFF;
+
+	TimerWheel::TimerWheel()
+	{
+		mFree = TIMER_NIL;
+		mTick = 0;
+		mWakeTick = UINT64_MAX;
+		mCount = 0;
+		mStopping = false;
+		mStart = std::chrono::steady_clock::now();
+		memset(mSlots, 0xFF, sizeof(mSlots));
+		memset(mOccupied, 0, sizeof(mOccupied));
+		mThread = new std::thread(&TimerWheel::Run, this);
+	}
+
+	TimerWheel::~TimerWheel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mCv.notify_one();
+		mThread->join();
+		delete mThread;
+	}
+
+	TIMER_HANDLE TimerWheel::Schedule(uint32_t delayMSecs, uint32_t periodMSecs, std::function<void()> callback)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		uint32_t index = mFree;
+		if (index != TIMER_NIL)
+		{
+			mFree = mNodes[index].next;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(mNodes.size());
+			mNodes.emplace_back();
+			mNodes[index].generation = 1;
+		}
+
+		// Never due before the next tick, the current one may already be processed
+		TimerNode& node = mNodes[index];
+		uint64_t expires = NowTicks() + delayMSecs;
+		node.expires = (expires > mTick) ? expires : mTick + 1;
+		node.period = periodMSecs;
+		node.state = TIMER_STATE::TIMER_PENDING;
+		node.callback = std::move(callback);
+		Insert(index);
+		++mCount;
+
+		TIMER_HANDLE handle = (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+		bool wake = node.expires < mWakeTick;
+		lock.unlock();
+
+		// Only disturb the timer thread if it would sleep past this timer
+		if (wake)
+		{
+			mCv.notify_one();
+		}
+		return handle;
+	}
+
+	bool TimerWheel::Cancel(TIMER_HANDLE handle)
+	{
+		uint32_t index = static_cast<uint32_t>(handle & 0xFFFFFFFF) - 1;
+		uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (handle == TIMER_INVALID_HANDLE || index >= mNodes.size() || mNodes[index].generation != generation)
+		{
+			return false;
+		}
+
+		TimerNode& node = mNodes[index];
+		if (node.state == TIMER_STATE::TIMER_PENDING)
+		{
+			Unlink(index);
+			Release(index);
+			--mCount;
+			return true;
+		}
+
+		if (node.state != TIMER_STATE::TIMER_RUNNING)
+		{
+			return false;
+		}
+
+		// The timer thread frees it once the call returns - wait for that unless this is the call
+		node.state = TIMER_STATE::TIMER_CANCELLED;
+		if (std::this_thread::get_id() != mThread->get_id())
+		{
+			mDoneCv.wait(lock, [this, index, generation] { return mNodes[index].generation != generation; });
+		}
+		return true;
+	}
+
+	size_t TimerWheel::Pending()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mCount;
+	}
+
+	TimerWheel* TimerWheel::ForkChild() const
+	{
+		// Every pooled timer starts free one generation on, so a handle kept from the parent misses
+		TimerWheel* wheel = new TimerWheel;
+		std::lock_guard<std::mutex> lock(wheel->mMutex);
+		wheel->mNodes.resize(mNodes.size());
+		for (uint32_t index = static_cast<uint32_t>(mNodes.size()); index-- > 0;)
+		{
+			TimerNode& node = wheel->mNodes[index];
+			node.generation = mNodes[index].generation + 1;
+			if (node.generation == 0)
+			{
+				node.generation = 1;
+			}
+			node.state = TIMER_STATE::TIMER_FREE;
+			node.next = wheel->mFree;
+			wheel->mFree = index;
+		}
+		return wheel;
+	}
+
+	void TimerWheel::Run()
+	{
+		std::vector<uint32_t> due;
+		std::vector<std::function<void()>> calls;
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (!mStopping)
+		{
+			uint64_t now = NowTicks();
+			if (mCount == 0 && now > mTick)
+			{
+				mTick = now;
+			}
+
+			while (mTick < now)
+			{
+				uint64_t tick = ++mTick;
+
+				// Each wrap of a level moves the next slot of the level above down
+				for (int level = 1; level < TIMER_WHEEL_LEVELS && (tick & ((1ull << (8 * level)) - 1)) == 0; ++level)
+				{
+					Cascade(level, static_cast<int>((tick >> (8 * level)) & (TIMER_WHEEL_SLOTS - 1)));
+				}
+
+				// Everything left in the level 0 slot is due now
+				int slot = static_cast<int>(tick & (TIMER_WHEEL_SLOTS - 1));
+				for (uint32_t index = mSlots[0][slot]; index != TIMER_NIL; index = mNodes[index].next)
+				{
+					mNodes[index].state = TIMER_STATE::TIMER_RUNNING;
+					due.push_back(index);
+				}
+				mSlots[0][slot] = TIMER_NIL;
+				mOccupied[0][slot / 64] &= ~(1ull << (slot % 64));
+			}
+
+			if (!due.empty())
+			{
+				for (uint32_t index : due)
+				{
+					calls.push_back(std::move(mNodes[index].callback));
+				}
+
+				// Callbacks run unlocked so they can schedule and cancel
+				lock.unlock();
+				for (std::function<void()>& call : calls)
+				{
+					call();
+				}
+				lock.lock();
+
+				for (size_t i = 0; i < due.size(); ++i)
+				{
+					TimerNode& node = mNodes[due[i]];
+					if (node.state == TIMER_STATE::TIMER_RUNNING && node.period > 0)
+					{
+						node.callback = std::move(calls[i]);
+						node.state = TIMER_STATE::TIMER_PENDING;
+						node.expires += node.period;
+						node.expires = (node.expires > mTick) ? node.expires : mTick + 1;
+						Insert(due[i]);
+					}
+					else
+					{
+						Release(due[i]);
+						--mCount;
+					}
+				}
+				due.clear();
+				calls.clear();
+				mDoneCv.notify_all();
+				continue;
+			}
+
+			uint64_t wake = NextWake();
+			if (wake == 0)
+			{
+				mWakeTick = UINT64_MAX;
+				mCv.wait(lock);
+			}
+			else
+			{
+				mWakeTick = mTick + wake;
+				mCv.wait_until(lock, mStart + std::chrono::milliseconds(mWakeTick));
+			}
+			mWakeTick = 0;
+		}
+	}
+
+	void TimerWheel::Insert(uint32_t index)
+	{
+		TimerNode& node = mNodes[index];
+
+		// Pick the lowest level whose range covers the delay, clamping past the top level
+		uint64_t expires = (node.expires > mTick) ? node.expires : mTick;
+		uint64_t delta = expires - mTick;
+		int level = 0;
+		while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (8 * (level + 1))))
+		{
+			++level;
+		}
+		if (delta >= (1ull << (8 * TIMER_WHEEL_LEVELS)))
+		{
+			expires = mTick + (1ull << (8 * TIMER_WHEEL_LEVELS)) - 1;
+		}
+
+		int slot = static_cast<int>((expires >> (8 * level)) & (TIMER_WHEEL_SLOTS - 1));
+		node.level = static_cast<uint8_t>(level);
+		node.slot = static_cast<uint16_t>(slot);
+		node.prev = TIMER_NIL;
+		node.next = mSlots[level][slot];
+		if (node.next != TIMER_NIL)
+		{
+			mNodes[node.next].prev = index;
+		}
+		mSlots[level][slot] = index;
+		mOccupied[level][slot / 64] |= 1ull << (slot % 64);
+	}
+
+	void TimerWheel::Unlink(uint32_t index)
+	{
+		TimerNode& node = mNodes[index];
+		if (node.prev != TIMER_NIL)
+		{
+			mNodes[node.prev].next = node.next;
+		}
+		else
+		{
+			mSlots[node.level][node.slot] = node.next;
+		}
+
+		if (node.next != TIMER_NIL)
+		{
+			mNodes[node.next].prev = node.prev;
+		}
+
+		if (mSlots[node.level][node.slot] == TIMER_NIL)
+		{
+			mOccupied[node.level][node.slot / 64] &= ~(1ull << (node.slot % 64));
+		}
+	}
+
+	void TimerWheel::Cascade(int level, int slot)
+	{
+		uint32_t index = mSlots[level][slot];
+		mSlots[level][slot] = TIMER_NIL;
+		mOccupied[level][slot / 64] &= ~(1ull << (slot % 64));
+
+		while (index != TIMER_NIL)
+		{
+			uint32_t next = mNodes[index].next;
+			Insert(index);
+			index = next;
+		}
+	}
+
+	uint64_t TimerWheel::NextWake() const
+	{
+		if (mCount == 0)
+		{
+			return 0;
+		}
+
+		// Nearest level 0 slot holding timers, otherwise the next wrap where a cascade may bring some
+		uint64_t wrap = TIMER_WHEEL_SLOTS - (mTick & (TIMER_WHEEL_SLOTS - 1));
+		for (uint64_t ticks = 1; ticks < wrap; ++ticks)
+		{
+			uint64_t slot = (mTick + ticks) & (TIMER_WHEEL_SLOTS - 1);
+			uint64_t word = mOccupied[0][slot / 64] >> (slot % 64);
+			if (word == 0)
+			{
+				// Skip the rest of an empty word
+				ticks += 63 - (slot % 64);
+				continue;
+			}
+			if (word & 1)
+			{
+				return ticks;
+			}
+		}
+		return wrap;
+	}
+
+	uint64_t TimerWheel::NowTicks() const
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - mStart).count());
+	}
+
+	void TimerWheel::Release(uint32_t index)
+	{
+		TimerNode& node = mNodes[index];
+		node.state = TIMER_STATE::TIMER_FREE;
+		node.callback = nullptr;
+		++node.generation;
+		if (node.generation == 0)
+		{
+			node.generation = 1;
+		}
+		node.next = mFree;
+		mFree = index;
+	}
+}
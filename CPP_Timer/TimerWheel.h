@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		TimerWheel.h
+//!
+//! @brief		A hashed hierarchical timer wheel running one shot and periodic
+//!				callbacks from a single timer thread.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 1 / 12 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include <stdint.h>						// Standard integer types
+#include <chrono>						// Tick clock
+#include <condition_variable>			// Timer thread wake ups
+#include <functional>					// Callbacks
+#include <mutex>						// Wheel protection
+#include <thread>						// Timer thread
+#include <vector>						// Timer pool
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_TIMER_WHEEL				// Define the timer wheel class.
+#define     CPP_TIMER_WHEEL
+//
+constexpr int TIMER_WHEEL_LEVELS = 4;		//! Wheel levels, 8 bits of the expiry tick each
+constexpr int TIMER_WHEEL_SLOTS = 256;		//! Slots per level
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace Essentials
+{
+	// Handle of a scheduled callback, 0 is never a valid handle
+	typedef uint64_t TIMER_HANDLE;
+	constexpr TIMER_HANDLE TIMER_INVALID_HANDLE = 0;
+
+	class TimerWheel
+	{
+	public:
+		//! @brief Constructor - starts the timer thread.
+		TimerWheel();
+
+		//! @brief Deconstructor - stops the timer thread, pending callbacks never run.
+		~TimerWheel();
+
+		//! @brief Schedules a callback on the timer thread.
+		//! @param delayMSecs - milliseconds until the first call.
+		//! @param periodMSecs - milliseconds between later calls, 0 for a one shot.
+		//! @param callback - function to call, keep it short - it delays every other timer.
+		//! @return handle to cancel with
+		TIMER_HANDLE	Schedule(uint32_t delayMSecs, uint32_t periodMSecs, std::function<void()> callback);
+
+		//! @brief Cancels a callback. If it is running on another thread, waits for it to return.
+		//! @param handle - handle from Schedule.
+		//! @return false if the handle already fired or was cancelled, true if cancelled
+		bool			Cancel(TIMER_HANDLE handle);
+
+		//! @brief Number of scheduled callbacks.
+		size_t			Pending();
+
+		//! @brief Holds the wheel still across fork.
+		void			Lock() { mMutex.lock(); }
+
+		//! @brief Releases Lock.
+		void			Unlock() { mMutex.unlock(); }
+
+		//! @brief Creates the wheel a forked child continues with - empty, with its own timer thread,
+		//!		   and never handing out a handle of this wheel. Call in the child with Lock held.
+		//!		   This wheel is left as is, its thread and any waiter on it stayed in the parent.
+		//! @return the new wheel
+		TimerWheel*		ForkChild() const;
+
+	protected:
+	private:
+		// State of a pooled timer
+		enum class TIMER_STATE : const uint8_t
+		{
+			TIMER_FREE,
+			TIMER_PENDING,
+			TIMER_RUNNING,
+			TIMER_CANCELLED,
+		};
+
+		// A pooled timer, linked into a wheel slot by index
+		struct TimerNode
+		{
+			uint64_t				expires;							// Tick the timer fires at
+			uint32_t				period;								// Ticks between calls, 0 for one shot
+			uint32_t				generation;							// Bumped on reuse so stale handles miss
+			uint32_t				prev;								// Previous timer in the slot
+			uint32_t				next;								// Next timer in the slot or free list
+			TIMER_STATE				state;								// Free, pending, running or cancelled
+			uint8_t					level;								// Wheel level holding the timer
+			uint16_t				slot;								// Slot holding the timer
+			std::function<void()>	callback;							// Function to call
+		};
+
+		//! @brief Timer thread - advances the wheel and runs due callbacks.
+		void			Run();
+
+		//! @brief Links a pending timer into the slot for its expiry.
+		void			Insert(uint32_t index);
+
+		//! @brief Unlinks a pending timer from its slot.
+		void			Unlink(uint32_t index);
+
+		//! @brief Moves the timers of a higher level slot down to lower levels.
+		void			Cascade(int level, int slot);
+
+		//! @brief Ticks until the next slot with timers may need processing.
+		//! @return ticks, 0 if the wheel is empty
+		uint64_t		NextWake() const;
+
+		//! @brief Milliseconds since the wheel started.
+		uint64_t		NowTicks() const;
+
+		//! @brief Returns a timer to the pool.
+		void			Release(uint32_t index);
+
+		std::vector<TimerNode>	mNodes;									// Timer pool
+		uint32_t				mFree;									// Head of the free list
+		uint32_t				mSlots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];	// Head timer of each slot
+		uint64_t				mOccupied[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 64];	// Slots holding timers
+		uint64_t				mTick;									// Last processed tick
+		uint64_t				mWakeTick;								// Tick the timer thread sleeps until
+		size_t					mCount;									// Scheduled timers
+		std::chrono::steady_clock::time_point	mStart;					// Tick 0
+		std::mutex				mMutex;									// Protects the wheel
+		std::condition_variable	mCv;									// Wakes the timer thread
+		std::condition_variable	mDoneCv;								// Wakes Cancel waiting on a running callback
+		bool					mStopping;								// Timer thread should exit
+		std::thread*			mThread;								// Timer thread
+	};
+}
+#endif // CPP_TIMER_WHEEL
@@ -16,6 +16,17 @@
 //          name                        reason included
 //          --------------------        ---------------------------------------
 #include	"Log.h"						// Log Class
+#include	"LogSink.h"					// Additional outputs
+#include	"LogFileSink.h"				// File backends
+#include	"LogIndex.h"				// Time index
+#include	"LogCompress.h"				// Compressed file extension
+#include	"LogTrace.h"				// Trace file
+#include	<algorithm>					// std::min
+#include	<iterator>					// Moving backlog slices
+#include	<cstdlib>					// atexit
+#ifndef _WIN32
+#include	<pthread.h>					// pthread_atfork
+#endif
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -23,8 +34,15 @@ namespace Essentials
 {
 	// Initialize static class variables.
 	Log* Log::mInstance = NULL;
+	Log* Log::mForking = NULL;
 	std::mutex Log::mMutex;
 
+	thread_local uint32_t Log::tThreadId = 0;
+	std::atomic<uint32_t> Log::mNextThreadId(1);
+
+	// Sequence of the last file entry queued by each thread
+	static thread_local uint64_t tLastSequence = 0;
+
 	Log* Log::GetInstance()
 	{
 		std::lock_guard<std::mutex> lock(Log::mMutex);
@@ -55,25 +73,20 @@ namespace Essentials
 
 		this->mUser = "Log";
 		this->mOutputFile = filename;
-		this->mConsoleOutputEnabled = enableConsoleLogging;
-		this->mFileOutputEnabled = enableFileLogging;
-		this->mMaxConsoleLogLevel = LOG_LEVEL::LOG_DEBUG;
-		this->mMaxFileLogLevel = LOG_LEVEL::LOG_DEBUG;
-		this->mTimestampLevel = LOG_TIME::LOG_MSEC;
-
-#ifdef NO_TIMER
-		uint32_t initStart = 0;
-#elif defined CPP_TIMER
-		Timer* timer = Timer::GetInstance();
-		uint32_t initStart = timer->GetMSecTicks();
-#elif defined OLD_TIMER
-		uint32_t initStart = TIMER_GetMsecTicks();
-#endif
+		UpdateConfig([&](LogConfig& config)
+		{
+			config.consoleEnabled = enableConsoleLogging;
+			config.fileEnabled = enableFileLogging;
+			config.consoleLevel = LOG_LEVEL::LOG_DEBUG;
+			config.fileLevel = LOG_LEVEL::LOG_DEBUG;
+			config.timestampLevel = LOG_TIME::LOG_MSEC;
+		});
+		ApplyGlobalLevels();
 
 		size_t i = filename.rfind('/', filename.length());
 		if (i == std::string::npos)
 		{
-			printf_s("log path is not a valid path.\n");
+			printf("log path is not a valid path.\n");
 			return -1;
 		}
 		std::string directoryPath = filename.substr(0, i);
@@ -91,8 +104,12 @@ namespace Essentials
 			if (made == -1)
 			{
 				char buffer[256];
+#ifdef _WIN32
 				strerror_s(buffer, sizeof(buffer), errno); // get string message from errno, XSI-compliant version
-				printf_s("Error %s\n", buffer);
+#else
+				snprintf(buffer, sizeof(buffer), "%s", strerror(errno));
+#endif
+				printf("Error %s\n", buffer);
 			}
 		}
 
@@ -101,7 +118,11 @@ namespace Essentials
 		char time_str[] = "yyy.mm.dd.HH-MM.SS.fff";
 		time_t ttime_t = std::chrono::system_clock::to_time_t(now);
 		std::tm ttm = { 0 };
+#ifdef _WIN32
 		localtime_s(&ttm, &ttime_t);
+#else
+		localtime_r(&ttime_t, &ttm);
+#endif
 		strftime(time_str, strlen(time_str), "%Y.%m.%d-%H.%M.%S", &ttm);
 		std::chrono::system_clock::time_point tp_sec = std::chrono::system_clock::from_time_t(ttime_t);
 		int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - tp_sec).count();
@@ -112,110 +133,409 @@ namespace Essentials
 			milliseconds.insert(0, 3 - milliseconds.length(), '0');
 		}
 
+		// Fill the record pool and size the queues now, so steady state logging never allocates
+		// or takes a page fault. Growing then clearing a queue touches its pages and keeps them.
+		if (!LogPool::Instance()->Reserve(mPoolBlocks, mPoolLock))
+		{
+			printf("Could not lock the log record pool in memory.\n");
+		}
+		for (std::vector<LogEntry>& queue : mQueues)
+		{
+			queue.resize(mPoolBlocks);
+			queue.clear();
+		}
+
 		// Create the file and verify its open - if successful start the writing thread.
-		mFile.open(filename + "_" + std::string(time_str) + "." + milliseconds + ".txt");
-		if (!mFile.is_open())
+		mFilePath = filename + "_" + std::string(time_str) + "." + milliseconds + ".txt";
+		if (mBackend == LOG_BACKEND::LOG_BACKEND_COMPRESSED)
+		{
+			mFilePath += LOG_COMPRESS_EXTENSION;
+		}
+		mFileSink = CreateFileSink(mBackend, mFilePath, mCompressThreads);
+		if (!mFileSink->IsOpen())
 		{
-			printf_s("Error creating log file [%s].\n", filename.c_str());
+			printf("Error creating log file [%s].\n", filename.c_str());
+			delete mFileSink;
+			mFileSink = nullptr;
 		}
 		else
 		{
+			// Index offsets point into the text, the compressed file carries its own block index
+			if (mTimeIndex && mBackend == LOG_BACKEND::LOG_BACKEND_COMPRESSED)
+			{
+				printf("The time index is not written for compressed log files.\n");
+			}
+			else if (mTimeIndex)
+			{
+				// Wall clock of line timestamp 0, so the query tool can place every line in time
+				uint64_t wallNow = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+				LogSink* index = new LogIndexSink(mFilePath, wallNow - (LogClock::NowUSecs() - mClockBase), mIndexMSecs);
+				if (index->IsOpen())
+				{
+					AddSink(index);
+				}
+				else
+				{
+					printf("Error creating log index [%s%s].\n", mFilePath.c_str(), LOG_INDEX_EXTENSION);
+					delete index;
+				}
+			}
+
+			if (mTracing)
+			{
+				// Spans share the line timestamp base when lines carry timestamps
+				LogTrace::Instance()->Drain(mTraceEvents);
+				mTraceEvents.clear();
+				mTraceFile = new LogTraceFile(mFilePath + LOG_TRACE_EXTENSION, LogClock::Enabled ? mClockBase : LogTraceClock::NowUSecs());
+				if (mTraceFile->IsOpen())
+				{
+					LogTrace::SetEnabled(true);
+				}
+				else
+				{
+					printf("Error creating trace file [%s%s].\n", mFilePath.c_str(), LOG_TRACE_EXTENSION);
+					delete mTraceFile;
+					mTraceFile = nullptr;
+				}
+			}
+
+			// The writer exits once it sees the logger stopped, so mark it running first
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopped = false;
+				mShutdownDeadline = 0;
+			}
+			mWriterDone = false;
+			mRunning = true;
 			mThread = new std::thread(&Log::WriteOut, this);
+			ScheduleSyncTimer();
 		}
 
 		// Successful initialization
 		mRunning = true;
 
-#ifdef NO_TIMER
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Initialize Complete - Using NO_TIMER.");
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "File Log Level: %s - Console Log Level: %s", );
-#elif defined CPP_TIMER
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Initialize Complete - Using CPP_TIMER.");
-#elif defined OLD_TIMER
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Initialize Complete - Using OLD_TIMER.);
-#endif
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "File Log Level:    %s",	LevelMap[mMaxFileLogLevel].c_str());
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Console Log Level: %s",	LevelMap[mMaxConsoleLogLevel].c_str());
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Time Type:         %s",	TimeMap[mTimestampLevel].c_str());
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Initialize Complete - Using %s clock.", LogClock::Name);
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load();
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "File Log Level:    %s",	LevelMap[config->fileLevel].c_str());
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Console Log Level: %s",	LevelMap[config->consoleLevel].c_str());
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Time Type:         %s",	TimeMap[config->timestampLevel].c_str());
+
+		return 1;
+	}
+
+	int Log::InitializeShared(std::string channel, size_t ringBytes, bool enableConsoleLogging)
+	{
+		// Catch if already initialized. 
+		if (mRunning)
+		{
+			return 0;
+		}
 
+		this->mUser = "Log";
+		this->mOutputFile = channel;
+		UpdateConfig([&](LogConfig& config)
+		{
+			config.consoleEnabled = enableConsoleLogging;
+			config.fileEnabled = true;
+			config.consoleLevel = LOG_LEVEL::LOG_DEBUG;
+			config.fileLevel = LOG_LEVEL::LOG_DEBUG;
+			config.timestampLevel = LOG_TIME::LOG_MSEC;
+		});
+		ApplyGlobalLevels();
+
+		mSharedRing = new LogSharedRing;
+		if (!mSharedRing->Create(channel, ringBytes))
+		{
+			printf("Error creating shared log ring [%s].\n", channel.c_str());
+			delete mSharedRing;
+			mSharedRing = nullptr;
+			return -1;
+		}
+
+		mRunning = true;
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Initialize Complete - Using shared ring %s.", mSharedRing->Name().c_str());
 		return 1;
 	}
 
 	bool Log::AddEntry(LOG_LEVEL level, std::string user, std::string format, ...)
 	{
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load(std::memory_order_acquire);
+		va_list args;
+		va_start(args, format);
+		bool logged = AddEntryV(config, nullptr, 1, level, user, PackLevels(config->consoleLevel, config->fileLevel), format.c_str(), args);
+		va_end(args);
+		return logged;
+	}
+
+	bool Log::AddEntry(LogCallSite& site, LOG_LEVEL level, std::string user, std::string format, ...)
+	{
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load(std::memory_order_acquire);
+		va_list args;
+		va_start(args, format);
+		bool logged = AddEntryV(config, &site, 1, level, user, PackLevels(config->consoleLevel, config->fileLevel), format.c_str(), args);
+		va_end(args);
+		return logged;
+	}
+
+	bool Log::AddSampledEntry(uint32_t sampleRate, LOG_LEVEL level, std::string user, std::string format, ...)
+	{
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load(std::memory_order_acquire);
+		va_list args;
+		va_start(args, format);
+		bool logged = AddEntryV(config, nullptr, sampleRate, level, user, PackLevels(config->consoleLevel, config->fileLevel), format.c_str(), args);
+		va_end(args);
+		return logged;
+	}
+
+	bool Log::AddEntry(LOG_COMPONENT component, LOG_LEVEL level, const char* format, ...)
+	{
+		// One load decides a filtered entry, before the settings snapshot is entered. Unregistered
+		// slots hold 0, so the count is only checked for entries that pass.
+		if (component >= MAX_LOG_COMPONENTS)
+		{
+			return false;
+		}
+		uint8_t levels = mComponentLevels[component].load(std::memory_order_relaxed);
+		if ((static_cast<int>(level) > (levels >> 4) && static_cast<int>(level) > (levels & 0x0F)) || component >= mComponentCount)
+		{
+			return false;
+		}
+
+		LogConfigRead reading;
 		va_list args;
+		va_start(args, format);
+		bool logged = AddEntryV(mConfig.load(std::memory_order_acquire), nullptr, 1, level, mComponentNames[component], levels, format, args);
+		va_end(args);
+		return logged;
+	}
+
+	LOG_COMPONENT Log::RegisterComponent(std::string name)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mComponentIds.find(name);
+		if (it != mComponentIds.end())
+		{
+			return it->second;
+		}
+
+		if (mComponentCount >= MAX_LOG_COMPONENTS)
+		{
+			return LOG_INVALID_COMPONENT;
+		}
+
+		// New components follow the global levels until given their own
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load();
+		LOG_COMPONENT component = static_cast<LOG_COMPONENT>(mComponentCount);
+		mComponentNames[component] = name;
+		mComponentLevels[component].store(PackLevels(config->consoleLevel, config->fileLevel));
+		mComponentOverridden[component] = false;
+		mComponentIds[name] = component;
+		mComponentCount = component + 1;
+		return component;
+	}
+
+	bool Log::SetComponentLogLevel(LOG_COMPONENT component, LOG_LEVEL consoleLevel, LOG_LEVEL fileLevel)
+	{
+		if (component >= mComponentCount)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mComponentLevels[component].store(PackLevels(consoleLevel, fileLevel), std::memory_order_relaxed);
+		mComponentOverridden[component] = true;
+		return true;
+	}
+
+	bool Log::ResetComponentLogLevel(LOG_COMPONENT component)
+	{
+		if (component >= mComponentCount)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load();
+		mComponentLevels[component].store(PackLevels(config->consoleLevel, config->fileLevel), std::memory_order_relaxed);
+		mComponentOverridden[component] = false;
+		return true;
+	}
+
+	void Log::ApplyGlobalLevels()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		LogConfigRead reading;
+		const LogConfig* config = mConfig.load();
+		uint8_t levels = PackLevels(config->consoleLevel, config->fileLevel);
+		for (size_t i = 0; i < mComponentCount; i++)
+		{
+			if (!mComponentOverridden[i])
+			{
+				mComponentLevels[i].store(levels, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool Log::AddEntryV(const LogConfig* config, LogCallSite* site, uint32_t sampleRate, LOG_LEVEL level, const std::string& user, uint8_t levels, const char* format, va_list args)
+	{
 		char msg[MAX_LOG_MESSAGE_LENGTH + 1];
 		char ts[20];
 
-		// Format the message timestamp
-		switch (mTimestampLevel)
-		{
-#if !defined NO_TIMER
-		case LOG_TIME::LOG_MSEC:
+		// Cheap checks first - nothing below runs for a filtered or rate limited entry
+		bool toConsole = config->consoleEnabled && static_cast<int>(level) <= (levels >> 4);
+		bool toFile = config->fileEnabled && static_cast<int>(level) <= (levels & 0x0F);
+		if (!toConsole && !toFile)
 		{
-#if defined CPP_TIMER
-			Timer* timer = Timer::GetInstance();
-			snprintf(ts, sizeof(ts), "[%7u] ", (unsigned int)timer->GetMSecTicks());
-#elif defined OLD_TIMER
-			snprintf(ts, sizeof(ts), "[%7u] ", (unsigned int)TIMER_GetMsecTicks());
-#endif
-			break;
+			return false;
 		}
-		case LOG_TIME::LOG_USEC:
+
+		if (site != nullptr && !site->Allow())
 		{
-#if defined CPP_TIMER
-			Timer* timer = Timer::GetInstance();
-			uint32_t t = timer->GetUSecTicks();
-			snprintf(ts, sizeof(ts), "[%7u.%03u] ", t / 1000, t % 1000);
-#elif defined OLD_TIMER
-			uint32_t t = TIMER_GetUsecTicks();
-			snprintf(ts, sizeof(ts), "[%7u.%03u] ", t / 1000, t % 1000);
-#endif
-			break;
+			return false;
 		}
-#endif
-		default:
+
+		// Format the message timestamp - the clock read inlines, LOG_CLOCK_NONE drops it entirely
+		ts[0] = '\0';
+		if constexpr (LogClock::Enabled)
 		{
-#ifdef _WIN32
-			strcpy_s(ts, sizeof(ts), "");
-#else
-			strcpy(ts, "");
-#endif
+			if (config->timestampLevel != LOG_TIME::LOG_NONE)
+			{
+				uint64_t t = LogClock::NowUSecs() - mClockBase;
+				if (config->timestampLevel == LOG_TIME::LOG_MSEC)
+				{
+					snprintf(ts, sizeof(ts), "[%7u] ", (unsigned int)(t / 1000));
+				}
+				else
+				{
+					snprintf(ts, sizeof(ts), "[%7u.%03u] ", (unsigned int)(t / 1000), (unsigned int)(t % 1000));
+				}
+			}
 		}
+
+		// Sampled entries carry their rate so downstream counts can be scaled back up
+		int offset = 0;
+		if (sampleRate > 1)
+		{
+			offset = snprintf(msg, sizeof(msg), "[1/%u] ", sampleRate);
 		}
 
 		// Format the message with args
-		va_start(args, format);
 #ifdef _WIN32
-		vsnprintf_s(msg, sizeof(msg), MAX_LOG_MESSAGE_LENGTH, format.c_str(), args);
+		vsnprintf(msg + offset, sizeof(msg) - offset, _TRUNCATE, format, args);
 #else
-		vsnprintf(msg, LOG_MAX_MSG_LEN, format.c_str(), args);
+		vsnprintf(msg + offset, sizeof(msg) - offset, format, args);
 #endif
 		msg[sizeof(msg) - 1] = '\0';
-		va_end(args);
 
+		if (site != nullptr)
+		{
+			// Collapse a storm of identical messages into a single count, written when a different
+			// message comes along, when the rate window reopens, once a second and at shutdown
+			site->Own(static_cast<int>(level), user);
+			bool repeat = site->IsRepeat(LogCallSite::Hash(msg));
+			if (repeat && !site->ReportDue())
+			{
+				return true;
+			}
+
+			uint64_t repeats = site->TakeRepeats();
+			uint64_t suppressed = site->TakeSuppressed();
+			if (repeats > 0 || suppressed > 0)
+			{
+				char note[96];
+				snprintf(note, sizeof(note), "Last message repeated %llu times, %llu rate limited",
+					(unsigned long long)repeats, (unsigned long long)suppressed);
+				Emit(config, level, user, ts, note, 1, toConsole, toFile);
+			}
+
+			// The note stands in for the repeated line
+			if (repeat)
+			{
+				return true;
+			}
+		}
+
+		return Emit(config, level, user, ts, msg, sampleRate, toConsole, toFile);
+	}
+
+	void Log::ReportCallSite(LogCallSite& site)
+	{
+		uint64_t repeats = site.TakeRepeats();
+		uint64_t suppressed = site.TakeSuppressed();
+		if ((repeats > 0 || suppressed > 0) && site.Owned())
+		{
+			AddEntry(static_cast<LOG_LEVEL>(site.Level()), site.User(), "Last message repeated %llu times, %llu rate limited",
+				(unsigned long long)repeats, (unsigned long long)suppressed);
+		}
+	}
+
+	void Log::FlushCallSite(LogCallSite& site)
+	{
+		// A site destroyed at exit reports while the logger still runs
+		if (mInstance != NULL)
+		{
+			mInstance->ReportCallSite(site);
+		}
+	}
+
+	bool Log::Emit(const LogConfig* config, LOG_LEVEL level, const std::string& user, const char* ts, const char* msg, uint32_t sampleRate, bool toConsole, bool toFile)
+	{
 		// Log to console if enabled and within the max
-		if (mConsoleOutputEnabled && level <= mMaxConsoleLogLevel)
+		if (toConsole)
 		{
 #ifdef _WIN32
 			char buf[400];
 			snprintf(buf, sizeof(buf), "%s - %s - %s\n", ts, user.c_str(), msg);
 			OutputDebugStringA(buf);    // goes to the debug console
-			printf_s("%s", buf);
+			printf("%s", buf);
 #else
-			printf("%s - %s - %s\n", ts, user, msg);
+			printf("%s - %s - %s\n", ts, user.c_str(), msg);
 #endif
 		}
 
 		// Log to file if enabled and within the max
-		if (mFileOutputEnabled && level <= mMaxFileLogLevel)
+		if (toFile)
 		{
-			mMutex.lock();
+			// The level name lets a query filter lines without the index
+			static const char* const levelNames[] = { "NONE", "ERROR", "WARN", "INFO", "DEBUG" };
 			char buffer[400];
-			snprintf(buffer, sizeof(buffer), "%s - %s - %s", ts, user.c_str(), msg);
-			std::string tmp = buffer;
-			mQueue.push(tmp);
+			int length = snprintf(buffer, sizeof(buffer), "%s%s - %s - %s", ts, levelNames[static_cast<int>(level)], user.c_str(), msg);
+			length = (length < 0) ? 0 : (length >= (int)sizeof(buffer)) ? (int)sizeof(buffer) - 1 : length;
+
+			int32_t cpu = config->threadCpu ? CurrentCpu() : -1;
+			uint32_t thread = ThreadId();
+
+			mMutex.lock();
+			if (mStopped)
+			{
+				// Nothing will write it - the logger was shut down
+				mMutex.unlock();
+				return false;
+			}
+			uint64_t seq = ++mSequence;
+			if (mSharedRing != nullptr)
+			{
+				// The collector merges processes by wall clock
+				uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::system_clock::now().time_since_epoch()).count();
+				bool pushed = mSharedRing->Push(static_cast<uint32_t>(level), seq, now, buffer, length);
+				mMutex.unlock();
+				tLastSequence = seq;
+				return pushed;
+			}
+			int lane = config->priorityLanes ? LaneOf(level) : LOG_LANES - 1;
+			mQueues[lane].push_back(LogEntry{ seq, level, LogText(buffer, length), sampleRate, thread, cpu });
 			mMutex.unlock();
+			mQueueCv.notify_one();
+
+			tLastSequence = seq;
 		}
 
 		return true;
@@ -223,93 +543,1153 @@ namespace Essentials
 
 	void Log::WriteOut()
 	{
-		while (mRunning)
+		std::vector<LogEntry> lanes[LOG_LANES];
+		std::vector<LogEntry> slice;
+		std::vector<LogSink*> sinks;
+		uint64_t unsyncedBytes = 0;
+		bool periodicPending = false;
+		bool stopping = false;
+		uint64_t abandonedFrom = UINT64_MAX;
+		// Counted from 0, so a header the sink failed to write fails the first commit
+		uint64_t fileErrors = 0;
+		bool held = false;
+		std::chrono::steady_clock::time_point heldSince;
+
+		// The writer's side of each swap needs the same room as the producers' side
+		for (std::vector<LogEntry>& lane : lanes)
 		{
-			std::string entry;
+			lane.resize(mPoolBlocks);
+			lane.clear();
+		}
+		slice.reserve(LOG_LANE_SLICE);
 
-			mMutex.lock();
-			if (mFile.is_open() && !mQueue.empty())
+		while (!stopping)
+		{
+			uint64_t syncRequest = 0;
+			uint64_t flushRequest = 0;
+			uint64_t takenSeq = 0;
+			bool syncTick = false;
 			{
-				entry = mQueue.front();
-				mQueue.pop();
+				std::unique_lock<std::mutex> lock(mMutex);
+
+				// Sleep until there is work - the sync timer ticks in when a periodic sync is due,
+				// and spans are picked up at least every LOG_TRACE_DRAIN_MSECS while tracing. Entries
+				// the file sink holds back are flushed once they have waited LOG_SINK_HOLD_MSECS.
+				auto work = [this] { return Queued() || !mRunning || mSyncTick || mSyncRequestSeq > mDurableSeq || mFlushRequestSeq > mWrittenSeq; };
+				auto wake = std::chrono::steady_clock::time_point::max();
+				if (mTraceFile != nullptr)
+				{
+					wake = std::chrono::steady_clock::now() + std::chrono::milliseconds(LOG_TRACE_DRAIN_MSECS);
+				}
+				if (held)
+				{
+					wake = std::min(wake, heldSince + std::chrono::milliseconds(LOG_SINK_HOLD_MSECS));
+				}
+
+				if (wake != std::chrono::steady_clock::time_point::max())
+				{
+					mQueueCv.wait_until(lock, wake, work);
+				}
+				else
+				{
+					mQueueCv.wait(lock, work);
+				}
+				syncTick = mSyncTick;
+				mSyncTick = false;
+
+				// Swapping hands the emptied vectors back, so both sides keep their capacity
+				for (int lane = 0; lane < LOG_LANES; ++lane)
+				{
+					lanes[lane].swap(mQueues[lane]);
+				}
+
+				// Every sequence up to here is now held by this thread
+				takenSeq = mSequence;
+				syncRequest = mSyncRequestSeq;
+				flushRequest = mFlushRequestSeq;
+				sinks = mSinks;
+				stopping = !mRunning && !Queued();
+				for (int lane = 0; lane < LOG_LANES; ++lane)
+				{
+					stopping &= lanes[lane].empty();
+				}
 			}
-			mMutex.unlock();
 
-			if (entry.length() > 0)
+			// The snapshot is held for the batch, never while sleeping, so an idle writer never delays a free
+			LogConfigRead reading;
+			const LogConfig* config = mConfig.load(std::memory_order_acquire);
+
+			// Writes entries to the file and sinks, returning whether any asked for an immediate sync
+			auto write = [&](std::vector<LogEntry>& batch)
+			{
+				bool syncNow = false;
+				for (LogEntry& entry : batch)
+				{
+					PrefixLine(config, entry);
+					unsyncedBytes += entry.text.size() + 1;
+
+					LOG_SYNC policy = config->levelSync[static_cast<int>(entry.level)];
+					syncNow |= (policy == LOG_SYNC::LOG_SYNC_IMMEDIATE);
+					periodicPending |= (policy == LOG_SYNC::LOG_SYNC_PERIODIC);
+				}
+
+				if (!batch.empty())
+				{
+					mEntriesWritten.fetch_add(batch.size(), std::memory_order_relaxed);
+					mFileSink->Write(batch);
+					for (LogSink* sink : sinks)
+					{
+						sink->Write(batch);
+					}
+					batch.clear();
+				}
+				return syncNow;
+			};
+
+			// Everything below the oldest unwritten backlog entry has been written
+			std::vector<LogEntry>& backlog = lanes[LOG_LANES - 1];
+			size_t backlogDone = 0;
+
+			// Past the shutdown deadline whatever is still queued is dropped and counted
+			auto abandonIfLate = [&]()
+			{
+				int64_t deadline = mShutdownDeadline.load(std::memory_order_relaxed);
+				if (deadline == 0 || std::chrono::steady_clock::now().time_since_epoch().count() < deadline)
+				{
+					return false;
+				}
+
+				uint64_t dropped = backlog.size() - backlogDone;
+				for (size_t i = backlogDone; i < backlog.size(); ++i)
+				{
+					abandonedFrom = std::min(abandonedFrom, backlog[i].seq);
+				}
+				backlog.clear();
+				backlogDone = 0;
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				for (int lane = 0; lane < LOG_LANES; ++lane)
+				{
+					for (std::vector<LogEntry>* queue : { &lanes[lane], &mQueues[lane] })
+					{
+						for (const LogEntry& entry : *queue)
+						{
+							abandonedFrom = std::min(abandonedFrom, entry.seq);
+						}
+						dropped += queue->size();
+						queue->clear();
+					}
+				}
+				mAbandoned.fetch_add(dropped);
+				stopping = true;
+				return true;
+			};
+			// Records a failed file write or sync, the entries up to written may not have landed
+			auto failed = [&](uint64_t written)
+			{
+				uint64_t errors = mFileSink->Errors();
+				if (errors == fileErrors)
+				{
+					return false;
+				}
+
+				mWriteErrors.fetch_add(errors - fileErrors);
+				fileErrors = errors;
+				std::lock_guard<std::mutex> lock(mDurableMutex);
+				if (written > mFailedSeq)
+				{
+					mFailedSeq = written;
+				}
+				return true;
+			};
+			auto commit = [&](bool sync, bool force)
 			{
-				mFile << entry << "\n";
-				mFile.flush();
+				bool handed = true;
+				if (force)
+				{
+					mFileSink->Flush();
+					for (LogSink* sink : sinks)
+					{
+						sink->Flush();
+					}
+				}
+				else
+				{
+					handed = mFileSink->Idle();
+					for (LogSink* sink : sinks)
+					{
+						sink->Idle();
+					}
+				}
 
-				entry.clear();
+				if (!handed && !held)
+				{
+					heldSince = std::chrono::steady_clock::now();
+				}
+				held = !handed;
+
+				uint64_t written = takenSeq;
+				if (backlogDone < backlog.size() && backlog[backlogDone].seq <= written)
+				{
+					written = backlog[backlogDone].seq - 1;
+				}
+				if (abandonedFrom <= written)
+				{
+					written = abandonedFrom - 1;
+				}
+
+				// A failed commit moves neither sequence, waiters up to it are told it failed.
+				// Entries the file sink held back are not written yet either.
+				bool lost = failed(written);
+				if (!lost && handed)
+				{
+					std::lock_guard<std::mutex> lock(mDurableMutex);
+					if (written > mWrittenSeq)
+					{
+						mWrittenSeq = written;
+					}
+				}
+
+				if (sync && unsyncedBytes > 0)
+				{
+					mFileSink->Sync();
+					for (LogSink* sink : sinks)
+					{
+						sink->Sync();
+					}
+					unsyncedBytes = 0;
+					periodicPending = false;
+					lost |= failed(written);
+				}
+
+				if (!lost && handed)
+				{
+					std::lock_guard<std::mutex> lock(mDurableMutex);
+					if (unsyncedBytes == 0)
+					{
+						mDurableSeq = mWrittenSeq.load();
+					}
+				}
+				mDurableCv.notify_all();
+
+				// Event loops only hear about it when a callback is due
+				if (std::max(mDurableSeq.load(), mFailedSeq.load()) >= mCompletions.NextDue())
+				{
+					mCompletions.Signal();
+				}
+			};
+
+			// Urgent lanes always go first and are committed on their own if they ask for a sync.
+			// The backlog goes out in slices, picking up urgent entries queued in between.
+			bool syncNeeded = false;
+			while (true)
+			{
+				bool urgentSync = false;
+				for (int lane = 0; lane < LOG_LANES - 1; ++lane)
+				{
+					urgentSync |= write(lanes[lane]);
+				}
+				if (urgentSync)
+				{
+					commit(true, true);
+				}
+
+				if (backlogDone == backlog.size() || abandonIfLate())
+				{
+					break;
+				}
+
+				size_t end = std::min(backlog.size(), backlogDone + LOG_LANE_SLICE);
+				slice.assign(std::make_move_iterator(backlog.begin() + backlogDone), std::make_move_iterator(backlog.begin() + end));
+				backlogDone = end;
+				syncNeeded |= write(slice);
+
+				if (backlogDone < backlog.size())
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					for (int lane = 0; lane < LOG_LANES - 1; ++lane)
+					{
+						lanes[lane].swap(mQueues[lane]);
+					}
+				}
 			}
+			backlog.clear();
+			backlogDone = 0;
 
-#if defined NO_TIMER
-#ifdef _WIN32
-			Sleep(1);
-#else
-			usleep(1000);
-#endif
-#elif defined CPP_TIMER
-			Timer* timer = Timer::GetInstance();
-			timer->MSecSleep(1);
-#elif defined OLD_TIMER
-			TIMER_MsecSleep(1);
-#endif
+			if (periodicPending)
+			{
+				syncNeeded |= (config->syncBytes > 0 && unsyncedBytes >= config->syncBytes);
+				syncNeeded |= syncTick;
+			}
+			syncNeeded |= (syncRequest > mDurableSeq);
+
+			// Buffered backends keep filling while earlier data is on its way to the disk, so
+			// only push everything out when a caller waits, a sync is due or the queues ran dry
+			bool idle = stopping;
+			if (!idle)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				idle = !Queued();
+			}
+
+			// An idle commit nobody waits for lets the file sink keep a partial buffer open
+			if (syncNeeded || idle || flushRequest > mWrittenSeq)
+			{
+				bool due = held && std::chrono::steady_clock::now() >= heldSince + std::chrono::milliseconds(LOG_SINK_HOLD_MSECS);
+				commit(syncNeeded, syncNeeded || stopping || flushRequest > mWrittenSeq || due);
+			}
+
+			if (mTraceFile != nullptr)
+			{
+				uint64_t dropped = LogTrace::Instance()->Drain(mTraceEvents);
+				if (!mTraceEvents.empty() || dropped > 0)
+				{
+					RefreshWriterNames();
+					mTraceFile->Write(mTraceEvents, mWriterNames, dropped);
+					mTraceEvents.clear();
+				}
+				if (idle)
+				{
+					mTraceFile->Flush();
+				}
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mDurableMutex);
+			mWriterDone = true;
+		}
+		mDurableCv.notify_all();
+		if (mCompletions.NextDue() != LOG_NOTHING_DUE)
+		{
+			mCompletions.Signal();
 		}
 	}
 
-	bool Log::SetConsoleLogLevel(LOG_LEVEL level)
+	void Log::RefreshWriterNames()
 	{
-		mMaxConsoleLogLevel = level;
-		return (level == mMaxConsoleLogLevel);
+		// The writer keeps its own copy of the names, refreshed only when one is added
+		uint32_t version = mThreadNamesVersion.load(std::memory_order_acquire);
+		if (version != mWriterNamesVersion)
+		{
+			std::lock_guard<std::mutex> lock(mThreadMutex);
+			mWriterNames = mThreadNames;
+			mWriterNamesVersion = version;
+		}
 	}
 
-	bool Log::SetFileLogLevel(LOG_LEVEL level)
+	void Log::PrefixLine(const LogConfig* config, LogEntry& entry)
 	{
-		mMaxFileLogLevel = level;
-		return (level == mMaxFileLogLevel);
+		if (!config->sequencePrefix && !config->threadTag)
+		{
+			return;
+		}
+
+		std::string prefix;
+		if (config->sequencePrefix)
+		{
+			prefix += "#" + std::to_string(entry.seq) + " ";
+		}
+
+		if (config->threadTag)
+		{
+			RefreshWriterNames();
+			prefix += "{";
+			if (entry.thread < mWriterNames.size() && !mWriterNames[entry.thread].empty())
+			{
+				prefix += mWriterNames[entry.thread];
+			}
+			else
+			{
+				prefix += std::to_string(entry.thread);
+			}
+			if (entry.cpu >= 0)
+			{
+				prefix += "@" + std::to_string(entry.cpu);
+			}
+			prefix += "} ";
+		}
+
+		entry.text.Prepend(prefix.data(), prefix.size());
 	}
 
-	bool Log::SetLogTimestampLevel(LOG_TIME tsLevel)
+	bool Log::Queued() const
 	{
-		mTimestampLevel = tsLevel;
-		return (tsLevel == mTimestampLevel);
+		for (const std::vector<LogEntry>& queue : mQueues)
+		{
+			if (!queue.empty())
+			{
+				return true;
+			}
+		}
+		return false;
 	}
 
-	bool Log::LogToConsole(bool enable)
+	uint64_t Log::LastEntrySequence()
 	{
-		mConsoleOutputEnabled = enable;
-		return (enable == mConsoleOutputEnabled);
+		return tLastSequence;
 	}
 
-	bool Log::LogToFile(bool enable)
+	bool Log::Flush(uint64_t seq)
 	{
-		mFileOutputEnabled = enable;
-		return (enable == mFileOutputEnabled);
+		if (mThread == nullptr)
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (seq == 0 || seq > mSequence)
+			{
+				seq = mSequence;
+			}
+			if (seq > mFlushRequestSeq)
+			{
+				mFlushRequestSeq = seq;
+			}
+		}
+		mQueueCv.notify_one();
+
+		std::unique_lock<std::mutex> lock(mDurableMutex);
+		mDurableCv.wait(lock, [this, seq] { return mWrittenSeq >= seq || mFailedSeq >= seq || mWriterDone; });
+		return mWrittenSeq >= seq && mFailedSeq < seq;
 	}
 
-	Log::~Log()
+	bool Log::WaitDurable(uint64_t seq)
 	{
-		// Notify close and wait for queue to finish writing to file
-		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Closing.");
-		while (!mQueue.empty()) {}
+		if (mThread == nullptr)
+		{
+			return false;
+		}
 
-		mRunning = false;
-		mThread->join();
-		delete mThread;
-		mFile.close();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (seq == 0 || seq > mSequence)
+			{
+				seq = mSequence;
+			}
+			if (seq > mSyncRequestSeq)
+			{
+				mSyncRequestSeq = seq;
+			}
+		}
+		mQueueCv.notify_one();
+
+		std::unique_lock<std::mutex> lock(mDurableMutex);
+		mDurableCv.wait(lock, [this, seq] { return mDurableSeq >= seq || mFailedSeq >= seq || mWriterDone; });
+		return mDurableSeq >= seq && mFailedSeq < seq;
 	}
 
-	Log::Log()
+	int Log::CompletionHandle()
 	{
-		mThread = nullptr;
-		mMaxConsoleLogLevel = LOG_LEVEL::LOG_NONE;
-		mMaxFileLogLevel = LOG_LEVEL::LOG_NONE;
-		mTimestampLevel = LOG_TIME::LOG_NONE;
-		mConsoleOutputEnabled = false;
-		mFileOutputEnabled = false;
-		mOutputFile = "";
+		return mCompletions.Handle();
+	}
+
+	bool Log::OnDurable(uint64_t seq, LogCompletion callback)
+	{
+		if (mThread == nullptr)
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (seq == 0 || seq > mSequence)
+			{
+				seq = mSequence;
+			}
+			if (seq > mSyncRequestSeq)
+			{
+				mSyncRequestSeq = seq;
+			}
+		}
+		mCompletions.Add(seq, std::move(callback));
+
+		// The writer checks the callbacks after moving the durable mark, this covers the
+		// mark having moved past seq before the callback was added
+		bool done;
+		{
+			std::lock_guard<std::mutex> lock(mDurableMutex);
+			done = mDurableSeq >= seq || mWriterDone;
+		}
+		if (done)
+		{
+			mCompletions.Signal();
+		}
+		else
+		{
+			mQueueCv.notify_one();
+		}
+		return true;
+	}
+
+	size_t Log::DispatchCompletions()
+	{
+		bool stopped;
+		{
+			std::lock_guard<std::mutex> lock(mDurableMutex);
+			stopped = mWriterDone;
+		}
+		return mCompletions.Dispatch(mDurableSeq, mFailedSeq, stopped);
+	}
+
+	bool Log::SetLevelDurability(LOG_LEVEL level, LOG_SYNC policy)
+	{
+		UpdateConfig([&](LogConfig& config) { config.levelSync[static_cast<int>(level)] = policy; });
+		mQueueCv.notify_one();
+		LogConfigRead reading;
+		return (policy == mConfig.load()->levelSync[static_cast<int>(level)]);
+	}
+
+	bool Log::SetSyncInterval(uint32_t msecs, uint64_t bytes)
+	{
+		if (msecs == 0 && bytes == 0)
+		{
+			return false;
+		}
+
+		UpdateConfig([&](LogConfig& config)
+		{
+			config.syncMSecs = msecs;
+			config.syncBytes = bytes;
+		});
+		ScheduleSyncTimer();
+		mQueueCv.notify_one();
+		return true;
+	}
+
+	bool Log::SetFileBackend(LOG_BACKEND backend)
+	{
+		// The backend is fixed once the file is open
+		if (mRunning)
+		{
+			return false;
+		}
+
+		mBackend = backend;
+		return true;
+	}
+
+	bool Log::SetCompressThreads(int threads)
+	{
+		// The helpers start with the file
+		if (mRunning || threads < 0)
+		{
+			return false;
+		}
+
+		mCompressThreads = threads;
+		return true;
+	}
+
+	bool Log::SetTracing(bool enable)
+	{
+		// The trace file is opened with the log file
+		if (mRunning)
+		{
+			return false;
+		}
+
+		mTracing = enable;
+		return true;
+	}
+
+	bool Log::SetTimeIndex(bool enable, uint32_t bucketMSecs)
+	{
+		// The index describes one file from its first line
+		if (mRunning)
+		{
+			return false;
+		}
+
+		mTimeIndex = enable;
+		mIndexMSecs = bucketMSecs;
+		return true;
+	}
+
+	bool Log::SetRecordPool(size_t blocks, bool lockMemory)
+	{
+		// The pool is filled once, before the first entry
+		if (mRunning)
+		{
+			return false;
+		}
+
+		mPoolBlocks = blocks;
+		mPoolLock = lockMemory;
+		return true;
+	}
+
+	bool Log::AddSink(LogSink* sink)
+	{
+		if (sink == nullptr)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mSinks.push_back(sink);
+		return true;
+	}
+
+	bool Log::SetConsoleLogLevel(LOG_LEVEL level)
+	{
+		UpdateConfig([&](LogConfig& config) { config.consoleLevel = level; });
+		ApplyGlobalLevels();
+		LogConfigRead reading;
+		return (level == mConfig.load()->consoleLevel);
+	}
+
+	bool Log::SetFileLogLevel(LOG_LEVEL level)
+	{
+		UpdateConfig([&](LogConfig& config) { config.fileLevel = level; });
+		ApplyGlobalLevels();
+		LogConfigRead reading;
+		return (level == mConfig.load()->fileLevel);
+	}
+
+	bool Log::SetLogTimestampLevel(LOG_TIME tsLevel)
+	{
+		UpdateConfig([&](LogConfig& config) { config.timestampLevel = tsLevel; });
+		LogConfigRead reading;
+		return (tsLevel == mConfig.load()->timestampLevel);
+	}
+
+	bool Log::LogToConsole(bool enable)
+	{
+		UpdateConfig([&](LogConfig& config) { config.consoleEnabled = enable; });
+		LogConfigRead reading;
+		return (enable == mConfig.load()->consoleEnabled);
+	}
+
+	bool Log::LogToFile(bool enable)
+	{
+		UpdateConfig([&](LogConfig& config) { config.fileEnabled = enable; });
+		LogConfigRead reading;
+		return (enable == mConfig.load()->fileEnabled);
+	}
+
+	bool Log::SetPriorityLanes(bool enable)
+	{
+		UpdateConfig([&](LogConfig& config) { config.priorityLanes = enable; });
+		LogConfigRead reading;
+		return (enable == mConfig.load()->priorityLanes);
+	}
+
+	uint32_t Log::AssignThreadId()
+	{
+		tThreadId = mNextThreadId.fetch_add(1, std::memory_order_relaxed);
+		return tThreadId;
+	}
+
+	int32_t Log::CurrentCpu()
+	{
+#ifdef _WIN32
+		return static_cast<int32_t>(GetCurrentProcessorNumber());
+#elif defined __linux__
+		return sched_getcpu();
+#else
+		return -1;
+#endif
+	}
+
+	void Log::SetThreadName(std::string name)
+	{
+		uint32_t thread = ThreadId();
+
+		std::lock_guard<std::mutex> lock(mThreadMutex);
+		if (thread >= mThreadNames.size())
+		{
+			mThreadNames.resize(thread + 1);
+		}
+		mThreadNames[thread] = name;
+		mThreadNamesVersion.fetch_add(1, std::memory_order_release);
+	}
+
+	bool Log::SetThreadTag(bool enable, bool cpu)
+	{
+		UpdateConfig([&](LogConfig& config) { config.threadTag = enable; config.threadCpu = cpu; });
+		LogConfigRead reading;
+		return (enable == mConfig.load()->threadTag);
+	}
+
+	bool Log::SetSequencePrefix(bool enable)
+	{
+		UpdateConfig([&](LogConfig& config) { config.sequencePrefix = enable; });
+		LogConfigRead reading;
+		return (enable == mConfig.load()->sequencePrefix);
+	}
+
+	void Log::UpdateConfig(const std::function<void(LogConfig&)>& change)
+	{
+		std::lock_guard<std::mutex> lock(mConfigMutex);
+
+		// Readers may still hold the old snapshot, so it is retired with the epoch they may hold it in
+		const LogConfig* current = mConfig.load();
+		LogConfig* next = new LogConfig(*current);
+		change(*next);
+		mConfig.store(next, std::memory_order_seq_cst);
+		mRetiredConfigs.push_back({ LogConfigReaders::Advance(), current });
+
+		// Free the snapshots every reader has moved past
+		uint64_t oldest = LogConfigReaders::OldestActive();
+		size_t kept = 0;
+		for (const std::pair<uint64_t, const LogConfig*>& retired : mRetiredConfigs)
+		{
+			if (retired.first < oldest)
+			{
+				delete retired.second;
+			}
+			else
+			{
+				mRetiredConfigs[kept++] = retired;
+			}
+		}
+		mRetiredConfigs.resize(kept);
+	}
+
+	bool Log::WatchConfig(std::string path)
+	{
+		if (mConfigThread != nullptr)
+		{
+			return false;
+		}
+
+		mConfigPath = path;
+		if (!ReloadConfig())
+		{
+			return false;
+		}
+
+		mConfigWatching = true;
+#ifdef __linux__
+		mConfigThread = new std::thread(&Log::WatchConfigFile, this);
+#else
+		PollConfigFile();
+#endif
+		return true;
+	}
+
+	bool Log::ReloadConfig()
+	{
+		if (mConfigPath.empty())
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mReloadMutex);
+		std::vector<LogConfigLine> lines;
+		std::string error;
+		bool valid = ReadLogConfig(mConfigPath, lines, error);
+		if (valid)
+		{
+			// Checked on a copy first, so a bad file never publishes a snapshot
+			LogConfigRead reading;
+			LogConfig check = *mConfig.load();
+			valid = ApplyLogConfig(lines, check, error);
+		}
+		if (!valid)
+		{
+			AddEntry(LOG_LEVEL::LOG_WARN, mUser, "Configuration not applied - %s", error.c_str());
+			return false;
+		}
+
+		// Applied to the snapshot current under the config lock, so a setter racing the reload keeps
+		// its change unless the file sets the same key
+		UpdateConfig([&](LogConfig& config) { ApplyLogConfig(lines, config, error); });
+		ApplyGlobalLevels();
+		{
+			LogConfigRead reading;
+			ApplyComponentConfig(*mConfig.load());
+		}
+		ScheduleSyncTimer();
+		mQueueCv.notify_one();
+
+		AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Configuration loaded from %s", mConfigPath.c_str());
+		return true;
+	}
+
+	void Log::ApplyComponentConfig(const LogConfig& config)
+	{
+		// Components dropped from the file go back to the global levels
+		for (const std::string& name : mConfigComponents)
+		{
+			if (config.components.count(name) == 0)
+			{
+				ResetComponentLogLevel(RegisterComponent(name));
+			}
+		}
+
+		mConfigComponents.clear();
+		for (const auto& component : config.components)
+		{
+			SetComponentLogLevel(RegisterComponent(component.first), component.second.first, component.second.second);
+			mConfigComponents.insert(component.first);
+		}
+	}
+
+	void Log::WatchConfigFile()
+	{
+		size_t slash = mConfigPath.find_last_of("/\\");
+		std::string directory = (slash == std::string::npos) ? "." : mConfigPath.substr(0, slash);
+		std::string name = (slash == std::string::npos) ? mConfigPath : mConfigPath.substr(slash + 1);
+
+#ifdef __linux__
+		// Watch the directory - editors and deploy tools usually replace the file by renaming
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			while (mConfigWatching)
+			{
+				pollfd pfd = { fd, POLLIN, 0 };
+				if (poll(&pfd, 1, 200) <= 0)
+				{
+					continue;
+				}
+
+				bool changed = false;
+				ssize_t length;
+				while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+				{
+					for (char* ptr = buffer; ptr < buffer + length;)
+					{
+						inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+						changed |= (event->len > 0 && name == event->name);
+						ptr += sizeof(inotify_event) + event->len;
+					}
+				}
+
+				if (changed)
+				{
+					ReloadConfig();
+				}
+			}
+			close(fd);
+			return;
+		}
+
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+
+		PollConfigFile();
+#endif
+	}
+
+	void Log::PollConfigFile()
+	{
+		struct stat st = { 0 };
+		mConfigModified = (stat(mConfigPath.c_str(), &st) == 0) ? st.st_mtime : 0;
+
+		// No inotify - check the modification time from the shared timer thread
+		mConfigTimer = Timer::GetInstance()->Schedule(500, 500, [this]
+		{
+			struct stat st = { 0 };
+			if (stat(mConfigPath.c_str(), &st) == 0 && st.st_mtime != mConfigModified)
+			{
+				mConfigModified = st.st_mtime;
+				ReloadConfig();
+			}
+		});
+	}
+
+	void Log::ScheduleSyncTimer()
+	{
+		// The timer is cancelled and scheduled outside the config lock. Cancel waits for a running
+		// callback, which takes mMutex, and PrepareFork takes mMutex before the config lock.
+		uint32_t msecs;
+		TIMER_HANDLE old;
+		{
+			std::lock_guard<std::mutex> lock(mConfigMutex);
+			msecs = mConfig.load()->syncMSecs;
+			if (!mRunning || (mSyncTimer != TIMER_INVALID_HANDLE && msecs == mSyncTimerMSecs))
+			{
+				return;
+			}
+			old = mSyncTimer;
+			mSyncTimer = TIMER_INVALID_HANDLE;
+			mSyncTimerMSecs = msecs;
+		}
+
+		Timer* timer = Timer::GetInstance();
+		timer->Cancel(old);
+		if (msecs == 0)
+		{
+			return;
+		}
+
+		// The writer sleeps until there is work, the tick tells it a periodic sync is due
+		TIMER_HANDLE handle = timer->Schedule(msecs, msecs, [this]
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mSyncTick = true;
+			}
+			mQueueCv.notify_one();
+		});
+
+		// A call that raced this one, or Shutdown, may have changed the period since - the last one wins
+		{
+			std::lock_guard<std::mutex> lock(mConfigMutex);
+			if (mSyncTimer == TIMER_INVALID_HANDLE && mSyncTimerMSecs == msecs)
+			{
+				mSyncTimer = handle;
+				handle = TIMER_INVALID_HANDLE;
+			}
+		}
+		timer->Cancel(handle);
+	}
+
+	LogShutdownResult Log::Shutdown(uint32_t deadlineMSecs)
+	{
+		LogShutdownResult result = {};
+
+		// Stop watching the config before anything it touches goes away
+		mConfigWatching = false;
+		if (mConfigThread != nullptr)
+		{
+			mConfigThread->join();
+			delete mConfigThread;
+			mConfigThread = nullptr;
+		}
+
+		// Cancel waits for a running callback, so neither touches the logger afterwards. A sync
+		// timer being scheduled right now sees the cleared period and cancels its own.
+		TIMER_HANDLE syncTimer;
+		{
+			std::lock_guard<std::mutex> lock(mConfigMutex);
+			syncTimer = mSyncTimer;
+			mSyncTimer = TIMER_INVALID_HANDLE;
+			mSyncTimerMSecs = 0;
+		}
+		Timer::GetInstance()->Cancel(mConfigTimer);
+		Timer::GetInstance()->Cancel(syncTimer);
+		mConfigTimer = TIMER_INVALID_HANDLE;
+
+		// Notify close, the writer drains the remaining queue in full batches until the deadline
+		if (mRunning)
+		{
+			// Repeats and suppressions no later entry will report
+			LogCallSite::ForEach([this](LogCallSite& site) { ReportCallSite(site); });
+			AddEntry(LOG_LEVEL::LOG_INFO, mUser, "Closing.");
+		}
+
+		uint64_t writtenBefore = mEntriesWritten.load();
+		uint64_t abandonedBefore = mAbandoned.load();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mShutdownDeadline = (deadlineMSecs == 0) ? 0 :
+				(std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMSecs)).time_since_epoch().count();
+			mRunning = false;
+			mStopped = true;
+		}
+		mQueueCv.notify_one();
+
+		if (mThread != nullptr)
+		{
+			mThread->join();
+			delete mThread;
+			mThread = nullptr;
+		}
+
+		if (mFileSink != nullptr)
+		{
+			mFileSink->Close();
+			delete mFileSink;
+			mFileSink = nullptr;
+		}
+
+		// The writer drained the spans on its way out
+		LogTrace::SetEnabled(false);
+		delete mTraceFile;
+		mTraceFile = nullptr;
+
+		delete mSharedRing;
+		mSharedRing = nullptr;
+
+		// The file is closed and synced, callbacks still waiting get their answer here
+		mCompletions.Dispatch(mWrittenSeq, mFailedSeq, true);
+
+		for (LogSink* sink : mSinks)
+		{
+			sink->Close();
+			delete sink;
+		}
+		mSinks.clear();
+
+		result.written = mEntriesWritten.load() - writtenBefore;
+		result.abandoned = mAbandoned.load() - abandonedBefore;
+		return result;
+	}
+
+	bool Log::SetShutdownDeadline(uint32_t msecs)
+	{
+		mShutdownMSecs = msecs;
+		return true;
+	}
+
+	void Log::ExitHook()
+	{
+		// Entries still queued at exit() are drained here, static destructors may run next
+		if (mInstance != NULL)
+		{
+			mInstance->Shutdown(mInstance->mShutdownMSecs);
+		}
+	}
+
+	void Log::PrepareFork()
+	{
+		// Hold every lock a child could need, so none is copied mid update by another thread
+		mMutex.lock();
+		mForking = mInstance;
+		if (mForking != NULL)
+		{
+			mForking->mConfigMutex.lock();
+			mForking->mThreadMutex.lock();
+			LogPool::Instance()->Lock();
+			mForking->mDurableMutex.lock();
+			mForking->mCompletions.Lock();
+			LogTrace::Instance()->Lock();
+		}
+	}
+
+	void Log::AfterForkParent()
+	{
+		if (mForking != NULL)
+		{
+			LogTrace::Instance()->Unlock();
+			mForking->mCompletions.Unlock();
+			mForking->mDurableMutex.unlock();
+			LogPool::Instance()->Unlock();
+			mForking->mThreadMutex.unlock();
+			mForking->mConfigMutex.unlock();
+		}
+		mForking = NULL;
+		mMutex.unlock();
+	}
+
+	void Log::AfterForkChild()
+	{
+		Log* log = mForking;
+		AfterForkParent();
+		if (log == NULL)
+		{
+			return;
+		}
+
+		// Only the forking thread exists here. The writer, sink threads and config watcher
+		// stayed in the parent, so their objects are left alone rather than joined or closed.
+		std::lock_guard<std::mutex> lock(mMutex);
+		log->mThread = nullptr;
+		log->mFileSink = nullptr;
+		log->mTraceFile = nullptr;
+		log->mSinks.clear();
+		log->mSharedRing = nullptr;
+		log->mConfigThread = nullptr;
+		log->mConfigWatching = false;
+		log->mConfigTimer = TIMER_INVALID_HANDLE;
+		log->mSyncTimer = TIMER_INVALID_HANDLE;
+		log->mRunning = false;
+		log->mStopped = true;
+		log->mWriterDone = true;
+		LogTrace::SetEnabled(false);
+
+		// The parent writes these, the child starts with empty queues
+		for (std::vector<LogEntry>& queue : log->mQueues)
+		{
+			queue.clear();
+		}
+	}
+
+	Log::~Log()
+	{
+		Shutdown(mShutdownMSecs);
+
+		for (const std::pair<uint64_t, const LogConfig*>& retired : mRetiredConfigs)
+		{
+			delete retired.second;
+		}
+		delete mConfig.load();
+	}
+
+	Log::Log()
+	{
+		mThread = nullptr;
+		mOutputFile = "";
 		mRunning = false;
 		mUser = "";
+		mSequence = 0;
+		mWrittenSeq = 0;
+		mDurableSeq = 0;
+		mFailedSeq = 0;
+		mWriteErrors = 0;
+		mWriterDone = false;
+		mSyncRequestSeq = 0;
+		mFlushRequestSeq = 0;
+		mFileSink = nullptr;
+		mBackend = LOG_BACKEND::LOG_BACKEND_STREAM;
+		mCompressThreads = LOG_COMPRESS_THREADS;
+		mTimeIndex = false;
+		mTracing = false;
+		mTraceFile = nullptr;
+		mIndexMSecs = LOG_INDEX_BUCKET_MSECS;
+		mPoolBlocks = LOG_POOL_SLAB_BLOCKS;
+		mPoolLock = false;
+		LogClock::Calibrate();
+		mClockBase = LogClock::NowUSecs();
+		mSharedRing = nullptr;
+		mComponentCount = 0;
+		for (std::atomic<uint8_t>& levels : mComponentLevels)
+		{
+			levels.store(0);
+		}
+		mThreadNamesVersion = 0;
+		mWriterNamesVersion = 0;
+		mConfigThread = nullptr;
+		mConfigWatching = false;
+		mConfigTimer = TIMER_INVALID_HANDLE;
+		mConfigModified = 0;
+		mSyncTimer = TIMER_INVALID_HANDLE;
+		mSyncTimerMSecs = 0;
+		mSyncTick = false;
+		mStopped = false;
+		mShutdownMSecs = 0;
+		mShutdownDeadline = 0;
+		mEntriesWritten = 0;
+		mAbandoned = 0;
+
+		// Drain at exit and stop cleanly in forked children, registered once per process
+		static std::once_flag hooks;
+		std::call_once(hooks, []
+		{
+#ifndef _WIN32
+			pthread_atfork(&Log::PrepareFork, &Log::AfterForkParent, &Log::AfterForkChild);
+#endif
+			atexit(&Log::ExitHook);
+			LogCallSite::SetFlushHook(&Log::FlushCallSite);
+		});
+
+		LogConfig* config = new LogConfig;
+		config->consoleLevel = LOG_LEVEL::LOG_NONE;
+		config->fileLevel = LOG_LEVEL::LOG_NONE;
+		config->timestampLevel = LOG_TIME::LOG_NONE;
+		config->consoleEnabled = false;
+		config->fileEnabled = false;
+		config->syncMSecs = 1000;
+		config->syncBytes = 1024 * 1024;
+		config->priorityLanes = true;
+		config->sequencePrefix = false;
+		config->threadTag = false;
+		config->threadCpu = false;
+
+		// Errors are group committed, everything else is left to the OS by default
+		for (LOG_SYNC& policy : config->levelSync)
+		{
+			policy = LOG_SYNC::LOG_SYNC_NONE;
+		}
+		config->levelSync[static_cast<int>(LOG_LEVEL::LOG_ERROR)] = LOG_SYNC::LOG_SYNC_IMMEDIATE;
+		mConfig = config;
 	}
 }
\ No newline at end of file
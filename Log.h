@@ -19,24 +19,48 @@
 #if defined _WIN32
 #include	<windows.h>					// Windows necessary stuff
 #include	<direct.h>					// Make Directory
+#include	<io.h>						// Sync descriptor (_commit)
+#include	<fcntl.h>					// Open flags
+#include	<debugapi.h>				// Debug Message
 #else
 #include	<sys/types.h>
 #include	<sys/stat.h>
 #include	<unistd.h>
+#include	<fcntl.h>					// Sync descriptor (open)
+#include	<poll.h>					// Config watcher wake ups
+#endif
+#ifdef __linux__
+#include	<sys/inotify.h>				// Config file change notifications
+#include	<sched.h>					// sched_getcpu
 #endif
 //
 #include	<string>                    // Strings
 #include	<fstream>					// File Stream
 #include	<iostream>					// Input Output
 #include	<thread>					// Multithreading
-#include	<queue>						// Queue object to store pending log entries
+#include	<vector>					// Vector object to store pending log entries
 #include	<mutex>						// Mutex object to enable thread safe usage of the queue
+#include	<condition_variable>		// Wake the writer and durability waiters
+#include	<atomic>					// Sequence counters
 #include	<chrono>					// Timing for filename date/time
 #include	<cstring>					// C-Strings
 #include	<stdarg.h>					// Inbound Arguments
-#include	<debugapi.h>				// Debug Message
 #include	<map>						// Mapping enum to strings
+#include	<set>						// Components set by the config file
+#include	<functional>				// Config updates
 #include	"CPP_Timer/Timer.h"			// Timer class
+#include	"LogShared.h"				// Shared memory transport
+#include	"LogCallSite.h"				// Rate limiting and repeat collapsing
+#include	"LogSampler.h"				// Call site sampling
+#include	"LogConfig.h"				// Settings snapshot
+#include	"LogClock.h"				// Timestamp clock policy
+#include	"LogPool.h"					// Pooled entry text
+#include	"LogNotify.h"				// Durability callbacks
+#include	"LogTrace.h"				// Latency spans
+#if defined __cpp_impl_coroutine && __has_include(<coroutine>)
+#include	<coroutine>					// Durability awaitable
+#define		LOG_COROUTINES
+#endif
 //
 //	Defines:
 //          name                        reason defined
@@ -44,13 +68,10 @@
 #ifndef     CPP_LOGGER					// Define the cpp logger class. 
 #define     CPP_LOGGER
 //
-
-#if !defined CPP_TIMER && !defined OLD_TIMER
-#define		NO_TIMER
-#endif
-//
-// 
 constexpr int MAX_LOG_MESSAGE_LENGTH = 250;	//! Maximum Loggable Message Length
+constexpr int MAX_LOG_COMPONENTS = 256;		//! Maximum registered components
+constexpr int LOG_LANES = 3;				//! Writer queues - ERROR, WARN, everything else
+constexpr size_t LOG_LANE_SLICE = 1024;		//! Backlog entries written between urgent lane checks
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -74,6 +95,39 @@ namespace Essentials
 		LOG_USEC,
 	};
 
+	// Handle of a registered component (interned user name)
+	typedef uint16_t LOG_COMPONENT;
+	constexpr LOG_COMPONENT LOG_INVALID_COMPONENT = 0xFFFF;
+
+	// Durability policy applied to entries of a given level
+	enum class LOG_SYNC : const int
+	{
+		LOG_SYNC_NONE,					// Hand the data to the OS only
+		LOG_SYNC_PERIODIC,				// fdatasync every N msecs or N bytes
+		LOG_SYNC_IMMEDIATE,				// Group commit - sync the batch holding the entry
+	};
+
+	// A single pending file entry
+	struct LogEntry
+	{
+		uint64_t		seq;			// Sequence number, starts at 1
+		LOG_LEVEL		level;			// Level the entry was logged at
+		LogText			text;			// Formatted line without the newline
+		uint32_t		sampleRate = 1;	// Entry stands for this many calls
+		uint32_t		thread = 0;		// Compact id of the logging thread
+		int32_t			cpu = -1;		// CPU the entry was logged on, -1 if not captured
+	};
+
+	// What a shutdown did with the entries still queued
+	struct LogShutdownResult
+	{
+		uint64_t		written;		// Entries written while shutting down
+		uint64_t		abandoned;		// Entries dropped when the deadline passed
+	};
+
+	class LogSink;
+	enum class LOG_BACKEND : const int;
+
 	// A Map to convert an logging level value to a readable string.
 	static std::map<LOG_LEVEL, std::string> LevelMap
 	{
@@ -114,6 +168,14 @@ namespace Essentials
 		//! @return -1 on fail, 0 if already initialized, 1 if successful
 		int		Initialize(std::string filename, bool enableConsoleLogging = true, bool enableFileLogging = true);
 
+		//! @brief Starts logging into a shared memory ring drained by the LogCollector process
+		//!        instead of a file of our own. Not available on Windows.
+		//! @param channel - channel name the collector was started with.
+		//! @param ringBytes - size of this process's ring buffer.
+		//! @param enableConsoleLogging - true by default, enables or disables console logging.
+		//! @return -1 on fail, 0 if already initialized, 1 if successful
+		int		InitializeShared(std::string channel, size_t ringBytes = 4 * 1024 * 1024, bool enableConsoleLogging = true);
+
 		//! @brief Adds a message into the queue to be logged
 		//! @param level - Log level of the string.
 		//! @param level - LOG Level of the string.
@@ -122,9 +184,194 @@ namespace Essentials
 		//! @return false if failed, true if message was logged
 		bool	AddEntry(LOG_LEVEL level, std::string user, std::string format, ...);
 
+		//! @brief Adds a message through a rate limited call site, see LOG_RATE_LIMITED.
+		//!        Entries over the site's rate are dropped before formatting and a message
+		//!        identical to the site's previous one is only counted.
+		//! @param site - call site state.
+		//! @param level - LOG Level of the string.
+		//! @param user - User the message is coming from
+		//! @param format - formatted string to be logged. 
+		//! @return false if dropped or filtered, true if message was logged or collapsed
+		bool	AddEntry(LogCallSite& site, LOG_LEVEL level, std::string user, std::string format, ...);
+
+		//! @brief Adds a message for a registered component. The component's own levels
+		//!        are checked with a single load before anything is formatted.
+		//! @param component - handle from RegisterComponent.
+		//! @param level - LOG Level of the string.
+		//! @param format - formatted string to be logged. 
+		//! @return false if filtered or the handle is invalid, true if message was logged
+		bool	AddEntry(LOG_COMPONENT component, LOG_LEVEL level, const char* format, ...);
+
+		//! @brief Interns a user name, returning the same handle for the same name.
+		//! @param name - component name printed in its entries.
+		//! @return handle, LOG_INVALID_COMPONENT if MAX_LOG_COMPONENTS are registered
+		LOG_COMPONENT RegisterComponent(std::string name);
+
+		//! @brief Gives a component its own levels, replacing the global ones for it.
+		//! @param component - handle from RegisterComponent.
+		//! @param consoleLevel - Maximum level logged to console.
+		//! @param fileLevel - Maximum level logged to file.
+		//! @return false if the handle is invalid, true if set
+		bool	SetComponentLogLevel(LOG_COMPONENT component, LOG_LEVEL consoleLevel, LOG_LEVEL fileLevel);
+
+		//! @brief Makes a component follow the global levels again.
+		//! @param component - handle from RegisterComponent.
+		//! @return false if the handle is invalid, true if reset
+		bool	ResetComponentLogLevel(LOG_COMPONENT component);
+
+		//! @brief Adds a message kept by sampling, see the LOG_SAMPLE_ macros.
+		//! @param sampleRate - number of calls the entry stands for, recorded as [1/N].
+		//! @param level - LOG Level of the string.
+		//! @param user - User the message is coming from
+		//! @param format - formatted string to be logged. 
+		//! @return false if filtered, true if message was logged
+		bool	AddSampledEntry(uint32_t sampleRate, LOG_LEVEL level, std::string user, std::string format, ...);
+
 		//! @brief Writes out the log entries. 
 		void	WriteOut();
 
+		//! @brief Sequence number of the last file entry queued by the calling thread.
+		//! @return 0 if this thread has not queued a file entry
+		static uint64_t LastEntrySequence();
+
+		//! @brief Compact id of the calling thread, assigned on its first use and stable for its life.
+		//! @return thread id, starting at 1
+		static uint32_t ThreadId()
+		{
+			return (tThreadId != 0) ? tThreadId : AssignThreadId();
+		}
+
+		//! @brief Starts a latency span on the calling thread, recorded while tracing is on.
+		//! @param name - span name, not copied - pass a literal.
+		//! @param id - span id for a span that ends on another thread, 0 if it ends on this one.
+		static void BeginSpan(const char* name, uint64_t id = 0)
+		{
+			if (LogTrace::Enabled())
+			{
+				LogTrace::Record(name, id, LOG_SPAN::LOG_SPAN_BEGIN, ThreadId());
+			}
+		}
+
+		//! @brief Ends a span started by BeginSpan, with the same name and id.
+		//! @param name - span name, not copied - pass a literal.
+		//! @param id - id given to BeginSpan.
+		static void EndSpan(const char* name, uint64_t id = 0)
+		{
+			if (LogTrace::Enabled())
+			{
+				LogTrace::Record(name, id, LOG_SPAN::LOG_SPAN_END, ThreadId());
+			}
+		}
+
+		//! @brief Names the calling thread in file lines tagged with SetThreadTag.
+		//! @param name - name to show instead of the thread id.
+		void	SetThreadName(std::string name);
+
+		//! @brief Turn on/off tagging file lines with "{thread} " or "{thread@cpu} ".
+		//!		   Names are resolved by the writer, producers only record the id.
+		//! @param enable - tag lines with the thread ?
+		//! @param cpu - also record the CPU each entry was logged on ?
+		//! @return false if failed, true if set
+		bool	SetThreadTag(bool enable, bool cpu = false);
+
+		//! @brief Blocks until the entry with the given sequence has been handed to the OS.
+		//! @param seq - sequence to wait for, 0 waits for everything queued so far.
+		//! @return false if the writer is not running or a file write failed at or after the entry, true once written
+		bool	Flush(uint64_t seq = 0);
+
+		//! @brief Blocks until the entry with the given sequence is on disk, forcing a sync
+		//!        if the level policy would not otherwise sync it.
+		//! @param seq - sequence to wait for, 0 waits for everything queued so far.
+		//! @return false if the writer is not running or a file write or sync failed at or after the entry, true once durable
+		bool	WaitDurable(uint64_t seq = 0);
+
+		//! @brief Highest sequence known to be on disk, without waiting.
+		uint64_t DurableSequence() const { return mDurableSeq.load(); }
+
+		//! @brief Highest sequence of a write or sync that failed, entries up to it may be missing from the file.
+		//! @return 0 if nothing has failed
+		uint64_t FailedSequence() const { return mFailedSeq.load(); }
+
+		//! @brief Number of log file writes and syncs that failed so far.
+		uint64_t WriteErrors() const { return mWriteErrors.load(); }
+
+		//! @brief Handle for an event loop to poll - readable when a callback given to
+		//!		   OnDurable is due, then call DispatchCompletions. An eventfd on Linux.
+		//! @return descriptor, -1 where unsupported (call DispatchCompletions periodically)
+		int		CompletionHandle();
+
+		//! @brief Registers a callback for when an entry is on disk, forcing a sync like
+		//!        WaitDurable but without blocking. Callbacks only run in DispatchCompletions.
+		//! @param seq - sequence to wait for, 0 for everything queued so far.
+		//! @param callback - called with the sequence and whether it became durable.
+		//! @return false if the writer is not running, true if registered
+		bool	OnDurable(uint64_t seq, LogCompletion callback);
+
+		//! @brief Clears the completion handle and runs the callbacks that are due on the
+		//!		   calling thread. Callbacks still waiting when the logger stops run with false.
+		//! @return callbacks run
+		size_t	DispatchCompletions();
+
+		//! @brief Sets the durability policy for a log level.
+		//! @param level - level the policy applies to.
+		//! @param policy - none, periodic or immediate (group commit)
+		//! @return false if failed, true if set
+		bool	SetLevelDurability(LOG_LEVEL level, LOG_SYNC policy);
+
+		//! @brief Sets the thresholds used by the periodic durability policy.
+		//! @param msecs - maximum time between syncs, 0 to disable.
+		//! @param bytes - maximum unsynced bytes between syncs, 0 to disable.
+		//! @return false if both are disabled, true if set
+		bool	SetSyncInterval(uint32_t msecs, uint64_t bytes);
+
+		//! @brief Selects how the log file is written, must be called before Initialize.
+		//! @param backend - std::ofstream or the double-buffered raw descriptor writer.
+		//! @return false if already initialized, true if set
+		bool	SetFileBackend(LOG_BACKEND backend);
+
+		//! @brief Sets the helper threads compressing blocks for LOG_BACKEND_COMPRESSED,
+		//!		   must be called before Initialize.
+		//! @param threads - helper threads, 0 compresses on the writer thread.
+		//! @return false if already initialized or negative, true if set
+		bool	SetCompressThreads(int threads);
+
+		//! @brief Stops the logger - drains the queues in full batches, closes the file and
+		//!		   sinks and runs the waiting callbacks. Entries logged afterwards are dropped.
+		//! @param deadlineMSecs - entries still queued this long after the call are abandoned, 0 waits for all.
+		//! @return entries written and abandoned while shutting down
+		LogShutdownResult Shutdown(uint32_t deadlineMSecs = 0);
+
+		//! @brief Sets the deadline used when the logger shuts itself down, at exit() or on release.
+		//! @param msecs - time allowed to drain the queues, 0 waits for all.
+		//! @return true if set
+		bool	SetShutdownDeadline(uint32_t msecs);
+
+		//! @brief Turn on/off writing a sparse time index next to the log file (<file>.idx),
+		//!		   used by Tools/LogQuery to seek to a time window. Must be called before Initialize.
+		//! @param enable - write the index ?
+		//! @param bucketMSecs - time covered by one index record.
+		//! @return false if already initialized, true if set
+		bool	SetTimeIndex(bool enable, uint32_t bucketMSecs = 1000);
+
+		//! @brief Turn on/off writing the spans of BeginSpan/EndSpan to a Chrome trace event
+		//!		   file next to the log file (<file>.trace.json), viewable in chrome://tracing or
+		//!		   Perfetto. Must be called before Initialize.
+		//! @param enable - record and write spans ?
+		//! @return false if already initialized, true if set
+		bool	SetTracing(bool enable);
+
+		//! @brief Sizes the pool of record blocks holding queued entries, filled and faulted
+		//!		   in by Initialize. Must be called before Initialize.
+		//! @param blocks - blocks to preallocate, each holds one entry.
+		//! @param lockMemory - mlock the blocks so they are never paged out.
+		//! @return false if already initialized, true if set
+		bool	SetRecordPool(size_t blocks, bool lockMemory = false);
+
+		//! @brief Adds an output that receives every batch the file writer writes.
+		//! @param sink - sink to add, the logger takes ownership and deletes it on release.
+		//! @return false if failed, true if added
+		bool	AddSink(LogSink* sink);
+
 		//! @brief Sets the maximum logging level.
 		//! @param level - Maximum level to be logged to console.
 		//! @return false if failed, true if set
@@ -150,6 +397,29 @@ namespace Essentials
 		//! @return false if failed, true if set
 		bool	LogToFile(bool enable);
 
+		//! @brief Turn on/off separate writer queues for ERROR and WARN entries, so they
+		//!		   are written ahead of an INFO/DEBUG backlog. On by default.
+		//! @param enable - use the priority lanes ?
+		//! @return false if failed, true if set
+		bool	SetPriorityLanes(bool enable);
+
+		//! @brief Turn on/off prefixing file lines with "#<sequence> ", which restores the
+		//!		   logging order of lines the priority lanes wrote early.
+		//! @param enable - prefix lines ?
+		//! @return false if failed, true if set
+		bool	SetSequencePrefix(bool enable);
+
+		//! @brief Loads a configuration file and keeps watching it, applying every change
+		//!        without a restart. See LoadLogConfig for the file format.
+		//! @param path - configuration file to watch.
+		//! @return false if the file could not be loaded or is already watched, true if watching
+		bool	WatchConfig(std::string path);
+
+		//! @brief Re-reads the watched configuration file now. Keys the file does not set
+		//!        keep their current value, including ones changed by a setter meanwhile.
+		//! @return false if the file could not be loaded, true if applied
+		bool	ReloadConfig();
+
 	protected:
 	private:
 		//! @brief Hidden Constructor
@@ -158,19 +428,203 @@ namespace Essentials
 		//! @brief Hidden Deconstructor
 		~Log();
 
+		//! @brief Formats and logs a message, applying the call site limits if given.
+		bool	AddEntryV(const LogConfig* config, LogCallSite* site, uint32_t sampleRate, LOG_LEVEL level, const std::string& user, uint8_t levels, const char* format, va_list args);
+
+		//! @brief Writes the repeat and rate limit counts a call site has pending.
+		void	ReportCallSite(LogCallSite& site);
+
+		//! @brief Call site flush hook - reports a site's pending counts when it is destroyed.
+		static void FlushCallSite(LogCallSite& site);
+
+		//! @brief Sends a formatted message to the console and file outputs.
+		//! @param config - the snapshot the caller already holds a LogConfigRead on.
+		bool	Emit(const LogConfig* config, LOG_LEVEL level, const std::string& user, const char* ts, const char* msg, uint32_t sampleRate, bool toConsole, bool toFile);
+
+		//! @brief Gives the calling thread the next compact id.
+		static uint32_t AssignThreadId();
+
+		//! @brief CPU the calling thread is running on.
+		//! @return CPU number, -1 if unsupported
+		static int32_t CurrentCpu();
+
+		//! @brief Refreshes the writer's copy of the thread names if one was added, writer thread only.
+		void	RefreshWriterNames();
+
+		//! @brief Builds the "#seq " and "{thread} " prefixes of a file line, writer thread only.
+		void	PrefixLine(const LogConfig* config, LogEntry& entry);
+
+		//! @brief Whether any writer queue has entries, call with mMutex held.
+		bool	Queued() const;
+
+		//! @brief Writer queue used for a level, lower lanes are written first.
+		static int LaneOf(LOG_LEVEL level)
+		{
+			return (level == LOG_LEVEL::LOG_ERROR) ? 0 : (level == LOG_LEVEL::LOG_WARN) ? 1 : 2;
+		}
+
+		//! @brief Copies the global levels to every component without its own.
+		void	ApplyGlobalLevels();
+
+		//! @brief Publishes a modified copy of the current settings.
+		void	UpdateConfig(const std::function<void(LogConfig&)>& change);
+
+		//! @brief Applies the component levels of a loaded config file.
+		void	ApplyComponentConfig(const LogConfig& config);
+
+		//! @brief Config watcher thread - inotify on Linux, polling elsewhere.
+		void	WatchConfigFile();
+
+		//! @brief Polls the config file modification time from the timer thread.
+		void	PollConfigFile();
+
+		//! @brief Starts or restarts the periodic sync timer to match the settings.
+		void	ScheduleSyncTimer();
+
+		//! @brief atexit() handler - shuts the logger down within the shutdown deadline.
+		static void ExitHook();
+
+		//! @brief pthread_atfork() handlers - the logger locks are held across fork, and the
+		//!		   child starts stopped since the writer thread stays in the parent.
+		static void PrepareFork();
+		static void AfterForkParent();
+		static void AfterForkChild();
+
+		//! @brief Packs console and file levels into one byte, console in the high nibble.
+		static uint8_t PackLevels(LOG_LEVEL console, LOG_LEVEL file)
+		{
+			return static_cast<uint8_t>((static_cast<int>(console) << 4) | static_cast<int>(file));
+		}
+
 		static Log* mInstance;												// Instance of Logger
+		static Log* mForking;												// Instance locked across a fork
 		std::thread* mThread;												// Pointer to a thread object
-		std::queue<std::string> mQueue;										// Queue to store pending log entries
+		std::vector<LogEntry>	mQueues[LOG_LANES];							// Pending log entries by priority lane
+		std::vector<LogSink*>	mSinks;										// Additional outputs fed by the writer
 		static std::mutex		mMutex;										// Mutex for thread protection
-		LOG_LEVEL				mMaxConsoleLogLevel;						// Allowed Maximum Logging Level
-		LOG_LEVEL				mMaxFileLogLevel;							// Allowed Maximum Logging Level
-		LOG_TIME				mTimestampLevel;							// Allowed Maximum Timestamp level
-		bool					mConsoleOutputEnabled;						// Output to console enabled ? 
-		bool					mFileOutputEnabled;							// Output to file enabled ?
+		std::condition_variable	mQueueCv;									// Wakes the writer thread
+		std::mutex				mDurableMutex;								// Protects the written/durable progress
+		std::condition_variable	mDurableCv;									// Wakes Flush/WaitDurable callers
+		uint64_t				mSequence;									// Last sequence handed out
+		std::atomic<uint64_t>	mWrittenSeq;								// Last sequence handed to the OS
+		std::atomic<uint64_t>	mDurableSeq;								// Last sequence synced to disk
+		std::atomic<uint64_t>	mFailedSeq;									// Last sequence of a commit whose file write or sync failed
+		std::atomic<uint64_t>	mWriteErrors;								// File writes and syncs that failed
+		bool					mWriterDone;								// Writer thread has drained and exited
+		bool					mStopped;									// Shut down, file entries are dropped
+		uint32_t				mShutdownMSecs;								// Deadline used by exit and release
+		std::atomic<int64_t>	mShutdownDeadline;							// Steady clock time queued entries are abandoned, 0 if none
+		std::atomic<uint64_t>	mEntriesWritten;							// File entries written
+		std::atomic<uint64_t>	mAbandoned;									// File entries dropped by a shutdown deadline
+		LogCompletions			mCompletions;								// Callbacks waiting for durability
+		uint64_t				mSyncRequestSeq;							// Highest sequence a caller needs durable
+		uint64_t				mFlushRequestSeq;							// Highest sequence a caller needs written
+		LogSink*				mFileSink;									// Backend writing the log file
+		uint64_t				mClockBase;									// LogClock reading timestamps count from
+		LOG_BACKEND				mBackend;									// Backend used for the next file
+		int						mCompressThreads;							// Helper threads of the compressed backend
+		bool					mTimeIndex;									// Write a time index with the next file ?
+		bool					mTracing;									// Write a trace file with the next file ?
+		LogTraceFile*			mTraceFile;									// Spans written by the writer, if tracing
+		std::vector<LogSpanEvent> mTraceEvents;								// Writer's batch of drained spans
+		uint32_t				mIndexMSecs;								// Time index bucket length
+		size_t					mPoolBlocks;								// Record blocks to preallocate
+		bool					mPoolLock;									// Lock the record blocks in memory ?
+		LogSharedRing*			mSharedRing;								// Shared memory transport, if used
+		std::atomic<uint8_t>	mComponentLevels[MAX_LOG_COMPONENTS];		// Packed console/file levels per component
+		std::string				mComponentNames[MAX_LOG_COMPONENTS];		// Interned component names
+		bool					mComponentOverridden[MAX_LOG_COMPONENTS];	// Component has its own levels
+		std::atomic<size_t>		mComponentCount;							// Registered components
+		std::map<std::string, LOG_COMPONENT> mComponentIds;				// Name to handle lookup
+		std::atomic<const LogConfig*> mConfig;								// Current settings, replaced whole
+		std::vector<std::pair<uint64_t, const LogConfig*>> mRetiredConfigs;	// Replaced settings and the epoch readers may hold them in
+		std::mutex				mConfigMutex;								// Serializes settings changes
+		std::mutex				mReloadMutex;								// Serializes config file reloads
+		std::thread*			mConfigThread;								// Config file watcher
+		std::atomic<bool>		mConfigWatching;							// Watcher keeps running
+		TIMER_HANDLE			mConfigTimer;								// Config file poll without inotify
+		time_t					mConfigModified;							// Last seen config modification time
+		TIMER_HANDLE			mSyncTimer;									// Wakes the writer for periodic syncs
+		uint32_t				mSyncTimerMSecs;							// Period of the sync timer
+		bool					mSyncTick;									// A sync timer period elapsed
+		std::string				mConfigPath;								// Watched config file
+		static thread_local uint32_t tThreadId;								// Compact id of the calling thread, 0 until assigned
+		static std::atomic<uint32_t> mNextThreadId;							// Next compact thread id
+		std::mutex				mThreadMutex;								// Protects the thread names
+		std::vector<std::string> mThreadNames;								// Registered names by thread id
+		std::atomic<uint32_t>	mThreadNamesVersion;						// Bumped when a name is registered
+		std::vector<std::string> mWriterNames;								// Writer's copy of the thread names
+		uint32_t				mWriterNamesVersion;						// Version of the writer's copy
+		std::set<std::string>	mConfigComponents;							// Components given levels by the file
 		std::string				mOutputFile;								// Holds output file location.
+		std::string				mFilePath;									// Full path of the created file
 		bool					mRunning;									// Track if Logger is running
-		std::ofstream			mFile;										// File Stream To Write To
 		std::string				mUser;										// System User for Log information location
 	};
+
+#ifdef LOG_COROUTINES
+	// co_await LogDurable(seq) resumes the coroutine from DispatchCompletions once the
+	// entry is on disk, giving whether it became durable.
+	struct LogDurableAwaiter
+	{
+		Log*		log;
+		uint64_t	seq;
+		bool		durable = false;
+
+		bool await_ready()
+		{
+			durable = (seq != 0 && log->DurableSequence() >= seq);
+			return durable;
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			// Not suspended if the writer is not running, await_resume then gives false
+			return log->OnDurable(seq, [this, handle](uint64_t, bool ok)
+			{
+				durable = ok;
+				handle.resume();
+			});
+		}
+
+		bool await_resume() const { return durable; }
+	};
+
+	//! @brief Awaitable for an entry reaching the disk.
+	//! @param seq - sequence to wait for, usually Log::LastEntrySequence().
+	inline LogDurableAwaiter LogDurable(uint64_t seq)
+	{
+		return LogDurableAwaiter{ Log::GetInstance(), seq };
+	}
+#endif
+
+	// Span covering a scope - begins on construction and ends on destruction
+	class LogSpan
+	{
+	public:
+		//! @brief Constructor - begins the span.
+		//! @param name - span name, not copied - pass a literal.
+		//! @param id - span id, 0 for a span on this thread.
+		LogSpan(const char* name, uint64_t id = 0)
+		{
+			mName = name;
+			mId = id;
+			Log::BeginSpan(mName, mId);
+		}
+
+		//! @brief Deconstructor - ends the span.
+		~LogSpan()
+		{
+			Log::EndSpan(mName, mId);
+		}
+
+		LogSpan(const LogSpan&) = delete;
+		void operator=(const LogSpan&) = delete;
+
+	protected:
+	private:
+		const char*		mName;			// Span name
+		uint64_t		mId;			// Span id
+	};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCallSite.h
+//! 
+//! @brief		Per call site state used to rate limit log storms and collapse
+//!				repeated messages without taking a lock.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Lock free call site state
+#include	<chrono>					// Token bucket clock
+#include	<functional>				// Visiting every site
+#include	<mutex>						// Site registry
+#include	<string>					// Owner of the pending counts
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_CALL_SITE		// Define the call site class. 
+#define     CPP_LOGGER_CALL_SITE
+//
+constexpr uint64_t LOG_REPEAT_REPORT_NSECS = 1000000000ULL;	//! Longest a repeat storm goes unreported
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogCallSite
+	{
+	public:
+		//! @brief Constructor
+		//! @param perSecond - sustained entries per second allowed, 0 for no limit.
+		//! @param burst - entries allowed back to back before the rate applies.
+		LogCallSite(uint32_t perSecond, uint32_t burst)
+		{
+			mInterval = (perSecond > 0) ? 1000000000ULL / perSecond : 0;
+			mTolerance = mInterval * (burst > 0 ? burst - 1 : 0);
+			mTat.store(0);
+			mLastHash.store(0);
+			mRepeats.store(0);
+			mSuppressed.store(0);
+			mLastReport.store(0);
+			mOwned.store(false);
+			mLevel = 0;
+
+			// Registered so the counts still pending at shutdown can be written
+			std::lock_guard<std::mutex> lock(RegistryMutex());
+			mPrev = nullptr;
+			mNext = Head();
+			if (mNext != nullptr)
+			{
+				mNext->mPrev = this;
+			}
+			Head() = this;
+		}
+
+		//! @brief Deconstructor - hands pending counts to the flush hook and unregisters.
+		~LogCallSite()
+		{
+			std::lock_guard<std::mutex> lock(RegistryMutex());
+			if (FlushHook() != nullptr && HasPending())
+			{
+				FlushHook()(*this);
+			}
+			(mPrev != nullptr ? mPrev->mNext : Head()) = mNext;
+			if (mNext != nullptr)
+			{
+				mNext->mPrev = mPrev;
+			}
+		}
+
+		LogCallSite(const LogCallSite&) = delete;
+		void operator=(const LogCallSite&) = delete;
+
+		//! @brief Token bucket check done before any formatting. A single CAS on the
+		//!        theoretical arrival time (GCRA), counts a suppression when over the rate.
+		//! @return true if the entry may be logged
+		bool	Allow()
+		{
+			if (mInterval == 0)
+			{
+				return true;
+			}
+
+			uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+			uint64_t tat = mTat.load(std::memory_order_relaxed);
+			while (true)
+			{
+				uint64_t start = (tat > now) ? tat : now;
+				if (start - now > mTolerance)
+				{
+					mSuppressed.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				if (mTat.compare_exchange_weak(tat, start + mInterval, std::memory_order_relaxed))
+				{
+					return true;
+				}
+			}
+		}
+
+		//! @brief Records the hash of a formatted message.
+		//! @return true if it matches the previous message from this site, which is then counted
+		bool	IsRepeat(uint64_t hash)
+		{
+			if (mLastHash.exchange(hash, std::memory_order_relaxed) == hash)
+			{
+				mRepeats.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+			return false;
+		}
+
+		//! @brief Whether a repeat should write the pending counts now - the rate window reopened
+		//!		   after suppressing entries, or LOG_REPEAT_REPORT_NSECS passed since the last report.
+		//!		   Only one of the threads racing for a report gets true.
+		bool	ReportDue()
+		{
+			uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+			uint64_t last = mLastReport.load(std::memory_order_relaxed);
+			if (last == 0)
+			{
+				// The first repeat starts the report interval
+				mLastReport.compare_exchange_strong(last, now, std::memory_order_relaxed);
+				return mSuppressed.load(std::memory_order_relaxed) > 0;
+			}
+			if (mSuppressed.load(std::memory_order_relaxed) == 0 && now - last < LOG_REPEAT_REPORT_NSECS)
+			{
+				return false;
+			}
+			return mLastReport.compare_exchange_strong(last, now, std::memory_order_relaxed);
+		}
+
+		//! @brief Whether repeats or suppressions are waiting to be reported.
+		bool	HasPending() const
+		{
+			return mRepeats.load(std::memory_order_relaxed) > 0 || mSuppressed.load(std::memory_order_relaxed) > 0;
+		}
+
+		//! @brief Records the level and user the pending counts are reported under, from the first entry.
+		void	Own(int level, const std::string& user)
+		{
+			if (!mOwned.load(std::memory_order_acquire))
+			{
+				std::lock_guard<std::mutex> lock(RegistryMutex());
+				if (!mOwned.load(std::memory_order_relaxed))
+				{
+					mLevel = level;
+					mUser = user;
+					mOwned.store(true, std::memory_order_release);
+				}
+			}
+		}
+
+		//! @brief Level of the site's first entry, valid once Owned.
+		int		Level() const { return mLevel; }
+
+		//! @brief User of the site's first entry, valid once Owned.
+		const std::string& User() const { return mUser; }
+
+		//! @brief Whether Own has recorded a level and user.
+		bool	Owned() const { return mOwned.load(std::memory_order_acquire); }
+
+		//! @brief Runs a function on every live site, with the registry locked.
+		static void ForEach(const std::function<void(LogCallSite&)>& visit)
+		{
+			std::lock_guard<std::mutex> lock(RegistryMutex());
+			for (LogCallSite* site = Head(); site != nullptr; site = site->mNext)
+			{
+				visit(*site);
+			}
+		}
+
+		//! @brief Sets the function a site with pending counts calls when it is destroyed.
+		static void SetFlushHook(void (*hook)(LogCallSite&))
+		{
+			std::lock_guard<std::mutex> lock(RegistryMutex());
+			FlushHook() = hook;
+		}
+
+		//! @brief Returns and clears the number of collapsed repeats.
+		uint64_t TakeRepeats() { return mRepeats.exchange(0, std::memory_order_relaxed); }
+
+		//! @brief Returns and clears the number of rate limited entries.
+		uint64_t TakeSuppressed() { return mSuppressed.exchange(0, std::memory_order_relaxed); }
+
+		//! @brief FNV-1a hash of a formatted message.
+		static uint64_t Hash(const char* msg)
+		{
+			uint64_t hash = 14695981039346656037ULL;
+			while (*msg != '\0')
+			{
+				hash = (hash ^ static_cast<unsigned char>(*msg++)) * 1099511628211ULL;
+			}
+			return hash;
+		}
+
+	protected:
+	private:
+		static std::mutex& RegistryMutex()
+		{
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		static LogCallSite*& Head()
+		{
+			static LogCallSite* head = nullptr;
+			return head;
+		}
+
+		static void (*&FlushHook())(LogCallSite&)
+		{
+			static void (*hook)(LogCallSite&) = nullptr;
+			return hook;
+		}
+
+		uint64_t				mInterval;			// Nanoseconds per token
+		uint64_t				mTolerance;			// Burst allowance in nanoseconds
+		std::atomic<uint64_t>	mTat;				// Theoretical arrival time of the next entry
+		std::atomic<uint64_t>	mLastHash;			// Hash of the last formatted message
+		std::atomic<uint64_t>	mRepeats;			// Collapsed repeats since the last emit
+		std::atomic<uint64_t>	mSuppressed;		// Rate limited entries since the last emit
+		std::atomic<uint64_t>	mLastReport;		// When the pending counts were last written, 0 before the first repeat
+		std::atomic<bool>		mOwned;				// Level and user recorded ?
+		int						mLevel;				// LOG_LEVEL the counts are reported under
+		std::string				mUser;				// User the counts are reported under
+		LogCallSite*			mPrev;				// Registry links, guarded by RegistryMutex
+		LogCallSite*			mNext;
+	};
+}
+
+//! Logs through a call site local to the macro invocation. Entries past the rate
+//! are dropped before formatting, repeats of the same message are collapsed.
+#define LOG_RATE_LIMITED(log, level, user, perSecond, burst, ...)							\
+	do																						\
+	{																						\
+		static Essentials::LogCallSite _logCallSite((perSecond), (burst));					\
+		(log)->AddEntry(_logCallSite, (level), (user), __VA_ARGS__);						\
+	} while (0)
+
+#endif // CPP_LOGGER_CALL_SITE
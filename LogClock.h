@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogClock.h
+//!
+//! @brief		Compile time clock policies for message timestamps. Each
+//!				policy is a set of static inline functions, so the read
+//!				inlines into AddEntry with no singleton lookup.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<chrono>					// steady_clock and TSC calibration
+#include	<thread>					// TSC calibration sleep
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+#include	<intrin.h>					// __rdtsc
+#elif defined __x86_64__ || defined __i386__
+#include	<x86intrin.h>				// __rdtsc
+#endif
+#ifdef __linux__
+#include	<time.h>					// clock_gettime
+#endif
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_CLOCK			// Define the clock policies.
+#define     CPP_LOGGER_CLOCK
+//
+// Clock selection - define one of these before including Log.h, steady_clock otherwise.
+//		LOG_CLOCK_TSC		- cycle counter scaled to microseconds, needs an invariant TSC
+//		LOG_CLOCK_COARSE	- CLOCK_MONOTONIC_COARSE, tick resolution but no vDSO math
+//		LOG_CLOCK_NONE		- no timestamps at all, the formatting compiles out
+//
+constexpr int LOG_CLOCK_CALIBRATE_MSECS = 20;	//! TSC calibration window
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// No clock - timestamps compile out
+	struct LogClockNone
+	{
+		static constexpr bool			Enabled = false;
+		static constexpr const char*	Name = "NONE";
+
+		static void		Calibrate() {}
+		static uint64_t	NowUSecs() { return 0; }
+	};
+
+	// std::chrono::steady_clock - portable default
+	struct LogClockSteady
+	{
+		static constexpr bool			Enabled = true;
+		static constexpr const char*	Name = "STEADY";
+
+		static void		Calibrate() {}
+
+		static uint64_t	NowUSecs()
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	};
+
+	// CLOCK_MONOTONIC_COARSE - last scheduler tick, cheapest kernel clock, steady_clock off Linux
+	struct LogClockCoarse
+	{
+		static constexpr bool			Enabled = true;
+#ifdef __linux__
+		static constexpr const char*	Name = "MONOTONIC_COARSE";
+#else
+		static constexpr const char*	Name = "STEADY";
+#endif
+
+		static void		Calibrate() {}
+
+		static uint64_t	NowUSecs()
+		{
+#ifdef __linux__
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+			return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+#else
+			return LogClockSteady::NowUSecs();
+#endif
+		}
+	};
+
+	// Cycle counter - rdtsc on x86, the virtual counter on ARM64, steady_clock elsewhere
+	struct LogClockTsc
+	{
+		static constexpr bool			Enabled = true;
+		static constexpr const char*	Name = "TSC";
+
+		//! @brief Measures the counter rate against steady_clock. Call once before NowUSecs.
+		static void		Calibrate()
+		{
+			if (mUSecsPerTick != 0)
+			{
+				return;
+			}
+
+#if defined __aarch64__
+			uint64_t frequency;
+			asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+			mUSecsPerTick = 1000000.0 / frequency;
+#else
+			auto start = std::chrono::steady_clock::now();
+			uint64_t startTicks = Ticks();
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOG_CLOCK_CALIBRATE_MSECS));
+			uint64_t endTicks = Ticks();
+			auto end = std::chrono::steady_clock::now();
+
+			double usecs = std::chrono::duration<double, std::micro>(end - start).count();
+			mUSecsPerTick = (endTicks > startTicks) ? usecs / (endTicks - startTicks) : 1.0;
+#endif
+		}
+
+		//! @brief Raw counter value.
+		static uint64_t	Ticks()
+		{
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+			return __rdtsc();
+#elif defined __x86_64__ || defined __i386__
+			return __rdtsc();
+#elif defined __aarch64__
+			uint64_t ticks;
+			asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+			return ticks;
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		static uint64_t	NowUSecs()
+		{
+			return static_cast<uint64_t>(Ticks() * mUSecsPerTick);
+		}
+
+	protected:
+	private:
+		static inline double	mUSecsPerTick = 0;		// Calibrated counter period
+	};
+
+#if defined LOG_CLOCK_NONE
+	typedef LogClockNone	LogClock;
+#elif defined LOG_CLOCK_TSC
+	typedef LogClockTsc		LogClock;
+#elif defined LOG_CLOCK_COARSE
+	typedef LogClockCoarse	LogClock;
+#else
+	typedef LogClockSteady	LogClock;
+#endif
+}
+#endif // CPP_LOGGER_CLOCK
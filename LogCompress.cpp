@@ -0,0 +1,409 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCompress.cpp
+//!
+//! @brief		Implementation of the block codec and compressed file reader
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogCompress.h"				// Codec and format
+#include	<cstring>					// memcpy / memcmp
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// LZ4 block format limits - a match is at least 4 bytes, the last 5 bytes are always
+	// literals and the last match starts at least 12 bytes before the end.
+	static constexpr size_t MIN_MATCH = 4;
+	static constexpr size_t LAST_LITERALS = 5;
+	static constexpr size_t MATCH_FIND_LIMIT = 12;
+	static constexpr size_t MAX_DISTANCE = 65535;
+
+	static inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - LOG_COMPRESS_HASH_BITS);
+	}
+
+	// Writes the 255 continuation bytes of a length that did not fit its 4 bit field
+	static inline uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = static_cast<uint8_t>(length);
+		return op;
+	}
+
+	size_t LogCompressBlock(const char* src, size_t length, char* dst, size_t capacity, uint32_t* table)
+	{
+		const uint8_t* base = reinterpret_cast<const uint8_t*>(src);
+		const uint8_t* end = base + length;
+		const uint8_t* anchor = base;
+		uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+		uint8_t* opEnd = op + capacity;
+
+		if (length > MATCH_FIND_LIMIT)
+		{
+			const uint8_t* matchStartLimit = end - MATCH_FIND_LIMIT;
+			const uint8_t* matchEndLimit = end - LAST_LITERALS;
+			const uint8_t* ip = base + 1;
+			memset(table, 0, LOG_COMPRESS_HASH_SIZE * sizeof(uint32_t));
+
+			while (ip <= matchStartLimit)
+			{
+				uint32_t sequence = Read32(ip);
+				uint32_t hash = Hash(sequence);
+				const uint8_t* candidate = base + table[hash];
+				table[hash] = static_cast<uint32_t>(ip - base);
+
+				if (candidate >= ip || static_cast<size_t>(ip - candidate) > MAX_DISTANCE || Read32(candidate) != sequence)
+				{
+					// Step further the longer nothing matched, text that will not compress goes fast
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				// Grow the match both ways
+				while (ip > anchor && candidate > base && ip[-1] == candidate[-1])
+				{
+					ip--;
+					candidate--;
+				}
+				const uint8_t* matchEnd = ip + MIN_MATCH;
+				const uint8_t* from = candidate + MIN_MATCH;
+				while (matchEnd < matchEndLimit && *matchEnd == *from)
+				{
+					matchEnd++;
+					from++;
+				}
+
+				size_t literals = ip - anchor;
+				size_t match = matchEnd - ip - MIN_MATCH;
+				if (static_cast<size_t>(opEnd - op) < 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1)
+				{
+					return 0;
+				}
+
+				uint8_t* token = op++;
+				*token = static_cast<uint8_t>(((literals >= 15) ? 15 : literals) << 4);
+				if (literals >= 15)
+				{
+					op = WriteLength(op, literals - 15);
+				}
+				memcpy(op, anchor, literals);
+				op += literals;
+
+				size_t distance = ip - candidate;
+				*op++ = static_cast<uint8_t>(distance);
+				*op++ = static_cast<uint8_t>(distance >> 8);
+
+				*token |= static_cast<uint8_t>((match >= 15) ? 15 : match);
+				if (match >= 15)
+				{
+					op = WriteLength(op, match - 15);
+				}
+
+				ip = matchEnd;
+				anchor = ip;
+				if (ip <= matchStartLimit)
+				{
+					table[Hash(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+				}
+			}
+		}
+
+		// Whatever is left goes out as literals
+		size_t literals = end - anchor;
+		if (static_cast<size_t>(opEnd - op) < 1 + literals / 255 + 1 + literals)
+		{
+			return 0;
+		}
+		uint8_t* token = op++;
+		*token = static_cast<uint8_t>(((literals >= 15) ? 15 : literals) << 4);
+		if (literals >= 15)
+		{
+			op = WriteLength(op, literals - 15);
+		}
+		memcpy(op, anchor, literals);
+		op += literals;
+
+		return op - reinterpret_cast<uint8_t*>(dst);
+	}
+
+	bool LogDecompressBlock(const char* src, size_t length, char* dst, size_t rawBytes)
+	{
+		const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+		const uint8_t* ipEnd = ip + length;
+		uint8_t* start = reinterpret_cast<uint8_t*>(dst);
+		uint8_t* op = start;
+		uint8_t* opEnd = op + rawBytes;
+
+		while (ip < ipEnd)
+		{
+			uint8_t token = *ip++;
+
+			size_t literals = token >> 4;
+			if (literals == 15)
+			{
+				uint8_t more;
+				do
+				{
+					if (ip >= ipEnd)
+					{
+						return false;
+					}
+					more = *ip++;
+					literals += more;
+				} while (more == 255);
+			}
+			if (literals > static_cast<size_t>(ipEnd - ip) || literals > static_cast<size_t>(opEnd - op))
+			{
+				return false;
+			}
+			memcpy(op, ip, literals);
+			op += literals;
+			ip += literals;
+
+			// The last sequence has no match
+			if (ip == ipEnd)
+			{
+				break;
+			}
+
+			if (ipEnd - ip < 2)
+			{
+				return false;
+			}
+			size_t distance = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if (distance == 0 || distance > static_cast<size_t>(op - start))
+			{
+				return false;
+			}
+
+			size_t match = token & 15;
+			if (match == 15)
+			{
+				uint8_t more;
+				do
+				{
+					if (ip >= ipEnd)
+					{
+						return false;
+					}
+					more = *ip++;
+					match += more;
+				} while (more == 255);
+			}
+			match += MIN_MATCH;
+			if (match > static_cast<size_t>(opEnd - op))
+			{
+				return false;
+			}
+
+			// Overlapping matches repeat the bytes just written, so copy forward a byte at a time
+			const uint8_t* from = op - distance;
+			if (distance >= match)
+			{
+				memcpy(op, from, match);
+				op += match;
+			}
+			else
+			{
+				for (size_t i = 0; i < match; ++i)
+				{
+					*op++ = *from++;
+				}
+			}
+		}
+
+		return op == opEnd;
+	}
+
+	// Seeks with 64 bit offsets, log files pass 2 GiB
+	static bool SeekFile(FILE* file, uint64_t offset, int origin)
+	{
+#ifdef _WIN32
+		return _fseeki64(file, static_cast<int64_t>(offset), origin) == 0;
+#else
+		return fseeko(file, static_cast<off_t>(offset), origin) == 0;
+#endif
+	}
+
+	LogCompressReader::LogCompressReader()
+	{
+		mFile = nullptr;
+		mOwned = false;
+		mClosed = false;
+		mCorrupt = false;
+		mPosition = 0;
+		mHeader = {};
+	}
+
+	LogCompressReader::~LogCompressReader()
+	{
+		if (mFile != nullptr && mOwned)
+		{
+			fclose(mFile);
+		}
+	}
+
+	bool LogCompressReader::OpenStream(FILE* stream)
+	{
+		mFile = stream;
+		mOwned = false;
+		mPosition = 0;
+		if (fread(&mHeader, sizeof(mHeader), 1, mFile) != 1 || memcmp(mHeader.magic, LOG_COMPRESS_MAGIC, sizeof(mHeader.magic)) != 0 ||
+			mHeader.format != LOG_COMPRESS_FORMAT)
+		{
+			return false;
+		}
+		mPosition = sizeof(mHeader);
+		return true;
+	}
+
+	bool LogCompressReader::Open(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		if (!OpenStream(file))
+		{
+			fclose(file);
+			mFile = nullptr;
+			return false;
+		}
+		mOwned = true;
+		mBlocks.clear();
+		mClosed = false;
+
+		// A closed file says where its index is
+		LogCompressTrailer trailer = {};
+		LogCompressFrame frame = {};
+		SeekFile(mFile, 0, SEEK_END);
+#ifdef _WIN32
+		uint64_t fileBytes = static_cast<uint64_t>(_ftelli64(mFile));
+#else
+		uint64_t fileBytes = static_cast<uint64_t>(ftello(mFile));
+#endif
+		if (fileBytes >= sizeof(mHeader) + sizeof(trailer) &&
+			SeekFile(mFile, fileBytes - sizeof(trailer), SEEK_SET) &&
+			fread(&trailer, sizeof(trailer), 1, mFile) == 1 &&
+			memcmp(trailer.magic, LOG_COMPRESS_END_MAGIC, sizeof(trailer.magic)) == 0 &&
+			SeekFile(mFile, trailer.indexOffset, SEEK_SET) &&
+			fread(&frame, sizeof(frame), 1, mFile) == 1 &&
+			frame.magic == LOG_COMPRESS_FRAME_MAGIC && frame.flags == static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_INDEX))
+		{
+			mBlocks.resize(frame.packedBytes / sizeof(LogCompressIndexRecord));
+			if (mBlocks.empty() || fread(mBlocks.data(), sizeof(LogCompressIndexRecord), mBlocks.size(), mFile) == mBlocks.size())
+			{
+				mClosed = true;
+			}
+		}
+
+		// Otherwise walk the frame headers, skipping their data
+		if (!mClosed)
+		{
+			mBlocks.clear();
+			uint64_t offset = sizeof(mHeader);
+			while (SeekFile(mFile, offset, SEEK_SET) && fread(&frame, sizeof(frame), 1, mFile) == 1 &&
+				frame.magic == LOG_COMPRESS_FRAME_MAGIC && frame.flags != static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_INDEX))
+			{
+				// A frame still being written is left for the next Open
+				if (offset + sizeof(frame) + frame.packedBytes > fileBytes)
+				{
+					break;
+				}
+				mBlocks.push_back({ offset, frame.rawOffset, frame.minSeq, frame.maxSeq, frame.packedBytes, frame.rawBytes });
+				offset += sizeof(frame) + frame.packedBytes;
+			}
+		}
+
+		Seek(sizeof(mHeader));
+		return true;
+	}
+
+	void LogCompressReader::Seek(uint64_t offset)
+	{
+		mPosition = offset;
+		SeekFile(mFile, offset, SEEK_SET);
+	}
+
+	bool LogCompressReader::ReadBlock(size_t block, std::string& text)
+	{
+		if (block >= mBlocks.size())
+		{
+			return false;
+		}
+
+		LogCompressFrame frame;
+		Seek(mBlocks[block].fileOffset);
+		return ReadNext(text, frame);
+	}
+
+	bool LogCompressReader::ReadNext(std::string& text, LogCompressFrame& frame)
+	{
+		mCorrupt = false;
+		if (mFile == nullptr)
+		{
+			return false;
+		}
+
+		size_t got = fread(&frame, 1, sizeof(frame), mFile);
+		if (got == sizeof(frame) && frame.magic == LOG_COMPRESS_FRAME_MAGIC && frame.flags != static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_INDEX))
+		{
+			mPacked.resize(frame.packedBytes);
+			got = fread(mPacked.data(), 1, frame.packedBytes, mFile);
+			if (got == frame.packedBytes)
+			{
+				mPosition += sizeof(frame) + frame.packedBytes;
+				mCorrupt = !Decode(frame, text);
+				return !mCorrupt;
+			}
+		}
+
+		// Leave a partial frame to be read again once the writer finishes it
+		if (mOwned)
+		{
+			clearerr(mFile);
+			Seek(mPosition);
+		}
+		return false;
+	}
+
+	bool LogCompressReader::Decode(const LogCompressFrame& frame, std::string& text)
+	{
+		text.resize(frame.rawBytes);
+		if (frame.flags == static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_STORED))
+		{
+			if (frame.packedBytes != frame.rawBytes)
+			{
+				return false;
+			}
+			memcpy(&text[0], mPacked.data(), frame.rawBytes);
+			return true;
+		}
+		return LogDecompressBlock(mPacked.data(), frame.packedBytes, &text[0], frame.rawBytes);
+	}
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCompress.h
+//!
+//! @brief		LZ4 style block codec and the framed file format written by
+//!				the compressed backend. Every block decodes on its own and
+//!				the file ends in an index of the blocks, so a reader can seek
+//!				to any of them without decoding the ones before it.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<cstddef>					// size_t
+#include	<cstdio>					// Reading compressed files
+#include	<string>					// Strings
+#include	<vector>					// Block index
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_COMPRESS			// Define the block codec and file format.
+#define     CPP_LOGGER_COMPRESS
+//
+constexpr char LOG_COMPRESS_MAGIC[8] = "LOGLZB1";				//! First bytes of a compressed log file
+constexpr char LOG_COMPRESS_END_MAGIC[8] = "LZBEND1";			//! Last bytes of a cleanly closed file
+constexpr const char* LOG_COMPRESS_EXTENSION = ".lzb";			//! Appended to the log file name
+constexpr uint32_t LOG_COMPRESS_FRAME_MAGIC = 0x464C5A42;		//! Start of every frame
+constexpr uint32_t LOG_COMPRESS_FORMAT = 2;						//! Format version written and read
+constexpr size_t LOG_COMPRESS_BLOCK_BYTES = 256 * 1024;			//! Text collected before a block is compressed
+constexpr int LOG_COMPRESS_HASH_BITS = 13;						//! Match finder table size, 32 KiB
+constexpr size_t LOG_COMPRESS_HASH_SIZE = size_t(1) << LOG_COMPRESS_HASH_BITS;
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Frame flags
+	enum class LOG_BLOCK : const uint32_t
+	{
+		LOG_BLOCK_COMPRESSED = 0,		// Block is LZ4 encoded
+		LOG_BLOCK_STORED = 1,			// Block did not shrink and is stored as is
+		LOG_BLOCK_INDEX = 2,			// Block index, the last frame of the file
+	};
+
+	// Start of a compressed log file, host byte order.
+	struct LogCompressHeader
+	{
+		char			magic[8];		// LOG_COMPRESS_MAGIC
+		uint32_t		format;			// LOG_COMPRESS_FORMAT
+		uint32_t		blockBytes;		// Block size the writer used
+	};
+
+	// Start of each frame, followed by packedBytes of data. Host byte order.
+	struct LogCompressFrame
+	{
+		uint32_t		magic;			// LOG_COMPRESS_FRAME_MAGIC
+		uint32_t		flags;			// LOG_BLOCK
+		uint32_t		packedBytes;	// Bytes following the frame header
+		uint32_t		rawBytes;		// Bytes of text once decoded
+		uint64_t		minSeq;			// Lowest sequence in the block - priority lanes write out of order
+		uint64_t		maxSeq;			// Highest sequence in the block
+		uint64_t		rawOffset;		// Offset of the block in the decoded text
+	};
+
+	// One block in the index frame. Host byte order.
+	struct LogCompressIndexRecord
+	{
+		uint64_t		fileOffset;		// File offset of the block's frame header
+		uint64_t		rawOffset;		// Offset of the block in the decoded text
+		uint64_t		minSeq;			// Lowest sequence in the block
+		uint64_t		maxSeq;			// Highest sequence in the block
+		uint32_t		packedBytes;	// Bytes following the frame header
+		uint32_t		rawBytes;		// Bytes of text once decoded
+	};
+
+	// Last bytes of a cleanly closed file, pointing back at the index frame.
+	struct LogCompressTrailer
+	{
+		uint64_t		indexOffset;	// File offset of the index frame header
+		char			magic[8];		// LOG_COMPRESS_END_MAGIC
+	};
+
+	//! @brief Largest encoding of a block, LogCompressBlock never needs more room.
+	//! @param rawBytes - block size.
+	inline size_t LogCompressBound(size_t rawBytes)
+	{
+		return rawBytes + rawBytes / 255 + 16;
+	}
+
+	//! @brief Encodes a block in the LZ4 block format.
+	//! @param src - text to encode.
+	//! @param length - bytes of text.
+	//! @param dst - output.
+	//! @param capacity - output size.
+	//! @param table - LOG_COMPRESS_HASH_SIZE entries of scratch, one per calling thread.
+	//! @return encoded size, 0 if it did not fit in capacity
+	size_t		LogCompressBlock(const char* src, size_t length, char* dst, size_t capacity, uint32_t* table);
+
+	//! @brief Decodes an LZ4 block, checking every length against both buffers.
+	//! @param src - encoded block.
+	//! @param length - bytes of the encoded block.
+	//! @param dst - output, rawBytes long.
+	//! @param rawBytes - decoded size recorded in the frame.
+	//! @return false if the block is corrupt
+	bool		LogDecompressBlock(const char* src, size_t length, char* dst, size_t rawBytes);
+
+	// Reads a compressed log file, from its index or frame by frame
+	class LogCompressReader
+	{
+	public:
+		//! @brief Constructor
+		LogCompressReader();
+
+		//! @brief Deconstructor
+		~LogCompressReader();
+
+		//! @brief Opens a file and loads its block index. A file still being written or
+		//!		   cut short has no index, its frames are walked to build one.
+		//! @param path - file to read.
+		//! @return false if the file is missing or not a compressed log
+		bool	Open(const std::string& path);
+
+		//! @brief Reads from a stream that cannot seek, such as stdin. Only ReadNext works.
+		//! @param stream - stream positioned at the file header.
+		//! @return false if the stream is not a compressed log
+		bool	OpenStream(FILE* stream);
+
+		//! @brief Blocks found by Open.
+		const std::vector<LogCompressIndexRecord>& Blocks() const { return mBlocks; }
+
+		//! @brief Whether Open found the index written on close.
+		bool	Closed() const { return mClosed; }
+
+		//! @brief Decodes one block from the index.
+		//! @param block - index into Blocks().
+		//! @param text - receives the decoded text.
+		//! @return false if the block could not be read or is corrupt
+		bool	ReadBlock(size_t block, std::string& text);
+
+		//! @brief Decodes the frame at the read position and moves past it.
+		//! @param text - receives the decoded text.
+		//! @param frame - receives the frame header.
+		//! @return false at the index frame, the end of the data or a partial frame
+		bool	ReadNext(std::string& text, LogCompressFrame& frame);
+
+		//! @brief Whether the last ReadNext or ReadBlock stopped at a block that failed to decode.
+		bool	Corrupt() const { return mCorrupt; }
+
+		//! @brief Moves the read position, after Open.
+		//! @param offset - file offset of a frame header.
+		void	Seek(uint64_t offset);
+
+		//! @brief File offset of the next frame ReadNext reads.
+		uint64_t Position() const { return mPosition; }
+
+	protected:
+	private:
+		//! @brief Decodes a frame's data into text.
+		bool	Decode(const LogCompressFrame& frame, std::string& text);
+
+		FILE*								mFile;			// File being read
+		bool								mOwned;			// Close mFile when done ?
+		bool								mClosed;		// Index came from the file ?
+		bool								mCorrupt;		// Last frame failed to decode ?
+		uint64_t							mPosition;		// Offset of the next frame
+		LogCompressHeader					mHeader;		// File header
+		std::vector<LogCompressIndexRecord>	mBlocks;		// Every block in the file
+		std::vector<char>					mPacked;		// Encoded bytes of the frame being read
+	};
+}
+#endif // CPP_LOGGER_COMPRESS
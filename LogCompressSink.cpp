@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCompressSink.cpp
+//!
+//! @brief		Implementation of the compressed log file backend
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogCompressSink.h"			// Compressed sink class
+#include	"LogFileSink.h"				// WriteAt / SyncDescriptor
+#include	<cstring>					// memcpy
+#ifdef _WIN32
+#include	<io.h>						// _open / _close
+#include	<fcntl.h>					// Open flags
+#else
+#include	<fcntl.h>					// open
+#include	<unistd.h>					// close
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogCompressSink::LogCompressSink(const std::string& path, int threads, size_t blockBytes)
+	{
+		mBlockBytes = blockBytes;
+		mMaxBlocks = (threads > 0) ? static_cast<size_t>(threads) * 2 + 2 : 1;
+		mFill = nullptr;
+		mRawOffset = 0;
+		mOffset = 0;
+		mWriting = false;
+		mStopping = false;
+		mErrors = 0;
+		mTable.resize(LOG_COMPRESS_HASH_SIZE);
+
+#ifdef _WIN32
+		mFd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+		mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		LogCompressHeader header = {};
+		memcpy(header.magic, LOG_COMPRESS_MAGIC, sizeof(header.magic));
+		header.format = LOG_COMPRESS_FORMAT;
+		header.blockBytes = static_cast<uint32_t>(mBlockBytes);
+		if (!WriteAt(mFd, reinterpret_cast<const char*>(&header), sizeof(header), 0))
+		{
+			++mErrors;
+		}
+		mOffset = sizeof(header);
+
+		for (int i = 0; i < threads; ++i)
+		{
+			mThreads.emplace_back(&LogCompressSink::CompressLoop, this);
+		}
+	}
+
+	LogCompressSink::~LogCompressSink()
+	{
+		Close();
+
+		for (Block* block : mBlocks)
+		{
+			delete block;
+		}
+	}
+
+	void LogCompressSink::Write(const std::vector<LogEntry>& batch)
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		for (const LogEntry& entry : batch)
+		{
+			// A block ends on a line boundary, a line longer than a block gets one of its own
+			if (mFill != nullptr && !mFill->raw.empty() && mFill->raw.size() + entry.text.size() + 1 > mBlockBytes)
+			{
+				Submit();
+			}
+			if (mFill == nullptr)
+			{
+				mFill = TakeBlock();
+				mFill->header.minSeq = entry.seq;
+				mFill->header.maxSeq = entry.seq;
+			}
+			mFill->header.minSeq = (entry.seq < mFill->header.minSeq) ? entry.seq : mFill->header.minSeq;
+			mFill->header.maxSeq = (entry.seq > mFill->header.maxSeq) ? entry.seq : mFill->header.maxSeq;
+
+			mFill->raw.append(entry.text.data(), entry.text.size());
+			mFill->raw.push_back('\n');
+		}
+	}
+
+	LogCompressSink::Block* LogCompressSink::TakeBlock()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (mFree.empty() && mBlocks.size() < mMaxBlocks)
+		{
+			Block* block = new Block;
+			block->raw.reserve(mBlockBytes);
+			mBlocks.push_back(block);
+			return block;
+		}
+
+		// Every block is in flight - the helpers are behind, wait for a write to free one
+		mCv.wait(lock, [this] { return !mFree.empty(); });
+		Block* block = mFree.back();
+		mFree.pop_back();
+		return block;
+	}
+
+	void LogCompressSink::Submit(bool here)
+	{
+		if (mFill == nullptr)
+		{
+			return;
+		}
+
+		Block* block = mFill;
+		mFill = nullptr;
+		block->done = false;
+		block->header.rawOffset = mRawOffset;
+		mRawOffset += block->raw.size();
+
+		if (here || mThreads.empty())
+		{
+			Compress(block, mTable.data());
+			std::unique_lock<std::mutex> lock(mMutex);
+			mOrder.push_back(block);
+			block->done = true;
+			WriteReady(lock);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mOrder.push_back(block);
+		mPending.push_back(block);
+		mCv.notify_all();
+	}
+
+	void LogCompressSink::Compress(Block* block, uint32_t* table)
+	{
+		LogCompressFrame& header = block->header;
+		size_t rawBytes = block->raw.size();
+		if (block->frame.size() < sizeof(header) + LogCompressBound(rawBytes))
+		{
+			block->frame.resize(sizeof(header) + LogCompressBound(rawBytes));
+		}
+
+		char* data = block->frame.data() + sizeof(header);
+		size_t packed = LogCompressBlock(block->raw.data(), rawBytes, data, rawBytes, table);
+		if (packed == 0)
+		{
+			// No smaller than the text, keep the text
+			memcpy(data, block->raw.data(), rawBytes);
+			packed = rawBytes;
+			header.flags = static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_STORED);
+		}
+		else
+		{
+			header.flags = static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_COMPRESSED);
+		}
+
+		header.magic = LOG_COMPRESS_FRAME_MAGIC;
+		header.packedBytes = static_cast<uint32_t>(packed);
+		header.rawBytes = static_cast<uint32_t>(rawBytes);
+		memcpy(block->frame.data(), &header, sizeof(header));
+	}
+
+	void LogCompressSink::WriteReady(std::unique_lock<std::mutex>& lock)
+	{
+		if (mWriting)
+		{
+			return;
+		}
+
+		mWriting = true;
+		while (!mOrder.empty() && mOrder.front()->done)
+		{
+			Block* block = mOrder.front();
+			mOrder.pop_front();
+			uint64_t offset = mOffset;
+			size_t bytes = sizeof(LogCompressFrame) + block->header.packedBytes;
+			mOffset += bytes;
+
+			// Write without the lock so helpers keep finishing blocks behind this one
+			lock.unlock();
+			if (!WriteAt(mFd, block->frame.data(), bytes, offset))
+			{
+				++mErrors;
+			}
+			lock.lock();
+
+			const LogCompressFrame& header = block->header;
+			mIndex.push_back({ offset, header.rawOffset, header.minSeq, header.maxSeq, header.packedBytes, header.rawBytes });
+			block->raw.clear();
+			mFree.push_back(block);
+			mCv.notify_all();
+		}
+		mWriting = false;
+		mCv.notify_all();
+	}
+
+	void LogCompressSink::CompressLoop()
+	{
+		std::vector<uint32_t> table(LOG_COMPRESS_HASH_SIZE);
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (true)
+		{
+			mCv.wait(lock, [this] { return !mPending.empty() || mStopping; });
+			if (mPending.empty())
+			{
+				break;
+			}
+
+			Block* block = mPending.front();
+			mPending.pop_front();
+			lock.unlock();
+			Compress(block, table.data());
+			lock.lock();
+
+			block->done = true;
+			WriteReady(lock);
+		}
+	}
+
+	void LogCompressSink::Flush()
+	{
+		// A partial block is compressed right here - handing a few lines to a helper and
+		// waiting for it costs more than the compression. Busy writers hand over full blocks.
+		Submit(true);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCv.wait(lock, [this] { return mOrder.empty() && !mWriting; });
+	}
+
+	bool LogCompressSink::Idle()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return (mFill == nullptr || mFill->raw.empty()) && mOrder.empty() && !mWriting;
+	}
+
+	void LogCompressSink::Sync()
+	{
+		Flush();
+		if (!SyncDescriptor(mFd))
+		{
+			++mErrors;
+		}
+	}
+
+	void LogCompressSink::Close()
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		Flush();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mCv.notify_all();
+		for (std::thread& thread : mThreads)
+		{
+			thread.join();
+		}
+		mThreads.clear();
+
+		// The index frame, then the trailer pointing back at it
+		LogCompressFrame header = {};
+		header.magic = LOG_COMPRESS_FRAME_MAGIC;
+		header.flags = static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_INDEX);
+		header.packedBytes = static_cast<uint32_t>(mIndex.size() * sizeof(LogCompressIndexRecord));
+		header.rawOffset = mRawOffset;
+
+		LogCompressTrailer trailer = {};
+		trailer.indexOffset = mOffset;
+		memcpy(trailer.magic, LOG_COMPRESS_END_MAGIC, sizeof(trailer.magic));
+
+		std::vector<char> tail(sizeof(header) + header.packedBytes + sizeof(trailer));
+		memcpy(tail.data(), &header, sizeof(header));
+		if (!mIndex.empty())
+		{
+			memcpy(tail.data() + sizeof(header), mIndex.data(), header.packedBytes);
+		}
+		memcpy(tail.data() + sizeof(header) + header.packedBytes, &trailer, sizeof(trailer));
+		if (!WriteAt(mFd, tail.data(), tail.size(), mOffset) || !SyncDescriptor(mFd))
+		{
+			++mErrors;
+		}
+#ifdef _WIN32
+		_close(mFd);
+#else
+		close(mFd);
+#endif
+		mFd = -1;
+	}
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCompressSink.h
+//!
+//! @brief		Log file backend writing compressed blocks. The writer thread
+//!				only copies lines into a block, helper threads compress full
+//!				blocks and the frames go to the file in order, ending with a
+//!				block index on close. See LogCompress.h for the format.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Error count
+#include	<condition_variable>		// Helper thread hand off
+#include	<deque>						// Blocks in flight
+#include	<mutex>						// Helper thread hand off
+#include	<string>					// Strings
+#include	<thread>					// Helper threads
+#include	<vector>					// Block buffers and index
+#include	"LogSink.h"					// Sink interface
+#include	"LogCompress.h"				// Codec and format
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_COMPRESS_SINK	// Define the compressed file sink.
+#define     CPP_LOGGER_COMPRESS_SINK
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogCompressSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates the file, writes its header and starts the helpers.
+		//! @param path - file to create.
+		//! @param threads - helper threads, 0 compresses on the writer thread.
+		//! @param blockBytes - text collected before a block is compressed.
+		LogCompressSink(const std::string& path, int threads, size_t blockBytes = LOG_COMPRESS_BLOCK_BYTES);
+
+		//! @brief Deconstructor
+		~LogCompressSink();
+
+		//! @brief Copies lines into the fill block, handing full blocks to the helpers.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Closes the partial block and waits until every block is in the file.
+		void	Flush() override;
+
+		//! @brief Keeps the partial block open, so idle moments do not each cost a small block.
+		//! @return false while a block is open or not yet in the file
+		bool	Idle() override;
+
+		//! @brief Flushes then syncs the file to disk.
+		void	Sync() override;
+
+		//! @brief Flushes, stops the helpers, writes the block index and closes the file.
+		void	Close() override;
+
+		//! @brief Whether the file was created.
+		bool	IsOpen() const override { return mFd >= 0; }
+
+		//! @brief Number of frame writes or syncs that failed.
+		uint64_t Errors() const override { return mErrors.load(); }
+
+	protected:
+	private:
+		// A block on its way to the file
+		struct Block
+		{
+			std::string			raw;			// Newline terminated lines
+			std::vector<char>	frame;			// Frame header and encoded data
+			LogCompressFrame	header;			// Frame header being built
+			bool				done;			// Encoded and ready to write
+		};
+
+		//! @brief Takes a free block, waiting while the most blocks are in flight.
+		Block*	TakeBlock();
+
+		//! @brief Queues the fill block for compression.
+		//! @param here - compress on the calling thread instead of a helper.
+		void	Submit(bool here = false);
+
+		//! @brief Encodes a block into its frame, storing it as is if it does not shrink.
+		void	Compress(Block* block, uint32_t* table);
+
+		//! @brief Writes finished blocks in order. Only one thread writes at a time, call with mMutex held.
+		void	WriteReady(std::unique_lock<std::mutex>& lock);
+
+		//! @brief Helper thread - compresses queued blocks.
+		void	CompressLoop();
+
+		int									mFd;			// File descriptor
+		size_t								mBlockBytes;	// Text per block
+		size_t								mMaxBlocks;		// Blocks allowed in flight
+		Block*								mFill;			// Block being filled, nullptr if none
+		uint64_t							mRawOffset;		// Decoded offset of the fill block
+		uint64_t							mOffset;		// File offset of the next frame
+		std::vector<Block*>					mBlocks;		// Every block owned
+		std::vector<Block*>					mFree;			// Blocks ready for filling
+		std::deque<Block*>					mPending;		// Blocks waiting for a helper
+		std::deque<Block*>					mOrder;			// Blocks submitted and not yet written, in order
+		std::vector<LogCompressIndexRecord>	mIndex;			// Blocks written so far
+		std::vector<uint32_t>				mTable;			// Match finder scratch for the writer thread
+		bool								mWriting;		// A thread is writing frames
+		bool								mStopping;		// Helpers should exit
+		std::mutex							mMutex;			// Protects everything shared with the helpers
+		std::condition_variable				mCv;			// Wakes helpers and waiting writers
+		std::vector<std::thread>			mThreads;		// Helper threads
+		std::atomic<uint64_t>				mErrors;		// Failed writes and syncs, helpers write frames too
+	};
+}
+#endif // CPP_LOGGER_COMPRESS_SINK
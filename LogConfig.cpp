@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogConfig.cpp
+//! 
+//! @brief		Implementation of the log configuration file parser
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"Log.h"						// Log levels and maps
+#include	"LogConfig.h"				// Config snapshot
+#include	<algorithm>					// Upper casing
+#include	<cerrno>					// Number range errors
+#include	<cstdlib>					// Number parsing
+#include	<fstream>					// File reading
+#include	<mutex>						// Reader slot registry
+#include	<vector>					// Reader slots, configuration lines
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Epoch a reading thread started in, 0 while it is not reading
+	struct LogReaderSlot
+	{
+		std::atomic<uint64_t>	epoch{ 0 };		// Epoch of the outermost read
+		std::atomic<bool>		used{ true };	// Owned by a live thread
+	};
+
+	// The calling thread's slot, given back when the thread exits
+	struct LogReaderLocal
+	{
+		LogReaderSlot*	slot = nullptr;		// Slot taken on the first read
+		uint32_t		depth = 0;			// Nested reads
+
+		~LogReaderLocal()
+		{
+			if (slot != nullptr)
+			{
+				slot->epoch.store(0, std::memory_order_release);
+				slot->used.store(false, std::memory_order_release);
+				slot = nullptr;
+			}
+		}
+	};
+
+	static std::atomic<uint64_t> gReaderEpoch(1);				// Current epoch
+	static std::mutex gReaderMutex;								// Protects the slot list
+	static std::vector<LogReaderSlot*>* gReaderSlots = new std::vector<LogReaderSlot*>;	// Never freed, threads may outlive statics
+	static thread_local LogReaderLocal tReader;
+
+	void LogConfigReaders::Enter()
+	{
+		LogReaderLocal& local = tReader;
+		if (local.depth++ > 0)
+		{
+			return;
+		}
+
+		if (local.slot == nullptr)
+		{
+			// Reuse a slot of an exited thread before adding one
+			std::lock_guard<std::mutex> lock(gReaderMutex);
+			for (LogReaderSlot* slot : *gReaderSlots)
+			{
+				bool used = false;
+				if (slot->used.compare_exchange_strong(used, true))
+				{
+					local.slot = slot;
+					break;
+				}
+			}
+			if (local.slot == nullptr)
+			{
+				local.slot = new LogReaderSlot;
+				gReaderSlots->push_back(local.slot);
+			}
+		}
+
+		// The fence pairs with the one in OldestActive - either the scan sees this epoch,
+		// or the snapshot load that follows sees the newer snapshot
+		local.slot->epoch.store(gReaderEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	void LogConfigReaders::Exit()
+	{
+		LogReaderLocal& local = tReader;
+		if (--local.depth == 0)
+		{
+			local.slot->epoch.store(0, std::memory_order_release);
+		}
+	}
+
+	uint64_t LogConfigReaders::Advance()
+	{
+		return gReaderEpoch.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	uint64_t LogConfigReaders::OldestActive()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t oldest = UINT64_MAX;
+		std::lock_guard<std::mutex> lock(gReaderMutex);
+		for (LogReaderSlot* slot : *gReaderSlots)
+		{
+			uint64_t epoch = slot->epoch.load(std::memory_order_acquire);
+			if (epoch != 0 && epoch < oldest)
+			{
+				oldest = epoch;
+			}
+		}
+		return oldest;
+	}
+
+	// Removes surrounding whitespace
+	static std::string Trim(const std::string& text)
+	{
+		size_t start = text.find_first_not_of(" \t\r\n");
+		if (start == std::string::npos)
+		{
+			return "";
+		}
+		size_t end = text.find_last_not_of(" \t\r\n");
+		return text.substr(start, end - start + 1);
+	}
+
+	static std::string Upper(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)toupper(c); });
+		return text;
+	}
+
+	// Reverse lookup into one of the enum to string maps
+	template <typename T>
+	static bool FromMap(const std::map<T, std::string>& map, const std::string& name, T& value)
+	{
+		for (const auto& entry : map)
+		{
+			if (entry.second == Upper(name))
+			{
+				value = entry.first;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool ParseBool(const std::string& text, bool& value)
+	{
+		std::string upper = Upper(text);
+		if (upper == "ON" || upper == "TRUE" || upper == "1")
+		{
+			value = true;
+			return true;
+		}
+		if (upper == "OFF" || upper == "FALSE" || upper == "0")
+		{
+			value = false;
+			return true;
+		}
+		return false;
+	}
+
+	// Whole decimal number no larger than the limit, nothing else on the value
+	static bool ParseCount(const std::string& text, uint64_t limit, uint64_t& value)
+	{
+		if (text.empty() || !isdigit(static_cast<unsigned char>(text[0])))
+		{
+			return false;
+		}
+
+		errno = 0;
+		char* end = nullptr;
+		unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+		if (errno != 0 || *end != '\0' || parsed > limit)
+		{
+			return false;
+		}
+		value = parsed;
+		return true;
+	}
+
+	static bool ParseSync(const std::string& text, LOG_SYNC& value)
+	{
+		std::string upper = Upper(text);
+		if (upper == "NONE")
+		{
+			value = LOG_SYNC::LOG_SYNC_NONE;
+		}
+		else if (upper == "PERIODIC")
+		{
+			value = LOG_SYNC::LOG_SYNC_PERIODIC;
+		}
+		else if (upper == "IMMEDIATE")
+		{
+			value = LOG_SYNC::LOG_SYNC_IMMEDIATE;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadLogConfig(const std::string& path, std::vector<LogConfigLine>& lines, std::string& error)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			error = "unable to open " + path;
+			return false;
+		}
+
+		std::vector<LogConfigLine> read;
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+			line = Trim(line.substr(0, line.find('#')));
+			if (line.empty())
+			{
+				continue;
+			}
+
+			size_t equals = line.find('=');
+			if (equals == std::string::npos)
+			{
+				error = "line " + std::to_string(lineNumber) + ": expected key = value";
+				return false;
+			}
+			read.push_back(LogConfigLine{ lineNumber, Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), line });
+		}
+
+		lines.swap(read);
+		return true;
+	}
+
+	bool ApplyLogConfig(const std::vector<LogConfigLine>& lines, LogConfig& config, std::string& error)
+	{
+		LogConfig next = config;
+
+		// Component lines replace the previous set rather than adding to it, -1 follows the global level
+		std::map<std::string, std::pair<int, int>> components;
+
+		for (const LogConfigLine& line : lines)
+		{
+			const std::string& key = line.key;
+			const std::string& value = line.value;
+			bool valid = true;
+
+			if (key == "console_level")
+			{
+				valid = FromMap(LevelMap, value, next.consoleLevel);
+			}
+			else if (key == "file_level")
+			{
+				valid = FromMap(LevelMap, value, next.fileLevel);
+			}
+			else if (key == "timestamp")
+			{
+				valid = FromMap(TimeMap, value, next.timestampLevel);
+			}
+			else if (key == "console")
+			{
+				valid = ParseBool(value, next.consoleEnabled);
+			}
+			else if (key == "file")
+			{
+				valid = ParseBool(value, next.fileEnabled);
+			}
+			else if (key == "priority_lanes")
+			{
+				valid = ParseBool(value, next.priorityLanes);
+			}
+			else if (key == "sequence_prefix")
+			{
+				valid = ParseBool(value, next.sequencePrefix);
+			}
+			else if (key == "thread_tag")
+			{
+				valid = ParseBool(value, next.threadTag);
+			}
+			else if (key == "thread_cpu")
+			{
+				valid = ParseBool(value, next.threadCpu);
+			}
+			else if (key.compare(0, 5, "sync.") == 0)
+			{
+				LOG_LEVEL level = LOG_LEVEL::LOG_NONE;
+				valid = FromMap(LevelMap, key.substr(5), level) && ParseSync(value, next.levelSync[static_cast<int>(level)]);
+			}
+			else if (key == "sync_interval_ms")
+			{
+				uint64_t msecs = 0;
+				valid = ParseCount(value, UINT32_MAX, msecs);
+				if (valid)
+				{
+					next.syncMSecs = static_cast<uint32_t>(msecs);
+				}
+			}
+			else if (key == "sync_interval_bytes")
+			{
+				valid = ParseCount(value, UINT64_MAX, next.syncBytes);
+			}
+			else if (key.compare(0, 10, "component.") == 0)
+			{
+				std::string name = key.substr(10);
+				bool console = false;
+				if (name.size() > 8 && name.compare(name.size() - 8, 8, ".console") == 0)
+				{
+					name.resize(name.size() - 8);
+					console = true;
+				}
+
+				LOG_LEVEL level = LOG_LEVEL::LOG_NONE;
+				valid = !name.empty() && FromMap(LevelMap, value, level);
+				if (valid)
+				{
+					auto inserted = components.insert({ name, { -1, -1 } });
+					(console ? inserted.first->second.first : inserted.first->second.second) = static_cast<int>(level);
+				}
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid)
+			{
+				error = "line " + std::to_string(line.number) + ": invalid setting '" + line.text + "'";
+				return false;
+			}
+		}
+
+		next.components.clear();
+		for (const auto& component : components)
+		{
+			next.components[component.first] = {
+				(component.second.first < 0) ? next.consoleLevel : static_cast<LOG_LEVEL>(component.second.first),
+				(component.second.second < 0) ? next.fileLevel : static_cast<LOG_LEVEL>(component.second.second) };
+		}
+
+		config = next;
+		return true;
+	}
+
+	bool LoadLogConfig(const std::string& path, LogConfig& config, std::string& error)
+	{
+		std::vector<LogConfigLine> lines;
+		return ReadLogConfig(path, lines, error) && ApplyLogConfig(lines, config, error);
+	}
+}
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogConfig.h
+//! 
+//! @brief		Immutable snapshot of the logger's runtime settings and the 
+//!				parser for the live reload configuration file.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Reader epochs
+#include	<map>						// Component overrides
+#include	<string>					// Strings
+#include	<vector>					// Configuration file lines
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_CONFIG			// Define the log config snapshot. 
+#define     CPP_LOGGER_CONFIG
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	enum class LOG_LEVEL : const int;
+	enum class LOG_TIME : const int;
+	enum class LOG_SYNC : const int;
+
+	// Settings read by producers and the writer. A snapshot is never modified
+	// once published - changes publish a new copy.
+	struct LogConfig
+	{
+		LOG_LEVEL		consoleLevel;							// Maximum level logged to console
+		LOG_LEVEL		fileLevel;								// Maximum level logged to file
+		LOG_TIME		timestampLevel;							// Timestamp type
+		bool			consoleEnabled;							// Output to console enabled ?
+		bool			fileEnabled;							// Output to file enabled ?
+		LOG_SYNC		levelSync[5];							// Durability policy per level
+		uint32_t		syncMSecs;								// Periodic sync time threshold
+		uint64_t		syncBytes;								// Periodic sync size threshold
+		bool			priorityLanes;							// ERROR/WARN written ahead of the backlog ?
+		bool			sequencePrefix;							// Prefix file lines with their sequence ?
+		bool			threadTag;								// Tag file lines with the logging thread ?
+		bool			threadCpu;								// Include the CPU in the thread tag ?
+		std::map<std::string, std::pair<LOG_LEVEL, LOG_LEVEL>> components;	// Console/file levels by component name
+	};
+
+	// Threads reading a snapshot announce the epoch they started in, so a replaced
+	// snapshot is freed only once every thread that could still hold it has left.
+	// Reads nest and cost two stores and a fence, no lock.
+	class LogConfigReaders
+	{
+	public:
+		//! @brief Marks the calling thread as reading. Call before loading the snapshot pointer.
+		static void		Enter();
+
+		//! @brief Ends the read started by the matching Enter.
+		static void		Exit();
+
+		//! @brief Starts a new epoch. Call after publishing a new snapshot.
+		//! @return epoch in which readers may still hold the replaced snapshot
+		static uint64_t	Advance();
+
+		//! @brief Oldest epoch a thread is still reading in.
+		//! @return UINT64_MAX if no thread is reading
+		static uint64_t	OldestActive();
+	};
+
+	// Holds the calling thread in the reader set for a scope
+	class LogConfigRead
+	{
+	public:
+		LogConfigRead() { LogConfigReaders::Enter(); }
+		~LogConfigRead() { LogConfigReaders::Exit(); }
+
+		LogConfigRead(const LogConfigRead&) = delete;
+		void operator=(const LogConfigRead&) = delete;
+	};
+
+	// One "key = value" line of a configuration file
+	struct LogConfigLine
+	{
+		int				number;			// Line number, for errors
+		std::string		key;			// Setting name
+		std::string		value;			// Setting value
+		std::string		text;			// Whole line without the comment, for errors
+	};
+
+	//! @brief Reads the settings of a configuration file without applying them.
+	//! @param path - file to read.
+	//! @param lines - receives the settings in file order, left untouched on failure.
+	//! @param error - receives the first problem found.
+	//! @return false if the file could not be read or has a line without '='
+	bool	ReadLogConfig(const std::string& path, std::vector<LogConfigLine>& lines, std::string& error);
+
+	//! @brief Applies settings read by ReadLogConfig to a snapshot. Only the keys present
+	//!        change, except components, which replace the snapshot's whole set.
+	//! @param lines - settings to apply.
+	//! @param config - snapshot to update, left untouched on failure.
+	//! @param error - receives the first problem found.
+	//! @return false if a setting is unknown or its value invalid
+	bool	ApplyLogConfig(const std::vector<LogConfigLine>& lines, LogConfig& config, std::string& error);
+
+	//! @brief Reads a configuration file on top of an existing snapshot.
+	//!
+	//!	One "key = value" per line, '#' starts a comment. Keys:
+	//!		console_level, file_level			NONE, ERROR, WARN, INFO, DEBUG
+	//!		timestamp							NONE, MSEC, USEC
+	//!		console, file						on, off
+	//!		sync.<LEVEL>						none, periodic, immediate
+	//!		sync_interval_ms, sync_interval_bytes
+	//!		priority_lanes, sequence_prefix		on, off
+	//!		thread_tag, thread_cpu				on, off
+	//!		component.<name>					file level of a component
+	//!		component.<name>.console			console level of a component
+	//!
+	//! @param path - file to read.
+	//! @param config - snapshot to update, left untouched on failure.
+	//! @param error - receives the first problem found.
+	//! @return false if the file could not be read or has an invalid line
+	bool	LoadLogConfig(const std::string& path, LogConfig& config, std::string& error);
+}
+#endif // CPP_LOGGER_CONFIG
@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogFileSink.cpp
+//! 
+//! @brief		Implementation of the log file backends
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogFileSink.h"				// File sink classes
+#include	"LogUringSink.h"			// io_uring backend
+#include	"LogMmapSink.h"				// Memory mapped backend
+#include	"LogCompressSink.h"			// Compressed backend
+#include	<cstring>					// memcpy
+#include	<cstdlib>					// Aligned allocation
+#include	<cerrno>					// EINTR
+#ifdef _WIN32
+#include	<io.h>						// _open / _write / _commit
+#include	<fcntl.h>					// Open flags
+#include	<malloc.h>					// _aligned_malloc
+#else
+#include	<fcntl.h>					// open
+#include	<unistd.h>					// pwrite / fdatasync
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	bool SyncDescriptor(int fd)
+	{
+		if (fd < 0)
+		{
+			return true;
+		}
+
+#ifdef _WIN32
+		return _commit(fd) == 0;
+#elif defined __APPLE__
+		return fsync(fd) == 0;
+#else
+		return fdatasync(fd) == 0;
+#endif
+	}
+
+	bool WriteAt(int fd, const char* data, size_t length, uint64_t offset)
+	{
+		while (length > 0)
+		{
+#ifdef _WIN32
+			_lseeki64(fd, offset, SEEK_SET);
+			int written = _write(fd, data, (unsigned int)length);
+#else
+			ssize_t written = pwrite(fd, data, length, offset);
+#endif
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return false;
+			}
+
+			data += written;
+			length -= written;
+			offset += written;
+		}
+		return true;
+	}
+
+	LogSink* CreateFileSink(LOG_BACKEND backend, const std::string& path, int compressThreads)
+	{
+		switch (backend)
+		{
+		case LOG_BACKEND::LOG_BACKEND_IO_URING:
+		case LOG_BACKEND::LOG_BACKEND_IO_URING_DIRECT:
+		{
+			// Kernels or filesystems without io_uring or O_DIRECT get the blocking writer
+			LogSink* sink = new LogUringSink(path, backend == LOG_BACKEND::LOG_BACKEND_IO_URING_DIRECT);
+			if (sink->IsOpen())
+			{
+				return sink;
+			}
+			delete sink;
+			return new LogFdSink(path);
+		}
+		case LOG_BACKEND::LOG_BACKEND_MMAP:
+		{
+			LogSink* sink = new LogMmapSink(path);
+			if (sink->IsOpen())
+			{
+				return sink;
+			}
+			delete sink;
+			return new LogFdSink(path);
+		}
+		case LOG_BACKEND::LOG_BACKEND_COMPRESSED:
+			return new LogCompressSink(path, compressThreads);
+		case LOG_BACKEND::LOG_BACKEND_FD:
+			return new LogFdSink(path);
+		case LOG_BACKEND::LOG_BACKEND_STREAM:
+		default:
+			return new LogStreamSink(path);
+		}
+	}
+
+	LogStreamSink::LogStreamSink(const std::string& path)
+	{
+		mSyncFd = -1;
+		mErrors = 0;
+		mFile.open(path);
+		if (mFile.is_open())
+		{
+			// A second descriptor on the same file - syncing it flushes the data written through mFile
+#ifdef _WIN32
+			mSyncFd = _open(path.c_str(), _O_WRONLY);
+#else
+			mSyncFd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+#endif
+		}
+	}
+
+	LogStreamSink::~LogStreamSink()
+	{
+		Close();
+	}
+
+	void LogStreamSink::Write(const std::vector<LogEntry>& batch)
+	{
+		for (const LogEntry& entry : batch)
+		{
+			mFile.write(entry.text.data(), entry.text.size());
+			mFile.put('\n');
+		}
+	}
+
+	void LogStreamSink::Flush()
+	{
+		// A failed write leaves the stream failed, counted once and cleared so later entries still go out
+		if (!mFile.flush())
+		{
+			++mErrors;
+			mFile.clear();
+		}
+	}
+
+	void LogStreamSink::Sync()
+	{
+		Flush();
+		if (!SyncDescriptor(mSyncFd))
+		{
+			++mErrors;
+		}
+	}
+
+	void LogStreamSink::Close()
+	{
+		if (mFile.is_open())
+		{
+			Sync();
+			mFile.close();
+		}
+
+		if (mSyncFd >= 0)
+		{
+#ifdef _WIN32
+			_close(mSyncFd);
+#else
+			close(mSyncFd);
+#endif
+			mSyncFd = -1;
+		}
+	}
+
+	LogFdSink::LogFdSink(const std::string& path)
+	{
+		mOffset = 0;
+#ifdef _WIN32
+		mFd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+		mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+		Start();
+	}
+
+	LogFdSink::LogFdSink(int fd, uint64_t offset)
+	{
+		mOffset = offset;
+		mFd = fd;
+		Start();
+	}
+
+	void LogFdSink::Start()
+	{
+		mFill = 0;
+		mFillBytes = 0;
+		mInFlight = -1;
+		mInFlightBytes = 0;
+		mEnd = mOffset;
+		mStopping = false;
+		mThread = nullptr;
+		mErrors = 0;
+
+#ifdef _WIN32
+		mBuffers[0] = static_cast<char*>(_aligned_malloc(LOG_WRITE_BUFFER_BYTES, LOG_WRITE_BUFFER_ALIGN));
+		mBuffers[1] = static_cast<char*>(_aligned_malloc(LOG_WRITE_BUFFER_BYTES, LOG_WRITE_BUFFER_ALIGN));
+#else
+		mBuffers[0] = static_cast<char*>(aligned_alloc(LOG_WRITE_BUFFER_ALIGN, LOG_WRITE_BUFFER_BYTES));
+		mBuffers[1] = static_cast<char*>(aligned_alloc(LOG_WRITE_BUFFER_ALIGN, LOG_WRITE_BUFFER_BYTES));
+#endif
+
+		if (mFd >= 0)
+		{
+			mThread = new std::thread(&LogFdSink::WriteLoop, this);
+		}
+	}
+
+	LogFdSink::~LogFdSink()
+	{
+		Close();
+
+#ifdef _WIN32
+		_aligned_free(mBuffers[0]);
+		_aligned_free(mBuffers[1]);
+#else
+		free(mBuffers[0]);
+		free(mBuffers[1]);
+#endif
+	}
+
+	void LogFdSink::Write(const std::vector<LogEntry>& batch)
+	{
+		for (const LogEntry& entry : batch)
+		{
+			Append(entry.text.data(), entry.text.size());
+		}
+	}
+
+	void LogFdSink::Append(const char* text, size_t length)
+	{
+		mEnd += length + 1;
+
+		// Copy the text in pieces if it straddles a buffer boundary
+		while (length + 1 > LOG_WRITE_BUFFER_BYTES - mFillBytes)
+		{
+			size_t part = LOG_WRITE_BUFFER_BYTES - mFillBytes;
+			part = (part < length) ? part : length;
+			memcpy(mBuffers[mFill] + mFillBytes, text, part);
+			mFillBytes += part;
+			text += part;
+			length -= part;
+			Submit();
+		}
+
+		memcpy(mBuffers[mFill] + mFillBytes, text, length);
+		mFillBytes += length;
+		mBuffers[mFill][mFillBytes++] = '\n';
+	}
+
+	void LogFdSink::Submit()
+	{
+		if (mFillBytes == 0 || mThread == nullptr)
+		{
+			mFillBytes = 0;
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCv.wait(lock, [this] { return mInFlight < 0; });
+
+		// The filled buffer goes out, the one just written becomes the fill buffer
+		mInFlight = static_cast<int>(mFill);
+		mInFlightBytes = mFillBytes;
+		mFill ^= 1;
+		mFillBytes = 0;
+		mCv.notify_all();
+	}
+
+	void LogFdSink::Flush()
+	{
+		Submit();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCv.wait(lock, [this] { return mInFlight < 0; });
+	}
+
+	void LogFdSink::Sync()
+	{
+		Flush();
+		if (!SyncDescriptor(mFd))
+		{
+			++mErrors;
+		}
+	}
+
+	void LogFdSink::Close()
+	{
+		if (mThread != nullptr)
+		{
+			Flush();
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			mCv.notify_all();
+			mThread->join();
+			delete mThread;
+			mThread = nullptr;
+		}
+
+		if (mFd >= 0)
+		{
+			SyncDescriptor(mFd);
+#ifdef _WIN32
+			_close(mFd);
+#else
+			close(mFd);
+#endif
+			mFd = -1;
+		}
+	}
+
+	void LogFdSink::WriteLoop()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (true)
+		{
+			mCv.wait(lock, [this] { return mInFlight >= 0 || mStopping; });
+			if (mInFlight < 0)
+			{
+				break;
+			}
+
+			// Write without the lock so the writer thread keeps filling the other buffer
+			const char* data = mBuffers[mInFlight];
+			size_t length = mInFlightBytes;
+			uint64_t offset = mOffset;
+			lock.unlock();
+
+			// The offset still moves on, so a failed buffer leaves a hole rather than shifting later ones
+			bool written = WriteAt(mFd, data, length, offset);
+
+			lock.lock();
+			if (!written)
+			{
+				++mErrors;
+			}
+			mOffset += length;
+			mInFlight = -1;
+			mCv.notify_all();
+		}
+	}
+}
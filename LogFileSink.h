@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogFileSink.h
+//! 
+//! @brief		Backends writing the log file itself - the original std::ofstream
+//!				path and a double-buffered raw file descriptor writer.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Error count
+#include	<condition_variable>		// I/O thread hand off
+#include	<fstream>					// File Stream
+#include	<mutex>						// I/O thread hand off
+#include	<string>					// Strings
+#include	<thread>					// I/O thread
+#include	"LogSink.h"					// Sink interface
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_FILE_SINK		// Define the file sink classes. 
+#define     CPP_LOGGER_FILE_SINK
+//
+constexpr size_t LOG_WRITE_BUFFER_BYTES = 1024 * 1024;		//! Size of each fd writer buffer
+constexpr size_t LOG_WRITE_BUFFER_ALIGN = 4096;				//! Alignment of the fd writer buffers
+constexpr int LOG_COMPRESS_THREADS = 2;						//! Helper threads of the compressed backend
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Backend used to write the log file
+	enum class LOG_BACKEND : const int
+	{
+		LOG_BACKEND_STREAM,				// std::ofstream, one stream write per entry
+		LOG_BACKEND_FD,					// Raw descriptor, double-buffered large writes
+		LOG_BACKEND_IO_URING,			// Linux io_uring, several writes in flight - falls back to FD
+		LOG_BACKEND_IO_URING_DIRECT,	// As IO_URING with O_DIRECT, bypassing the page cache
+		LOG_BACKEND_MMAP,				// Preallocated memory mapped file - falls back to FD
+		LOG_BACKEND_COMPRESSED,			// LZ4 style compressed blocks with a block index, see LogCompress.h
+	};
+
+	class LogStreamSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates the file.
+		//! @param path - file to create.
+		LogStreamSink(const std::string& path);
+
+		//! @brief Deconstructor
+		~LogStreamSink();
+
+		//! @brief Streams each entry followed by a newline.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Flushes the stream buffer to the OS.
+		void	Flush() override;
+
+		//! @brief Flushes then syncs the file to disk.
+		void	Sync() override;
+
+		//! @brief Closes the file.
+		void	Close() override;
+
+		//! @brief Whether the file was created.
+		bool	IsOpen() const override { return mFile.is_open(); }
+
+		//! @brief Number of flushes or syncs that failed.
+		uint64_t Errors() const override { return mErrors; }
+
+	protected:
+	private:
+		std::ofstream	mFile;											// File Stream To Write To
+		int				mSyncFd;										// Descriptor used for fdatasync
+		uint64_t		mErrors;										// Failed flushes and syncs
+	};
+
+	class LogFdSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates the file and starts the I/O thread.
+		//! @param path - file to create.
+		LogFdSink(const std::string& path);
+
+		//! @brief Constructor - takes over an open descriptor and starts the I/O thread.
+		//! @param fd - descriptor to write and close, a failed dup (-1) leaves the sink closed.
+		//! @param offset - file offset of the first write.
+		LogFdSink(int fd, uint64_t offset);
+
+		//! @brief Deconstructor
+		~LogFdSink();
+
+		//! @brief Copies entries into the fill buffer, handing full buffers to the I/O thread.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Copies one line into the fill buffer, as Write does for each entry.
+		//! @param text - line text without the newline.
+		//! @param length - number of bytes in text.
+		void	Append(const char* text, size_t length);
+
+		//! @brief Submits the partial fill buffer and waits for every write to finish.
+		void	Flush() override;
+
+		//! @brief Flushes then syncs the file to disk.
+		void	Sync() override;
+
+		//! @brief Flushes, stops the I/O thread and closes the file.
+		void	Close() override;
+
+		//! @brief Whether the file was created.
+		bool	IsOpen() const override { return mFd >= 0; }
+
+		//! @brief Number of writes or syncs that failed.
+		uint64_t Errors() const override { return mErrors.load(); }
+
+		//! @brief File offset just past the last line appended.
+		uint64_t End() const { return mEnd; }
+
+	protected:
+	private:
+		//! @brief Sets up the buffers and the I/O thread once mFd is open.
+		void	Start();
+
+		//! @brief Hands the fill buffer to the I/O thread, waiting if the other is still in flight.
+		void	Submit();
+
+		//! @brief I/O thread - writes submitted buffers at the tracked file offset.
+		void	WriteLoop();
+
+		int						mFd;									// File descriptor
+		char*					mBuffers[2];							// Aligned write buffers
+		size_t					mFill;									// Index of the buffer being filled
+		size_t					mFillBytes;								// Bytes in the fill buffer
+		int						mInFlight;								// Buffer being written, -1 if none
+		size_t					mInFlightBytes;							// Bytes in the in flight buffer
+		uint64_t				mOffset;								// File offset of the next write
+		uint64_t				mEnd;									// File offset past the last line appended
+		bool					mStopping;								// I/O thread should exit
+		std::mutex				mMutex;									// Protects the in flight state
+		std::condition_variable	mCv;									// Wakes the I/O and writer threads
+		std::thread*			mThread;								// I/O thread
+		std::atomic<uint64_t>	mErrors;								// Failed writes and syncs
+	};
+
+	//! @brief Pushes a descriptor's written data to the disk.
+	//! @param fd - descriptor to sync, ignored if negative.
+	//! @return false if the sync failed
+	bool		SyncDescriptor(int fd);
+
+	//! @brief Writes a whole buffer at an offset, retrying short writes.
+	//! @param fd - descriptor to write.
+	//! @param data - bytes to write.
+	//! @param length - number of bytes.
+	//! @param offset - file offset of the first byte.
+	//! @return true if every byte was written
+	bool		WriteAt(int fd, const char* data, size_t length, uint64_t offset);
+
+	//! @brief Creates the file sink for a backend.
+	//! @param backend - backend to use.
+	//! @param path - file to create.
+	//! @param compressThreads - helper threads of the compressed backend.
+	//! @return new sink, check IsOpen for success
+	LogSink*	CreateFileSink(LOG_BACKEND backend, const std::string& path, int compressThreads = LOG_COMPRESS_THREADS);
+}
+#endif // CPP_LOGGER_FILE_SINK
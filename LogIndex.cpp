@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogIndex.cpp
+//!
+//! @brief		Implementation of the log time index
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogIndex.h"				// Index classes
+#include	<chrono>					// Bucket wall clock
+#include	<cstring>					// memcpy / memcmp
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogIndexSink::LogIndexSink(const std::string& logPath, uint64_t wallBaseUSecs, uint32_t bucketMSecs)
+	{
+		mBucketUSecs = static_cast<uint64_t>(bucketMSecs > 0 ? bucketMSecs : LOG_INDEX_BUCKET_MSECS) * 1000;
+		mOffset = 0;
+		mBucket = LogIndexRecord{};
+
+		mFile = fopen((logPath + LOG_INDEX_EXTENSION).c_str(), "wb");
+		if (mFile != nullptr)
+		{
+			LogIndexHeader header = {};
+			memcpy(header.magic, LOG_INDEX_MAGIC, sizeof(header.magic));
+			header.format = static_cast<uint32_t>(LOG_INDEX_FORMAT::LOG_INDEX_TEXT);
+			header.bucketMSecs = static_cast<uint32_t>(mBucketUSecs / 1000);
+			header.wallBaseUSecs = wallBaseUSecs;
+			fwrite(&header, sizeof(header), 1, mFile);
+		}
+	}
+
+	LogIndexSink::~LogIndexSink()
+	{
+		Close();
+	}
+
+	void LogIndexSink::Write(const std::vector<LogEntry>& batch)
+	{
+		if (mFile == nullptr || batch.empty())
+		{
+			return;
+		}
+
+		// One clock read per batch - the bucket times only need to bracket their lines
+		uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		if (mBucket.lines > 0 && now >= mBucket.wallUSecs + mBucketUSecs)
+		{
+			EndBucket();
+		}
+
+		for (const LogEntry& entry : batch)
+		{
+			if (mBucket.lines > 0 && mOffset - mBucket.offset >= LOG_INDEX_BUCKET_BYTES)
+			{
+				EndBucket();
+			}
+
+			if (mBucket.lines == 0)
+			{
+				mBucket.wallUSecs = now;
+				mBucket.offset = mOffset;
+				mBucket.firstSeq = entry.seq;
+			}
+
+			mBucket.lines++;
+			mBucket.levels |= 1u << static_cast<int>(entry.level);
+			mOffset += entry.text.size() + 1;
+		}
+	}
+
+	void LogIndexSink::Flush()
+	{
+		// Not synced with the log - a query treats the file past the last record as one bucket
+		if (mFile != nullptr)
+		{
+			fflush(mFile);
+		}
+	}
+
+	void LogIndexSink::Close()
+	{
+		if (mFile != nullptr)
+		{
+			EndBucket();
+			fclose(mFile);
+			mFile = nullptr;
+		}
+	}
+
+	void LogIndexSink::EndBucket()
+	{
+		if (mBucket.lines > 0)
+		{
+			fwrite(&mBucket, sizeof(mBucket), 1, mFile);
+		}
+		mBucket = LogIndexRecord{};
+	}
+
+	bool ReadLogIndex(const std::string& path, LogIndexHeader& header, std::vector<LogIndexRecord>& records)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, LOG_INDEX_MAGIC, sizeof(header.magic)) == 0;
+		records.clear();
+
+		// A torn last record from a crash is dropped
+		LogIndexRecord record;
+		while (valid && fread(&record, sizeof(record), 1, file) == 1)
+		{
+			records.push_back(record);
+		}
+
+		fclose(file);
+		return valid;
+	}
+}
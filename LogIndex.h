@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogIndex.h
+//!
+//! @brief		A sparse sidecar index mapping time buckets and the levels
+//!				logged in them to byte offsets of the log file, so a query
+//!				can seek straight to a time window.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<cstdio>					// Index file
+#include	<string>					// Strings
+#include	<vector>					// Records
+#include	"LogSink.h"					// Sink interface
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_INDEX			// Define the time index.
+#define     CPP_LOGGER_INDEX
+//
+constexpr char LOG_INDEX_MAGIC[8] = "LOGIDX1";					//! First bytes of an index file
+constexpr const char* LOG_INDEX_EXTENSION = ".idx";				//! Appended to the log file name
+constexpr uint32_t LOG_INDEX_BUCKET_MSECS = 1000;				//! Default bucket length
+constexpr uint64_t LOG_INDEX_BUCKET_BYTES = 4ull * 1024 * 1024;	//! Bucket size cap, keeps busy seconds seekable
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Layout of the bytes the offsets point into
+	enum class LOG_INDEX_FORMAT : const uint32_t
+	{
+		LOG_INDEX_TEXT,					// Newline terminated lines
+	};
+
+	// Start of an index file, host byte order.
+	struct LogIndexHeader
+	{
+		char			magic[8];		// LOG_INDEX_MAGIC
+		uint32_t		format;			// LOG_INDEX_FORMAT of the log file
+		uint32_t		bucketMSecs;	// Bucket length the writer used
+		uint64_t		wallBaseUSecs;	// Wall clock, in usecs since the epoch, of line timestamp 0
+	};
+
+	// One bucket, written when the next one starts. Host byte order.
+	struct LogIndexRecord
+	{
+		uint64_t		wallUSecs;		// Wall clock the first batch of the bucket was written at
+		uint64_t		offset;			// Log file offset of the first line
+		uint64_t		firstSeq;		// Sequence of the first line
+		uint32_t		lines;			// Lines in the bucket
+		uint32_t		levels;			// Bit (1 << LOG_LEVEL) set for each level present
+	};
+
+	// Sink fed the same batches as the log file, tracking their offsets
+	class LogIndexSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates <logPath>.idx.
+		//! @param logPath - log file the offsets point into.
+		//! @param wallBaseUSecs - wall clock of line timestamp 0.
+		//! @param bucketMSecs - time covered by one record.
+		LogIndexSink(const std::string& logPath, uint64_t wallBaseUSecs, uint32_t bucketMSecs);
+
+		//! @brief Deconstructor
+		~LogIndexSink();
+
+		//! @brief Accounts for a batch, starting a record when the bucket is full.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Pushes finished records to the OS.
+		void	Flush() override;
+
+		//! @brief Writes the open bucket and closes the index.
+		void	Close() override;
+
+		//! @brief Is the index file open ?
+		bool	IsOpen() const override { return mFile != nullptr; }
+
+	protected:
+	private:
+		//! @brief Writes the open bucket as a record.
+		void	EndBucket();
+
+		FILE*			mFile;					// Index file
+		uint64_t		mBucketUSecs;			// Bucket length
+		uint64_t		mOffset;				// Log file bytes accounted for
+		LogIndexRecord	mBucket;				// Open bucket
+	};
+
+	//! @brief Reads an index file.
+	//! @param path - index file.
+	//! @param header - receives the header.
+	//! @param records - receives the records in file order.
+	//! @return false if the file is missing or not an index
+	bool	ReadLogIndex(const std::string& path, LogIndexHeader& header, std::vector<LogIndexRecord>& records);
+}
+#endif // CPP_LOGGER_INDEX
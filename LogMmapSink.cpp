@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogMmapSink.cpp
+//!
+//! @brief		Implementation of the memory mapped log file backend
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogMmapSink.h"				// Mapped file sink class
+#include	"LogFileSink.h"				// SyncDescriptor / fd writer
+#include	<cstring>					// memcpy
+#include	<cerrno>					// Error codes
+#ifndef _WIN32
+#include	<fcntl.h>					// open / fallocate
+#include	<unistd.h>					// ftruncate / sysconf / dup
+#include	<sys/mman.h>				// mmap / msync
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogMmapSink::LogMmapSink(const std::string& path)
+	{
+		mFd = -1;
+		mBase = nullptr;
+		mTail = 0;
+		mMapped = 0;
+		mDropped = 0;
+		mSyncErrors = 0;
+		mSynced = 0;
+		mFallback = nullptr;
+
+#ifndef _WIN32
+		// Reserve the address range up front so the base never moves while producers copy into it
+		void* base = mmap(nullptr, LOG_MMAP_RESERVE_BYTES, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (base == MAP_FAILED)
+		{
+			return;
+		}
+		mBase = static_cast<char*>(base);
+
+		mFd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (mFd < 0 || !Grow(1))
+		{
+			Close();
+		}
+#endif
+	}
+
+	LogMmapSink::~LogMmapSink()
+	{
+		Close();
+	}
+
+	void LogMmapSink::Write(const std::vector<LogEntry>& batch)
+	{
+		for (const LogEntry& entry : batch)
+		{
+			Append(entry.text.data(), entry.text.size());
+		}
+	}
+
+	bool LogMmapSink::Append(const char* text, size_t length)
+	{
+		if (mFd < 0)
+		{
+			++mDropped;
+			return false;
+		}
+
+		// A range is only claimed once it is mapped, so a failed Grow never leaves a gap
+		uint64_t offset = mTail.load(std::memory_order_relaxed);
+		while ((offset & LOG_MMAP_FAILED_OVER) == 0)
+		{
+			uint64_t end = offset + length + 1;
+			if (end > mMapped.load(std::memory_order_acquire) && !Grow(end))
+			{
+				FailOver();
+				break;
+			}
+
+			if (mTail.compare_exchange_weak(offset, end, std::memory_order_relaxed))
+			{
+				memcpy(mBase + offset, text, length);
+				mBase[offset + length] = '\n';
+				return true;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mFallbackMutex);
+		if (mFallback == nullptr || !mFallback->IsOpen())
+		{
+			++mDropped;
+			return false;
+		}
+		mFallback->Append(text, length);
+		return true;
+	}
+
+	void LogMmapSink::FailOver()
+	{
+#ifndef _WIN32
+		std::lock_guard<std::mutex> lock(mFallbackMutex);
+		uint64_t tail = mTail.fetch_or(LOG_MMAP_FAILED_OVER, std::memory_order_acq_rel);
+		if ((tail & LOG_MMAP_FAILED_OVER) == 0)
+		{
+			mFallback = new LogFdSink(dup(mFd), tail);
+		}
+#endif
+	}
+
+	uint64_t LogMmapSink::MappedEnd() const
+	{
+		uint64_t tail = mTail.load(std::memory_order_acquire) & ~LOG_MMAP_FAILED_OVER;
+		uint64_t mapped = mMapped.load(std::memory_order_acquire);
+		return (tail < mapped) ? tail : mapped;
+	}
+
+	uint64_t LogMmapSink::Errors() const
+	{
+		std::lock_guard<std::mutex> lock(mFallbackMutex);
+		return mDropped.load() + mSyncErrors + ((mFallback != nullptr) ? mFallback->Errors() : 0);
+	}
+
+	void LogMmapSink::Flush()
+	{
+		std::lock_guard<std::mutex> lock(mFallbackMutex);
+		if (mFallback != nullptr)
+		{
+			mFallback->Flush();
+		}
+	}
+
+	bool LogMmapSink::Grow(uint64_t end)
+	{
+#ifndef _WIN32
+		std::lock_guard<std::mutex> lock(mGrowMutex);
+		uint64_t mapped = mMapped.load(std::memory_order_relaxed);
+		while (mapped < end)
+		{
+			if (mapped + LOG_MMAP_CHUNK_BYTES > LOG_MMAP_RESERVE_BYTES)
+			{
+				return false;
+			}
+
+			// Allocate real blocks so the metadata work happens once per chunk, not on every line
+#ifdef __linux__
+			int result = fallocate(mFd, 0, mapped, LOG_MMAP_CHUNK_BYTES);
+			if (result != 0 && errno == EOPNOTSUPP)
+			{
+				result = ftruncate(mFd, mapped + LOG_MMAP_CHUNK_BYTES);
+			}
+#else
+			int result = ftruncate(mFd, mapped + LOG_MMAP_CHUNK_BYTES);
+#endif
+			if (result != 0)
+			{
+				return false;
+			}
+
+			void* chunk = mmap(mBase + mapped, LOG_MMAP_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mFd, mapped);
+			if (chunk == MAP_FAILED)
+			{
+				return false;
+			}
+
+			mapped += LOG_MMAP_CHUNK_BYTES;
+			mMapped.store(mapped, std::memory_order_release);
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void LogMmapSink::Sync()
+	{
+#ifndef _WIN32
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		// msync needs a page aligned start, resync the partial page from last time
+		uint64_t tail = MappedEnd();
+		uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+		uint64_t start = mSynced & ~(page - 1);
+		if (tail > start)
+		{
+			if (msync(mBase + start, tail - start, MS_SYNC) != 0)
+			{
+				++mSyncErrors;
+			}
+			mSynced = tail;
+		}
+
+		std::lock_guard<std::mutex> lock(mFallbackMutex);
+		if (mFallback != nullptr)
+		{
+			mFallback->Sync();
+		}
+#endif
+	}
+
+	void LogMmapSink::Close()
+	{
+#ifndef _WIN32
+		if (mFd >= 0)
+		{
+			Sync();
+
+			// Drop the unused preallocation, the file ends after the fd writer's lines if it took over
+			uint64_t length = MappedEnd();
+			{
+				std::lock_guard<std::mutex> lock(mFallbackMutex);
+				if (mFallback != nullptr)
+				{
+					mFallback->Close();
+					length = mFallback->End();
+					delete mFallback;
+					mFallback = nullptr;
+				}
+			}
+			if (ftruncate(mFd, length) == 0)
+			{
+				SyncDescriptor(mFd);
+			}
+			close(mFd);
+			mFd = -1;
+		}
+
+		if (mBase != nullptr)
+		{
+			munmap(mBase, LOG_MMAP_RESERVE_BYTES);
+			mBase = nullptr;
+		}
+#endif
+	}
+}
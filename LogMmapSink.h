@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogMmapSink.h
+//! 
+//! @brief		Log file backend that preallocates the file in large chunks,
+//!				maps it and copies records straight into the mapping.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Tail offset
+#include	<mutex>						// Growing the mapping
+#include	<string>					// Strings
+#include	"LogSink.h"					// Sink interface
+#include	"LogFileSink.h"				// Fd writer used after a fail over
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_MMAP_SINK		// Define the mapped file sink class. 
+#define     CPP_LOGGER_MMAP_SINK
+//
+constexpr uint64_t LOG_MMAP_CHUNK_BYTES = 64ull * 1024 * 1024;		//! File growth and mapping step
+constexpr uint64_t LOG_MMAP_RESERVE_BYTES = (sizeof(void*) == 8) ?	//! Address space kept for the file
+	(64ull << 30) : (512ull << 20);
+constexpr uint64_t LOG_MMAP_FAILED_OVER = 1ull << 63;				//! Set in the tail once lines go to the fd writer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Once the file cannot grow - the reserved range is used up or the disk is full - the
+	// tail is closed and later lines go through a LogFdSink appending after the mapped ones,
+	// so the file never has a gap.
+	class LogMmapSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates the file and reserves address space for it.
+		//! @param path - file to create.
+		LogMmapSink(const std::string& path);
+
+		//! @brief Deconstructor
+		~LogMmapSink();
+
+		//! @brief Appends each entry followed by a newline.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Nothing to do for the mapping, which is already the page cache. Flushes the fd writer.
+		void	Flush() override;
+
+		//! @brief msyncs the pages written since the last sync, then syncs the fd writer.
+		void	Sync() override;
+
+		//! @brief Syncs, unmaps and truncates the file to the written length.
+		void	Close() override;
+
+		//! @brief Whether the file was created and mapped.
+		bool	IsOpen() const override { return mFd >= 0; }
+
+		//! @brief Failed syncs and fd writer errors, plus dropped lines.
+		uint64_t Errors() const override;
+
+		//! @brief Appends one line, safe to call from any number of threads.
+		//! @param text - line text without the newline.
+		//! @param length - number of bytes in text.
+		//! @return false if the line was dropped
+		bool	Append(const char* text, size_t length);
+
+		//! @brief Number of lines dropped, only when the fd writer could not be started either.
+		//! @return dropped line count
+		uint64_t Dropped() const { return mDropped; }
+
+		//! @brief Whether lines now go through the fd writer.
+		bool	FailedOver() const { return (mTail.load(std::memory_order_acquire) & LOG_MMAP_FAILED_OVER) != 0; }
+
+	protected:
+	private:
+		//! @brief Preallocates and maps chunks until the mapping covers an offset.
+		//! @param end - offset that must be mapped.
+		//! @return true if the mapping covers end
+		bool	Grow(uint64_t end);
+
+		//! @brief Closes the tail and starts the fd writer at the end of the mapped lines.
+		void	FailOver();
+
+		//! @brief End of the lines written through the mapping.
+		uint64_t MappedEnd() const;
+
+		int						mFd;									// File descriptor
+		char*					mBase;									// Start of the reserved address range
+		std::atomic<uint64_t>	mTail;									// Next free offset, claimed with a CAS, LOG_MMAP_FAILED_OVER once closed
+		std::atomic<uint64_t>	mMapped;								// Bytes of the file mapped at mBase
+		std::atomic<uint64_t>	mDropped;								// Lines that could not be written anywhere
+		uint64_t				mSyncErrors;							// Failed msyncs
+		uint64_t				mSynced;								// Offset synced up to
+		std::mutex				mGrowMutex;								// Serializes growing the file
+		mutable std::mutex		mFallbackMutex;							// Serializes the fd writer
+		LogFdSink*				mFallback;								// Writer after the fail over, nullptr before
+	};
+}
+#endif // CPP_LOGGER_MMAP_SINK
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogNotify.cpp
+//!
+//! @brief		Implementation of the completion queue
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogNotify.h"				// Completion queue
+#include	<vector>					// Callbacks due
+#ifdef __linux__
+#include	<sys/eventfd.h>				// eventfd
+#endif
+#ifndef _WIN32
+#include	<fcntl.h>					// Non blocking pipe
+#include	<unistd.h>					// read / write / close
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogCompletions::LogCompletions()
+	{
+		mNextDue = LOG_NOTHING_DUE;
+		mReadFd = -1;
+		mWriteFd = -1;
+	}
+
+	LogCompletions::~LogCompletions()
+	{
+#ifndef _WIN32
+		if (mReadFd >= 0)
+		{
+			close(mReadFd);
+		}
+		if (mWriteFd >= 0 && mWriteFd != mReadFd)
+		{
+			close(mWriteFd);
+		}
+#endif
+	}
+
+	int LogCompletions::Handle()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mReadFd >= 0)
+		{
+			return mReadFd;
+		}
+
+#if defined __linux__
+		mReadFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		mWriteFd = mReadFd;
+#elif !defined _WIN32
+		int fds[2];
+		if (pipe(fds) == 0)
+		{
+			for (int fd : fds)
+			{
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				fcntl(fd, F_SETFD, FD_CLOEXEC);
+			}
+			mReadFd = fds[0];
+			mWriteFd = fds[1];
+		}
+#endif
+
+		// Callbacks may already be waiting on a handle nobody could poll before
+		if (!mPending.empty())
+		{
+			Signal();
+		}
+		return mReadFd;
+	}
+
+	void LogCompletions::Add(uint64_t seq, LogCompletion callback)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending.emplace(seq, std::move(callback));
+		mNextDue = mPending.begin()->first;
+	}
+
+	void LogCompletions::Signal()
+	{
+#ifndef _WIN32
+		if (mWriteFd < 0)
+		{
+			return;
+		}
+
+		// A full pipe or a saturated counter is already readable, nothing is lost
+		uint64_t one = 1;
+#ifdef __linux__
+		ssize_t written = write(mWriteFd, &one, sizeof(one));
+#else
+		ssize_t written = write(mWriteFd, &one, 1);
+#endif
+		(void)written;
+#endif
+	}
+
+	size_t LogCompletions::Dispatch(uint64_t durable, uint64_t failed, bool stopped)
+	{
+		std::vector<std::pair<uint64_t, LogCompletion>> due;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+#ifndef _WIN32
+			if (mReadFd >= 0)
+			{
+				char drain[64];
+				while (read(mReadFd, drain, sizeof(drain)) > 0)
+				{
+				}
+			}
+#endif
+
+			auto end = stopped ? mPending.end() : mPending.upper_bound((durable > failed) ? durable : failed);
+			for (auto it = mPending.begin(); it != end; ++it)
+			{
+				due.emplace_back(it->first, std::move(it->second));
+			}
+			mPending.erase(mPending.begin(), end);
+			mNextDue = mPending.empty() ? LOG_NOTHING_DUE : mPending.begin()->first;
+		}
+
+		// Run without the lock, a callback may register the next one
+		for (auto& completion : due)
+		{
+			completion.second(completion.first, completion.first <= durable && completion.first > failed);
+		}
+		return due.size();
+	}
+}
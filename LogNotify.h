@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogNotify.h
+//!
+//! @brief		Completion callbacks keyed by entry sequence, run by the
+//!				application from its own event loop. The writer only makes
+//!				a pollable handle readable when a callback is due, so an
+//!				event loop learns about durability without blocking.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Next due sequence
+#include	<functional>				// Callbacks
+#include	<map>						// Pending callbacks by sequence
+#include	<mutex>						// Pending callbacks
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_NOTIFY			// Define the completion queue.
+#define     CPP_LOGGER_NOTIFY
+//
+constexpr uint64_t LOG_NOTHING_DUE = UINT64_MAX;	//! No callback is waiting
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	//! @brief Called once an entry is on disk.
+	//! @param seq - sequence the callback was registered for.
+	//! @param durable - false if the logger stopped before the entry was synced.
+	typedef std::function<void(uint64_t seq, bool durable)> LogCompletion;
+
+	class LogCompletions
+	{
+	public:
+		//! @brief Constructor
+		LogCompletions();
+
+		//! @brief Deconstructor - closes the handle.
+		~LogCompletions();
+
+		//! @brief Handle that turns readable when callbacks are due - an eventfd on Linux,
+		//!		   the read end of a pipe on other POSIX systems. Created on first use.
+		//! @return descriptor to poll, -1 where unsupported
+		int		Handle();
+
+		//! @brief Queues a callback.
+		//! @param seq - sequence to wait for.
+		//! @param callback - run by Dispatch once the sequence is durable.
+		void	Add(uint64_t seq, LogCompletion callback);
+
+		//! @brief Lowest sequence with a callback waiting, LOG_NOTHING_DUE if none.
+		uint64_t NextDue() const { return mNextDue.load(); }
+
+		//! @brief Makes the handle readable. Called by the writer when NextDue is reached.
+		void	Signal();
+
+		//! @brief Clears the handle and runs the callbacks that are due, on the calling thread.
+		//! @param durable - highest durable sequence.
+		//! @param failed - highest sequence of a failed write or sync, callbacks up to it run with durable = false.
+		//! @param stopped - the logger stopped, callbacks past durable run with durable = false.
+		//! @return callbacks run
+		size_t	Dispatch(uint64_t durable, uint64_t failed, bool stopped);
+
+		//! @brief Holds the pending callbacks still across fork.
+		void	Lock() { mMutex.lock(); }
+
+		//! @brief Releases Lock.
+		void	Unlock() { mMutex.unlock(); }
+
+	protected:
+	private:
+		std::mutex								mMutex;			// Protects the pending callbacks and handle
+		std::multimap<uint64_t, LogCompletion>	mPending;		// Callbacks by sequence
+		std::atomic<uint64_t>					mNextDue;		// Lowest pending sequence
+		int										mReadFd;		// Handle given out, -1 until created
+		int										mWriteFd;		// Signalled end, same as mReadFd for an eventfd
+	};
+}
+#endif // CPP_LOGGER_NOTIFY
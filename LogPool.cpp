@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogPool.cpp
+//!
+//! @brief		Implementation of the record pool
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogPool.h"					// Pool classes
+#include	<cstdlib>					// Slab allocation
+#ifdef _WIN32
+#include	<windows.h>					// VirtualAlloc / VirtualLock
+#else
+#include	<sys/mman.h>				// mmap / mlock
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	thread_local LogPool::Cache LogPool::tCache;
+
+	LogPool* LogPool::Instance()
+	{
+		static LogPool* pool = new LogPool;
+		return pool;
+	}
+
+	LogPool::LogPool()
+	{
+		mBlocks = 0;
+		mLocked = false;
+	}
+
+	LogPool::Cache::~Cache()
+	{
+		exited = true;
+		if (count > 0)
+		{
+			LogPool* pool = Instance();
+			std::lock_guard<std::mutex> lock(pool->mMutex);
+			pool->mFree.insert(pool->mFree.end(), blocks, blocks + count);
+			count = 0;
+		}
+	}
+
+	bool LogPool::Reserve(size_t blocks, bool lockMemory)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		bool locked = true;
+
+		if (lockMemory && !mLocked)
+		{
+			// Slabs from before the request get locked now, later ones as they are added
+			mLocked = true;
+			for (char* slab : mSlabs)
+			{
+#ifdef _WIN32
+				locked &= VirtualLock(slab, LOG_POOL_SLAB_BLOCKS * LOG_RECORD_BYTES) != 0;
+#else
+				locked &= mlock(slab, LOG_POOL_SLAB_BLOCKS * LOG_RECORD_BYTES) == 0;
+#endif
+			}
+		}
+
+		while (mBlocks < blocks)
+		{
+			size_t before = mSlabs.size();
+			Grow(LOG_POOL_SLAB_BLOCKS);
+			if (mSlabs.size() == before)
+			{
+				return false;
+			}
+		}
+
+		return locked;
+	}
+
+	void LogPool::Grow(size_t blocks)
+	{
+		size_t bytes = blocks * LOG_RECORD_BYTES;
+#ifdef _WIN32
+		char* slab = static_cast<char*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		if (slab == nullptr)
+		{
+			return;
+		}
+		if (mLocked)
+		{
+			VirtualLock(slab, bytes);
+		}
+#else
+		void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map == MAP_FAILED)
+		{
+			return;
+		}
+		char* slab = static_cast<char*>(map);
+		if (mLocked)
+		{
+			mlock(slab, bytes);
+		}
+#endif
+
+		// Touch every page now so the first entries through a block never take a page fault
+		memset(slab, 0, bytes);
+
+		mSlabs.push_back(slab);
+		mBlocks += blocks;
+		mFree.reserve(mBlocks);
+		for (size_t i = 0; i < blocks; ++i)
+		{
+			mFree.push_back(slab + i * LOG_RECORD_BYTES);
+		}
+	}
+
+	char* LogPool::Acquire()
+	{
+		Cache& cache = tCache;
+		if (cache.count == 0 && !cache.exited)
+		{
+			// Refill half the cache in one trip to the shared list
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mFree.empty())
+			{
+				Grow(LOG_POOL_SLAB_BLOCKS);
+				if (mFree.empty())
+				{
+					return nullptr;
+				}
+			}
+
+			size_t take = (mFree.size() < LOG_POOL_BATCH) ? mFree.size() : LOG_POOL_BATCH;
+			memcpy(cache.blocks, mFree.data() + mFree.size() - take, take * sizeof(char*));
+			mFree.resize(mFree.size() - take);
+			cache.count = take;
+		}
+
+		if (cache.count == 0)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mFree.empty())
+			{
+				return nullptr;
+			}
+			char* block = mFree.back();
+			mFree.pop_back();
+			return block;
+		}
+
+		return cache.blocks[--cache.count];
+	}
+
+	void LogPool::Release(char* block)
+	{
+		Cache& cache = tCache;
+		if (cache.exited)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFree.push_back(block);
+			return;
+		}
+
+		// The writer frees every block - it gives them back half a cache at a time
+		cache.blocks[cache.count++] = block;
+		if (cache.count == LOG_POOL_BATCH * 2)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFree.insert(mFree.end(), cache.blocks + LOG_POOL_BATCH, cache.blocks + cache.count);
+			cache.count = LOG_POOL_BATCH;
+		}
+	}
+
+	size_t LogPool::Blocks()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mBlocks;
+	}
+
+	void LogText::Assign(const char* text, size_t length)
+	{
+		mSize = length;
+		mPooled = (length <= LOG_RECORD_BYTES - LOG_RECORD_HEADROOM);
+		mBlock = mPooled ? LogPool::Instance()->Acquire() : nullptr;
+		if (mBlock == nullptr)
+		{
+			// Too long for a block or the pool could not grow
+			mPooled = false;
+			mBlock = new char[length + 1];
+			mData = mBlock;
+		}
+		else
+		{
+			mData = mBlock + LOG_RECORD_HEADROOM;
+		}
+
+		if (length > 0)
+		{
+			memcpy(mData, text, length);
+		}
+	}
+
+	void LogText::Take(LogText& other) noexcept
+	{
+		mBlock = other.mBlock;
+		mData = other.mData;
+		mSize = other.mSize;
+		mPooled = other.mPooled;
+		other.mBlock = nullptr;
+		other.mData = nullptr;
+		other.mSize = 0;
+		other.mPooled = false;
+	}
+
+	void LogText::Free() noexcept
+	{
+		if (mBlock != nullptr)
+		{
+			if (mPooled)
+			{
+				LogPool::Instance()->Release(mBlock);
+			}
+			else
+			{
+				delete[] mBlock;
+			}
+		}
+		mBlock = nullptr;
+		mData = nullptr;
+		mSize = 0;
+		mPooled = false;
+	}
+
+	void LogText::Prepend(const char* text, size_t length)
+	{
+		if (mBlock != nullptr && static_cast<size_t>(mData - mBlock) >= length)
+		{
+			mData -= length;
+			memcpy(mData, text, length);
+			mSize += length;
+			return;
+		}
+
+		// Not enough room in front - build the line again
+		std::string line(text, length);
+		line.append(data(), mSize);
+		Free();
+		Assign(line.data(), line.size());
+	}
+}
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogPool.h
+//!
+//! @brief		Fixed size record blocks for entry text. Producers take blocks
+//!				and the writer returns them through per thread caches that
+//!				trade with the shared pool a batch at a time, so steady state
+//!				logging never calls malloc or free.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<cstddef>					// size_t
+#include	<cstring>					// memcpy / strlen
+#include	<mutex>						// Shared free list
+#include	<string>					// Conversions
+#include	<vector>					// Free list and slabs
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_POOL				// Define the record pool.
+#define     CPP_LOGGER_POOL
+//
+constexpr size_t LOG_RECORD_BYTES = 512;		//! Bytes per record block
+constexpr size_t LOG_RECORD_HEADROOM = 64;		//! Space kept in front of the text for the line prefix
+constexpr size_t LOG_POOL_BATCH = 64;			//! Blocks moved between a thread cache and the pool at once
+constexpr size_t LOG_POOL_SLAB_BLOCKS = 4096;	//! Blocks added when the pool runs dry
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogPool
+	{
+	public:
+		//! @brief The process wide pool. Never destroyed, thread caches may outlive the logger.
+		static LogPool*	Instance();
+
+		//! @brief Grows the pool to at least the given number of blocks and faults every page in.
+		//! @param blocks - blocks to have ready.
+		//! @param lockMemory - mlock the blocks, now and when the pool grows later.
+		//! @return false if locking failed, the blocks are still usable
+		bool			Reserve(size_t blocks, bool lockMemory);
+
+		//! @brief Takes a block, from the calling thread's cache when it has one.
+		char*			Acquire();
+
+		//! @brief Returns a block to the calling thread's cache.
+		void			Release(char* block);
+
+		//! @brief Blocks owned by the pool, in use or free.
+		size_t			Blocks();
+
+		//! @brief Holds the free list still across fork.
+		void			Lock() { mMutex.lock(); }
+
+		//! @brief Releases Lock.
+		void			Unlock() { mMutex.unlock(); }
+
+	protected:
+	private:
+		// Blocks held by one thread, traded with the pool LOG_POOL_BATCH at a time
+		struct Cache
+		{
+			char*		blocks[LOG_POOL_BATCH * 2];
+			size_t		count = 0;
+			bool		exited = false;			// Thread is exiting, release straight to the pool
+
+			~Cache();
+		};
+
+		LogPool();
+
+		//! @brief Adds a slab of blocks to the free list. Called with mMutex held.
+		void			Grow(size_t blocks);
+
+		static thread_local Cache tCache;					// Calling thread's blocks
+		std::mutex				mMutex;						// Protects everything below
+		std::vector<char*>		mFree;						// Free blocks not in any cache
+		std::vector<char*>		mSlabs;						// Allocations holding the blocks
+		size_t					mBlocks;					// Blocks in all slabs
+		bool					mLocked;					// Lock new slabs in memory ?
+	};
+
+	// Text of a log entry, in a pool block when it fits and on the heap otherwise.
+	// The block keeps LOG_RECORD_HEADROOM free in front so the writer can prefix
+	// the line in place.
+	class LogText
+	{
+	public:
+		LogText() noexcept : mBlock(nullptr), mData(nullptr), mSize(0), mPooled(false) {}
+		LogText(const char* text, size_t length)		{ Assign(text, length); }
+		LogText(const char* text)						{ Assign(text, strlen(text)); }
+		LogText(const std::string& text)				{ Assign(text.data(), text.size()); }
+		LogText(const LogText& other)					{ Assign(other.mData, other.mSize); }
+		LogText(LogText&& other) noexcept				{ Take(other); }
+		~LogText()										{ Free(); }
+
+		LogText& operator=(const LogText& other)
+		{
+			if (this != &other)
+			{
+				Free();
+				Assign(other.mData, other.mSize);
+			}
+			return *this;
+		}
+
+		LogText& operator=(LogText&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Free();
+				Take(other);
+			}
+			return *this;
+		}
+
+		const char*	data() const	{ return (mData != nullptr) ? mData : ""; }
+		size_t		size() const	{ return mSize; }
+		bool		empty() const	{ return mSize == 0; }
+		std::string	str() const		{ return std::string(data(), mSize); }
+
+		//! @brief Puts text in front, in the block's headroom when it fits.
+		void		Prepend(const char* text, size_t length);
+
+	protected:
+	private:
+		void		Assign(const char* text, size_t length);
+		void		Take(LogText& other) noexcept;
+		void		Free() noexcept;
+
+		char*		mBlock;			// Pool block or heap allocation
+		char*		mData;			// Start of the text inside mBlock
+		size_t		mSize;			// Text length
+		bool		mPooled;		// mBlock came from the pool ?
+	};
+}
+#endif // CPP_LOGGER_POOL
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogSampler.h
+//! 
+//! @brief		Thread local sampling helpers for high frequency call sites.
+//!				A skipped call costs a thread local update and never formats
+//!				the message or touches the logger's mutex.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<chrono>					// Per second windows
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_SAMPLER			// Define the sampler helpers. 
+#define     CPP_LOGGER_SAMPLER
+//
+constexpr uint32_t LOG_SAMPLE_CLOCK_CALLS = 1024;	//! Over budget calls between clock reads once a window is full, power of two
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogSampler
+	{
+	public:
+		//! @brief Next value of this thread's xorshift64 generator.
+		static uint64_t	Random()
+		{
+			static thread_local uint64_t state = 0;
+			if (state == 0)
+			{
+				// Seed from the address of the thread local itself, distinct per thread
+				state = reinterpret_cast<uintptr_t>(&state) * 0x9E3779B97F4A7C15ULL | 1;
+			}
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return state;
+		}
+
+		//! @brief Converts a probability into a threshold for Random() >> 32.
+		static constexpr uint64_t Threshold(double probability)
+		{
+			return (probability >= 1.0) ? 0x100000000ULL : static_cast<uint64_t>(probability * 4294967296.0);
+		}
+
+		//! @brief Rate recorded for a probability sample.
+		static constexpr uint32_t Rate(double probability)
+		{
+			return (probability >= 1.0 || probability <= 0.0) ? 1 : static_cast<uint32_t>(1.0 / probability + 0.5);
+		}
+	};
+
+	// Per thread state of an at most K per second site
+	struct LogSampleWindow
+	{
+		uint64_t		windowEnd;		// NowMSec end of the current window
+		uint32_t		count;			// Calls seen in the current window
+		uint32_t		rate;			// Calls per kept entry in the previous window
+
+		//! @brief Counts a call and decides whether it is kept.
+		//! @param perSecond - entries kept per second on this thread, 0 keeps none.
+		bool	Take(uint32_t perSecond)
+		{
+			if (perSecond == 0)
+			{
+				return false;
+			}
+
+			if (windowEnd == 0)
+			{
+				windowEnd = NowMSec() + 1000;
+			}
+
+			if (++count <= perSecond)
+			{
+				return true;
+			}
+
+			// Over the budget the clock is read after 1, 2, 4 ... skipped calls, then every
+			// LOG_SAMPLE_CLOCK_CALLS. A storm pays a counter increment per call, a window reopens
+			// late by at most the time its skipped calls took or LOG_SAMPLE_CLOCK_CALLS calls.
+			uint32_t skipped = count - perSecond;
+			if ((skipped & (skipped - 1)) != 0 && (skipped & (LOG_SAMPLE_CLOCK_CALLS - 1)) != 0)
+			{
+				return false;
+			}
+
+			uint64_t now = NowMSec();
+			if (now < windowEnd)
+			{
+				return false;
+			}
+
+			rate = (count - 1 > perSecond) ? (count - 1 + perSecond - 1) / perSecond : 1;
+			windowEnd = now + 1000;
+			count = 1;
+			return true;
+		}
+
+		//! @brief Steady clock in milliseconds, read only on the calls that may end a window.
+		static uint64_t	NowMSec()
+		{
+			return std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	};
+}
+
+//! Keeps every Nth call on each thread.
+#define LOG_SAMPLE_EVERY_N(log, level, user, n, ...)										\
+	do																						\
+	{																						\
+		static thread_local uint32_t _logSampleCount = 0;									\
+		if (++_logSampleCount >= static_cast<uint32_t>(n))									\
+		{																					\
+			_logSampleCount = 0;															\
+			(log)->AddSampledEntry(static_cast<uint32_t>(n), (level), (user), __VA_ARGS__);	\
+		}																					\
+	} while (0)
+
+//! Keeps each call with a fixed probability using a thread local generator.
+#define LOG_SAMPLE_PROBABILITY(log, level, user, probability, ...)							\
+	do																						\
+	{																						\
+		if ((Essentials::LogSampler::Random() >> 32) < Essentials::LogSampler::Threshold(probability))	\
+		{																					\
+			(log)->AddSampledEntry(Essentials::LogSampler::Rate(probability), (level), (user), __VA_ARGS__);	\
+		}																					\
+	} while (0)
+
+//! Keeps at most K calls per second on each thread.
+#define LOG_SAMPLE_PER_SECOND(log, level, user, perSecond, ...)								\
+	do																						\
+	{																						\
+		static thread_local Essentials::LogSampleWindow _logSampleWindow = { 0, 0, 1 };		\
+		if (_logSampleWindow.Take(static_cast<uint32_t>(perSecond)))						\
+		{																					\
+			(log)->AddSampledEntry(_logSampleWindow.rate, (level), (user), __VA_ARGS__);	\
+		}																					\
+	} while (0)
+
+#endif // CPP_LOGGER_SAMPLER
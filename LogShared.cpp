@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogShared.cpp
+//! 
+//! @brief		Implementation of the shared memory log ring
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogShared.h"				// Shared ring class
+#include	<cstring>					// memcpy
+#include	<new>						// Placement new of the header
+#ifndef _WIN32
+#include	<sys/mman.h>				// shm_open / mmap
+#include	<sys/stat.h>				// fstat
+#include	<fcntl.h>					// Open flags
+#include	<unistd.h>					// ftruncate / getpid
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Rounds a record size up to the 8 byte record alignment
+	static inline uint64_t RecordSize(size_t length)
+	{
+		return (sizeof(LogRingRecord) + length + 7) & ~static_cast<uint64_t>(7);
+	}
+
+	LogSharedRing::LogSharedRing()
+	{
+		mHeader = nullptr;
+		mMappedBytes = 0;
+		mName = "";
+		mOwner = false;
+	}
+
+	LogSharedRing::~LogSharedRing()
+	{
+#ifndef _WIN32
+		if (mHeader != nullptr)
+		{
+			// Leave a non empty ring for the collector to drain, it unlinks it afterwards
+			if (mOwner)
+			{
+				mHeader->closed.store(1, std::memory_order_release);
+				if (mHeader->head.load() == mHeader->tail.load())
+				{
+					Unlink();
+				}
+			}
+			munmap(mHeader, mMappedBytes);
+		}
+#endif
+	}
+
+	std::string LogSharedRing::SegmentName(const std::string& channel, int pid)
+	{
+		return "/" + std::string(LOG_RING_PREFIX) + channel + "." + std::to_string(pid);
+	}
+
+	bool LogSharedRing::Create(const std::string& channel, size_t bytes)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		uint64_t capacity = 4096;
+		while (capacity < bytes)
+		{
+			capacity <<= 1;
+		}
+
+		mName = SegmentName(channel, getpid());
+		int fd = shm_open(mName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0666);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		mMappedBytes = offsetof(LogRingHeader, data) + capacity;
+		if (ftruncate(fd, mMappedBytes) != 0)
+		{
+			close(fd);
+			shm_unlink(mName.c_str());
+			return false;
+		}
+
+		void* map = mmap(nullptr, mMappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+		{
+			shm_unlink(mName.c_str());
+			return false;
+		}
+
+		mHeader = new (map) LogRingHeader();
+		mHeader->version = LOG_RING_VERSION;
+		mHeader->capacity = capacity;
+		mHeader->pid = getpid();
+		mHeader->closed.store(0);
+		mHeader->dropped.store(0);
+		mHeader->head.store(0);
+		mHeader->tail.store(0);
+
+		// Publish last so the collector never sees a half built header
+		std::atomic_thread_fence(std::memory_order_release);
+		mHeader->magic = LOG_RING_MAGIC;
+		mOwner = true;
+		return true;
+#endif
+	}
+
+	bool LogSharedRing::Attach(const std::string& name)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat st = { 0 };
+		if (fstat(fd, &st) != 0 || (size_t)st.st_size <= offsetof(LogRingHeader, data))
+		{
+			close(fd);
+			return false;
+		}
+
+		void* map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+		{
+			return false;
+		}
+
+		LogRingHeader* header = static_cast<LogRingHeader*>(map);
+		if (header->magic != LOG_RING_MAGIC || header->version != LOG_RING_VERSION ||
+			offsetof(LogRingHeader, data) + header->capacity > (size_t)st.st_size)
+		{
+			munmap(map, st.st_size);
+			return false;
+		}
+
+		mHeader = header;
+		mMappedBytes = st.st_size;
+		mName = name;
+		mOwner = false;
+		return true;
+#endif
+	}
+
+	bool LogSharedRing::Push(uint32_t level, uint64_t seq, uint64_t timestamp, const char* text, size_t length)
+	{
+		if (mHeader == nullptr)
+		{
+			return false;
+		}
+
+		const uint64_t capacity = mHeader->capacity;
+		const uint64_t size = RecordSize(length);
+		const uint64_t head = mHeader->head.load(std::memory_order_relaxed);
+		const uint64_t tail = mHeader->tail.load(std::memory_order_acquire);
+		const uint64_t offset = head & (capacity - 1);
+
+		// Records never straddle the end of the ring, pad to the start instead
+		uint64_t pad = (capacity - offset < size) ? capacity - offset : 0;
+		if (size > capacity / 2 || (head + pad + size) - tail > capacity)
+		{
+			mHeader->dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		if (pad > 0)
+		{
+			LogRingRecord* padding = reinterpret_cast<LogRingRecord*>(mHeader->data + offset);
+			padding->size = static_cast<uint32_t>(pad);
+			padding->level = LOG_RING_PAD;
+		}
+
+		LogRingRecord* record = reinterpret_cast<LogRingRecord*>(mHeader->data + ((head + pad) & (capacity - 1)));
+		record->size = static_cast<uint32_t>(size);
+		record->level = level;
+		record->timestamp = timestamp;
+		record->seq = seq;
+		record->length = static_cast<uint32_t>(length);
+		record->reserved = 0;
+		memcpy(record + 1, text, length);
+
+		mHeader->head.store(head + pad + size, std::memory_order_release);
+		return true;
+	}
+
+	const LogRingRecord* LogSharedRing::Peek()
+	{
+		if (mHeader == nullptr)
+		{
+			return nullptr;
+		}
+
+		const uint64_t capacity = mHeader->capacity;
+		uint64_t tail = mHeader->tail.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			const uint64_t head = mHeader->head.load(std::memory_order_acquire);
+			if (tail == head)
+			{
+				return nullptr;
+			}
+
+			const LogRingRecord* record = reinterpret_cast<const LogRingRecord*>(mHeader->data + (tail & (capacity - 1)));
+			if (record->level != LOG_RING_PAD)
+			{
+				return record;
+			}
+
+			tail += record->size;
+			mHeader->tail.store(tail, std::memory_order_release);
+		}
+	}
+
+	void LogSharedRing::Release(const LogRingRecord* record)
+	{
+		mHeader->tail.fetch_add(record->size, std::memory_order_release);
+	}
+
+	void LogSharedRing::Unlink()
+	{
+#ifndef _WIN32
+		if (!mName.empty())
+		{
+			shm_unlink(mName.c_str());
+		}
+#endif
+	}
+}
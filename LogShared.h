@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogShared.h
+//! 
+//! @brief		A shared memory ring buffer used to hand log entries from 
+//!				producer processes to the standalone log collector.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<stddef.h>					// Size types
+#include	<atomic>					// Ring positions shared between processes
+#include	<string>					// Strings
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_SHARED			// Define the shared ring class. 
+#define     CPP_LOGGER_SHARED
+//
+constexpr uint32_t	LOG_RING_MAGIC = 0x474F4C43;			//! "CLOG"
+constexpr uint32_t	LOG_RING_VERSION = 1;					//! Layout version
+constexpr uint32_t	LOG_RING_PAD = 0xFFFFFFFF;				//! Level marking a wrap padding record
+constexpr const char* LOG_RING_PREFIX = "cpp_logger.";		//! Shared memory name prefix
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Control block at the start of every ring. The producer owns head, the
+	// collector owns tail - each on its own cache line.
+	struct LogRingHeader
+	{
+		uint32_t				magic;				// LOG_RING_MAGIC once initialized
+		uint32_t				version;			// LOG_RING_VERSION
+		uint64_t				capacity;			// Data bytes, power of two
+		int32_t					pid;				// Producer process id
+		std::atomic<uint32_t>	closed;				// Producer shut down cleanly
+		std::atomic<uint64_t>	dropped;			// Entries dropped on a full ring
+		alignas(64) std::atomic<uint64_t> head;		// Bytes written by the producer
+		alignas(64) std::atomic<uint64_t> tail;		// Bytes consumed by the collector
+		alignas(64) char		data[1];			// Start of the record area
+	};
+
+	// Header in front of every record, records are padded to 8 bytes.
+	struct LogRingRecord
+	{
+		uint32_t				size;				// Record size including this header
+		uint32_t				level;				// LOG_LEVEL or LOG_RING_PAD
+		uint64_t				timestamp;			// Wall clock nanoseconds
+		uint64_t				seq;				// Producer sequence number
+		uint32_t				length;				// Text length
+		uint32_t				reserved;			// Keeps the text 8 byte aligned
+	};
+
+	class LogSharedRing
+	{
+	public:
+		//! @brief Constructor
+		LogSharedRing();
+
+		//! @brief Deconstructor - marks the ring closed and unmaps it.
+		~LogSharedRing();
+
+		//! @brief Builds the shared memory name for a channel and process.
+		static std::string SegmentName(const std::string& channel, int pid);
+
+		//! @brief Creates the ring for this process as a producer.
+		//! @param channel - channel name the collector is draining.
+		//! @param bytes - data capacity, rounded up to a power of two.
+		//! @return false if the ring could not be created
+		bool	Create(const std::string& channel, size_t bytes);
+
+		//! @brief Attaches to an existing ring as the collector.
+		//! @param name - shared memory segment name.
+		//! @return false if the segment is missing or not a log ring
+		bool	Attach(const std::string& name);
+
+		//! @brief Copies an entry into the ring. Never blocks, counts a drop when full.
+		//!        Only one thread may push at a time.
+		//! @return false if the entry was dropped
+		bool	Push(uint32_t level, uint64_t seq, uint64_t timestamp, const char* text, size_t length);
+
+		//! @brief Reads the next record. The record stays valid until Release.
+		//! @return nullptr if the ring is empty
+		const LogRingRecord* Peek();
+
+		//! @brief Consumes the record returned by Peek.
+		void	Release(const LogRingRecord* record);
+
+		//! @brief Removes the shared memory segment name.
+		void	Unlink();
+
+		//! @brief Access to the shared control block
+		LogRingHeader* Header() { return mHeader; }
+
+		//! @brief Segment name of the ring
+		const std::string& Name() const { return mName; }
+
+	protected:
+	private:
+		LogRingHeader*			mHeader;									// Mapped control block
+		size_t					mMappedBytes;								// Total mapped size
+		std::string				mName;										// Segment name
+		bool					mOwner;										// Created by this process
+	};
+}
+#endif // CPP_LOGGER_SHARED
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogSink.h
+//! 
+//! @brief		Interface for additional outputs fed by the log writer thread.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<vector>					// Batches of entries
+#include	"Log.h"						// Log entry definition
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_SINK				// Define the log sink interface. 
+#define     CPP_LOGGER_SINK
+//
+constexpr uint32_t LOG_SINK_HOLD_MSECS = 1000;		//! Longest the file sink may hold entries back across idle commits
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogSink
+	{
+	public:
+		//! @brief Deconstructor
+		virtual ~LogSink() {}
+
+		//! @brief Writes a batch of entries. Called only from the writer thread.
+		//!
+		//!	Entries arrive in the order they go into the log file, which is not sequence order
+		//!	when priority lanes are on: ERROR and WARN entries are written ahead of older backlog
+		//!	entries, in the same batch or an earlier one. Each lane keeps sequence order and every
+		//!	entry is passed exactly once. A sink that locates entries by sequence must record the
+		//!	lowest and highest it saw rather than take the first entry as the lowest.
+		//! @param batch - entries in file order.
+		virtual void	Write(const std::vector<LogEntry>& batch) = 0;
+
+		//! @brief Hands everything buffered by Write to the OS.
+		virtual void	Flush() {}
+
+		//! @brief Called instead of Flush when the queues ran dry and nobody is waiting. A sink may
+		//!        keep a partial buffer that is costly to close early - the writer calls Flush once
+		//!        a caller waits, a sync is due or LOG_SINK_HOLD_MSECS have passed.
+		//! @return false if entries are held back, they are not reported as written until a Flush
+		virtual bool	Idle() { Flush(); return true; }
+
+		//! @brief Makes everything written so far durable, called when the file is synced.
+		virtual void	Sync() {}
+
+		//! @brief Flushes and releases the output, called once on shutdown.
+		virtual void	Close() {}
+
+		//! @brief Whether the output was opened successfully.
+		virtual bool	IsOpen() const { return true; }
+
+		//! @brief Writes and syncs that failed so far. Log stops reporting entries as written
+		//!        or durable when this rises across a Flush or Sync.
+		virtual uint64_t Errors() const { return 0; }
+	};
+}
+#endif // CPP_LOGGER_SINK
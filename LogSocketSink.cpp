@@ -0,0 +1,636 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogSocketSink.cpp
+//! 
+//! @brief		Implementation of the socket log sink
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogSocketSink.h"			// Socket sink class
+#include	<cstring>					// memcpy
+#include	<cerrno>					// Error codes
+#ifndef _WIN32
+#include	<sys/socket.h>				// Sockets
+#include	<sys/un.h>					// Unix domain addresses
+#include	<sys/uio.h>					// iovec
+#include	<netdb.h>					// getaddrinfo
+#include	<unistd.h>					// close / fsync
+#include	<fcntl.h>					// Non-blocking sockets
+#include	<limits.h>					// IOV_MAX
+#endif
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef		MSG_NOSIGNAL				// A dropped agent must not raise SIGPIPE
+#define		MSG_NOSIGNAL 0
+#endif
+#ifndef		IOV_MAX
+#define		IOV_MAX 1024
+#endif
+//
+constexpr uint32_t	MIN_BACKOFF_MSECS = 100;				//! First reconnect delay
+constexpr uint32_t	MAX_BACKOFF_MSECS = 30000;				//! Longest reconnect delay
+constexpr size_t	MAX_MESSAGES_PER_CALL = 64;				//! Datagrams per sendmmsg
+constexpr size_t	REPLAY_READ_BYTES = 1024 * 1024;		//! Spill read per replayed batch
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogSocketSink::LogSocketSink(LOG_SOCKET type, std::string address, uint16_t port, LOG_FRAME framing, std::string spillFile)
+	{
+		mType = type;
+		mFraming = framing;
+		mAddress = address;
+		mPort = port;
+		mSocket = -1;
+		mUnsentSent = 0;
+		mDatagramBytes = (type == LOG_SOCKET::LOG_SOCKET_UDP) ? 1400 : 32 * 1024;
+		mNextAttempt = std::chrono::steady_clock::now();
+		mBackoffMSecs = MIN_BACKOFF_MSECS;
+		mSpillPath = spillFile;
+		mSpill = nullptr;
+		mSpillBytes = 0;
+		mSpillRead = 0;
+		mSpillLimit = 64 * 1024 * 1024;
+		mDropped = 0;
+		mSpillDirty = false;
+
+		// Pick up entries spilled by a previous run
+		FILE* previous = fopen(mSpillPath.c_str(), "rb");
+		if (previous != nullptr)
+		{
+			fseek(previous, 0, SEEK_END);
+			mSpillBytes = static_cast<uint64_t>(ftell(previous));
+			fclose(previous);
+		}
+	}
+
+	LogSocketSink::~LogSocketSink()
+	{
+		Close();
+	}
+
+	void LogSocketSink::Write(const std::vector<LogEntry>& batch)
+	{
+		if (batch.empty())
+		{
+			return;
+		}
+
+		// A part sent entry, then spilled entries go out first so the agent sees them in order
+		size_t sent = 0;
+		if (Connect() && SendUnsent() && (mSpillBytes == 0 || ReplaySpill()))
+		{
+			sent = Send(batch);
+		}
+
+		if (sent < batch.size())
+		{
+			Spill(batch, sent);
+		}
+	}
+
+	void LogSocketSink::Sync()
+	{
+#ifndef _WIN32
+		if (mSpill != nullptr && mSpillDirty)
+		{
+			fflush(mSpill);
+			fsync(fileno(mSpill));
+			mSpillDirty = false;
+		}
+#endif
+	}
+
+	void LogSocketSink::Close()
+	{
+		// A restart replays the spill from its start, so leave only what was never sent,
+		// behind the whole frame of an entry the agent got part of
+		if (mSpillRead > 0 || !mUnsent.empty())
+		{
+			CompactSpill(mUnsent);
+			mUnsent.clear();
+			mUnsentSent = 0;
+		}
+
+#ifndef _WIN32
+		if (mSocket >= 0)
+		{
+			close(mSocket);
+			mSocket = -1;
+		}
+#endif
+		if (mSpill != nullptr)
+		{
+			fclose(mSpill);
+			mSpill = nullptr;
+		}
+	}
+
+	void LogSocketSink::SetSpillLimit(uint64_t bytes)
+	{
+		mSpillLimit = bytes;
+	}
+
+	bool LogSocketSink::Connect()
+	{
+#ifdef _WIN32
+		return false;
+#else
+		if (mSocket >= 0)
+		{
+			// A TCP peer that closed still takes one more send, lost when its reset arrives,
+			// so look for the close first and spill instead
+			if (mType == LOG_SOCKET::LOG_SOCKET_TCP)
+			{
+				char byte;
+				ssize_t peeked = recv(mSocket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+				if (peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				{
+					Disconnect();
+					return false;
+				}
+			}
+			return true;
+		}
+
+		if (std::chrono::steady_clock::now() < mNextAttempt)
+		{
+			return false;
+		}
+
+		if (mType == LOG_SOCKET::LOG_SOCKET_UNIX || mType == LOG_SOCKET::LOG_SOCKET_UNIX_DGRAM)
+		{
+			sockaddr_un addr = {};
+			addr.sun_family = AF_UNIX;
+			strncpy(addr.sun_path, mAddress.c_str(), sizeof(addr.sun_path) - 1);
+
+			int type = (mType == LOG_SOCKET::LOG_SOCKET_UNIX) ? SOCK_STREAM : SOCK_DGRAM;
+			mSocket = socket(AF_UNIX, type, 0);
+			if (mSocket >= 0 && connect(mSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+			{
+				close(mSocket);
+				mSocket = -1;
+			}
+		}
+		else
+		{
+			addrinfo hints = {};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = (mType == LOG_SOCKET::LOG_SOCKET_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+
+			addrinfo* result = nullptr;
+			std::string port = std::to_string(mPort);
+			if (getaddrinfo(mAddress.c_str(), port.c_str(), &hints, &result) == 0)
+			{
+				for (addrinfo* ai = result; ai != nullptr && mSocket < 0; ai = ai->ai_next)
+				{
+					mSocket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+					if (mSocket >= 0 && connect(mSocket, ai->ai_addr, ai->ai_addrlen) != 0)
+					{
+						close(mSocket);
+						mSocket = -1;
+					}
+				}
+				freeaddrinfo(result);
+			}
+		}
+
+		if (mSocket < 0)
+		{
+			Disconnect();
+			return false;
+		}
+
+		// Sends run on the writer thread, a full socket spills instead of waiting for the agent
+		fcntl(mSocket, F_SETFL, fcntl(mSocket, F_GETFL) | O_NONBLOCK);
+
+		mBackoffMSecs = MIN_BACKOFF_MSECS;
+		return true;
+#endif
+	}
+
+	void LogSocketSink::Disconnect()
+	{
+#ifndef _WIN32
+		if (mSocket >= 0)
+		{
+			close(mSocket);
+			mSocket = -1;
+		}
+#endif
+		// The agent saw part of the unsent entry at most, the next connection gets all of it
+		mUnsentSent = 0;
+		mNextAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(mBackoffMSecs);
+		mBackoffMSecs = (mBackoffMSecs * 2 > MAX_BACKOFF_MSECS) ? MAX_BACKOFF_MSECS : mBackoffMSecs * 2;
+	}
+
+	size_t LogSocketSink::Send(const std::vector<LogEntry>& batch)
+	{
+		// The rest of a part sent entry goes first, everything else waits in the spill
+		if (!mUnsent.empty())
+		{
+			return 0;
+		}
+
+		size_t sent = 0;
+		bool blocked = false;
+		if (mType == LOG_SOCKET::LOG_SOCKET_UNIX || mType == LOG_SOCKET::LOG_SOCKET_TCP)
+		{
+			sent = SendStream(batch, blocked);
+		}
+		else
+		{
+			sent = SendDatagrams(batch, blocked);
+		}
+
+		// An agent that is only behind keeps its connection
+		if (sent < batch.size() && !blocked)
+		{
+			Disconnect();
+		}
+		return sent;
+	}
+
+	bool LogSocketSink::SendUnsent()
+	{
+#ifdef _WIN32
+		return mUnsent.empty();
+#else
+		while (mUnsentSent < mUnsent.size())
+		{
+			ssize_t written = send(mSocket, mUnsent.data() + mUnsentSent, mUnsent.size() - mUnsentSent, MSG_NOSIGNAL);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					Disconnect();
+				}
+				return false;
+			}
+			mUnsentSent += static_cast<size_t>(written);
+		}
+
+		mUnsent.clear();
+		mUnsentSent = 0;
+		return true;
+#endif
+	}
+
+	size_t LogSocketSink::SendStream(const std::vector<LogEntry>& batch, bool& blocked)
+	{
+#ifdef _WIN32
+		return 0;
+#else
+		static const char newline = '\n';
+		std::vector<LogFrameHeader> headers(batch.size());
+		std::vector<iovec> iov;
+		iov.reserve(batch.size() * 2);
+
+		// Two iovecs per entry - binary header then text, or text then newline
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			const LogEntry& entry = batch[i];
+			if (mFraming == LOG_FRAME::LOG_FRAME_BINARY)
+			{
+				headers[i] = LogFrameHeader{ static_cast<uint32_t>(entry.text.size()), static_cast<uint32_t>(entry.level), entry.seq };
+				iov.push_back(iovec{ &headers[i], sizeof(LogFrameHeader) });
+				iov.push_back(iovec{ const_cast<char*>(entry.text.data()), entry.text.size() });
+			}
+			else
+			{
+				iov.push_back(iovec{ const_cast<char*>(entry.text.data()), entry.text.size() });
+				iov.push_back(iovec{ const_cast<char*>(&newline), 1 });
+			}
+		}
+
+		size_t index = 0;
+		while (index < iov.size())
+		{
+			msghdr msg = {};
+			msg.msg_iov = &iov[index];
+			msg.msg_iovlen = (iov.size() - index < IOV_MAX) ? iov.size() - index : IOV_MAX;
+
+			ssize_t written = sendmsg(mSocket, &msg, MSG_NOSIGNAL);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				blocked = (errno == EAGAIN || errno == EWOULDBLOCK);
+				break;
+			}
+
+			// Step over everything fully written, trim a partially written iovec
+			size_t remaining = static_cast<size_t>(written);
+			while (index < iov.size() && remaining >= iov[index].iov_len)
+			{
+				remaining -= iov[index].iov_len;
+				index++;
+			}
+			if (remaining > 0)
+			{
+				iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + remaining;
+				iov[index].iov_len -= remaining;
+			}
+		}
+
+		// Only entries whose both halves went out count as sent, unless the socket was only full.
+		// Then the rest of a part sent entry must follow before anything else on this stream.
+		size_t sent = index / 2;
+		if (blocked && index < iov.size())
+		{
+			size_t left = iov[index].iov_len + ((index % 2 == 0) ? iov[index + 1].iov_len : 0);
+			std::string frame;
+			AppendFrame(frame, batch[sent]);
+			if (left < frame.size())
+			{
+				mUnsent.swap(frame);
+				mUnsentSent = mUnsent.size() - left;
+				sent++;
+			}
+		}
+		return sent;
+#endif
+	}
+
+	size_t LogSocketSink::SendDatagrams(const std::vector<LogEntry>& batch, bool& blocked)
+	{
+#ifdef _WIN32
+		return 0;
+#else
+		// Pack as many whole entries as fit into each datagram
+		std::vector<std::string> datagrams;
+		std::vector<size_t> lastEntry;
+		std::string current;
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			size_t before = current.size();
+			AppendFrame(current, batch[i]);
+			if (current.size() > mDatagramBytes && before > 0)
+			{
+				datagrams.push_back(current.substr(0, before));
+				lastEntry.push_back(i);
+				current.erase(0, before);
+			}
+		}
+		if (!current.empty())
+		{
+			datagrams.push_back(current);
+			lastEntry.push_back(batch.size());
+		}
+
+		size_t index = 0;
+		while (index < datagrams.size())
+		{
+#ifdef __linux__
+			mmsghdr msgs[MAX_MESSAGES_PER_CALL];
+			iovec iov[MAX_MESSAGES_PER_CALL];
+			unsigned count = 0;
+			for (; count < MAX_MESSAGES_PER_CALL && index + count < datagrams.size(); count++)
+			{
+				std::string& datagram = datagrams[index + count];
+				iov[count] = iovec{ &datagram[0], datagram.size() };
+				msgs[count] = mmsghdr{};
+				msgs[count].msg_hdr.msg_iov = &iov[count];
+				msgs[count].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = sendmmsg(mSocket, msgs, count, MSG_NOSIGNAL);
+#else
+			int result = (send(mSocket, datagrams[index].data(), datagrams[index].size(), MSG_NOSIGNAL) < 0) ? -1 : 1;
+#endif
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				blocked = (errno == EAGAIN || errno == EWOULDBLOCK);
+				break;
+			}
+			index += static_cast<size_t>(result);
+		}
+
+		return (index == 0) ? 0 : lastEntry[index - 1];
+#endif
+	}
+
+	void LogSocketSink::Spill(const std::vector<LogEntry>& batch, size_t first)
+	{
+		if (mSpill == nullptr)
+		{
+			mSpill = fopen(mSpillPath.c_str(), "ab");
+			if (mSpill == nullptr)
+			{
+				mDropped += batch.size() - first;
+				return;
+			}
+		}
+
+		std::string buffer;
+		for (size_t i = first; i < batch.size(); i++)
+		{
+			size_t before = buffer.size();
+			AppendFrame(buffer, batch[i]);
+			if (mSpillBytes + buffer.size() > mSpillLimit)
+			{
+				buffer.resize(before);
+				mDropped += batch.size() - i;
+				break;
+			}
+		}
+
+		fwrite(buffer.data(), 1, buffer.size(), mSpill);
+		fflush(mSpill);
+		mSpillBytes += buffer.size();
+		mSpillDirty = true;
+	}
+
+	// Seeks with 64 bit offsets, a spill may pass 2 GiB
+	static bool SeekSpill(FILE* file, uint64_t offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+		return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+	}
+
+	bool LogSocketSink::ReplaySpill()
+	{
+		FILE* file = fopen(mSpillPath.c_str(), "rb");
+		if (file == nullptr)
+		{
+			mSpillBytes = 0;
+			mSpillRead = 0;
+			return true;
+		}
+
+		// The read starts at the first unsent entry, sent entries only move the offset
+		std::string contents;
+		std::vector<LogEntry> entries;
+		std::vector<size_t> ends;
+		size_t want = REPLAY_READ_BYTES;
+		while (mSpillBytes > 0 && SeekSpill(file, mSpillRead))
+		{
+			size_t chunk = (mSpillBytes < want) ? static_cast<size_t>(mSpillBytes) : want;
+			contents.resize(chunk);
+			contents.resize(fread(&contents[0], 1, chunk, file));
+
+			// Parse the spilled frames back into entries
+			entries.clear();
+			ends.clear();
+			size_t offset = 0;
+			while (offset < contents.size())
+			{
+				if (mFraming == LOG_FRAME::LOG_FRAME_BINARY)
+				{
+					LogFrameHeader header;
+					if (contents.size() - offset < sizeof(header))
+					{
+						break;
+					}
+					memcpy(&header, contents.data() + offset, sizeof(header));
+					if (contents.size() - offset - sizeof(header) < header.length)
+					{
+						break;
+					}
+					entries.push_back(LogEntry{ header.seq, static_cast<LOG_LEVEL>(header.level), contents.substr(offset + sizeof(header), header.length) });
+					offset += sizeof(header) + header.length;
+				}
+				else
+				{
+					size_t end = contents.find('\n', offset);
+					if (end == std::string::npos)
+					{
+						break;
+					}
+					entries.push_back(LogEntry{ 0, LOG_LEVEL::LOG_INFO, contents.substr(offset, end - offset) });
+					offset = end + 1;
+				}
+				ends.push_back(offset);
+			}
+
+			if (entries.empty())
+			{
+				// A frame longer than the read, or one a crash cut short at the end of the file
+				if (contents.size() == chunk && chunk < mSpillBytes)
+				{
+					want *= 2;
+					continue;
+				}
+				mSpillBytes = 0;
+				break;
+			}
+
+			// One read per call, so a long backlog never holds the writer for long either
+			size_t sent = Send(entries);
+			if (sent > 0)
+			{
+				mSpillRead += ends[sent - 1];
+				mSpillBytes -= ends[sent - 1];
+			}
+			break;
+		}
+		fclose(file);
+
+		// Truncated only once drained, a long outage compacts now and then instead
+		if (mSpillBytes == 0)
+		{
+			if (mSpill != nullptr)
+			{
+				fclose(mSpill);
+				mSpill = nullptr;
+			}
+			remove(mSpillPath.c_str());
+			mSpillRead = 0;
+			return true;
+		}
+
+		if (mSpillRead > mSpillLimit)
+		{
+			CompactSpill(std::string());
+		}
+		return false;
+	}
+
+	void LogSocketSink::CompactSpill(const std::string& head)
+	{
+		if (mSpill != nullptr)
+		{
+			fclose(mSpill);
+			mSpill = nullptr;
+		}
+
+		// Copied in pieces to a new file that replaces the old one
+		std::string tempPath = mSpillPath + ".tmp";
+		FILE* source = fopen(mSpillPath.c_str(), "rb");
+		FILE* target = fopen(tempPath.c_str(), "wb");
+		bool copied = (target != nullptr) && fwrite(head.data(), 1, head.size(), target) == head.size();
+		if (source != nullptr)
+		{
+			copied &= SeekSpill(source, mSpillRead);
+			std::vector<char> buffer(REPLAY_READ_BYTES);
+			size_t length;
+			while (copied && (length = fread(buffer.data(), 1, buffer.size(), source)) > 0)
+			{
+				copied = fwrite(buffer.data(), 1, length, target) == length;
+			}
+			fclose(source);
+		}
+		if (target != nullptr)
+		{
+			copied &= fclose(target) == 0;
+		}
+
+		// The old file keeps its offset if anything failed
+		if (copied)
+		{
+#ifdef _WIN32
+			remove(mSpillPath.c_str());
+#endif
+			copied = rename(tempPath.c_str(), mSpillPath.c_str()) == 0;
+		}
+		if (copied)
+		{
+			mSpillRead = 0;
+			mSpillBytes += head.size();
+		}
+		else
+		{
+			remove(tempPath.c_str());
+		}
+	}
+
+	void LogSocketSink::AppendFrame(std::string& buffer, const LogEntry& entry)
+	{
+		if (mFraming == LOG_FRAME::LOG_FRAME_BINARY)
+		{
+			LogFrameHeader header = { static_cast<uint32_t>(entry.text.size()), static_cast<uint32_t>(entry.level), entry.seq };
+			buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+			buffer.append(entry.text.data(), entry.text.size());
+		}
+		else
+		{
+			buffer.append(entry.text.data(), entry.text.size());
+			buffer.push_back('\n');
+		}
+	}
+}
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogSocketSink.h
+//! 
+//! @brief		A log sink that ships batches to a local aggregation agent 
+//!				over a Unix domain, TCP or UDP socket, spilling to a local 
+//!				file while the agent is unavailable.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<chrono>					// Reconnect backoff
+#include	<cstdio>					// Spill file
+#include	<string>					// Strings
+#include	<vector>					// Batches
+#include	"LogSink.h"					// Sink interface
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_SOCKET_SINK		// Define the socket sink class. 
+#define     CPP_LOGGER_SOCKET_SINK
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Transport used to reach the agent
+	enum class LOG_SOCKET : const int
+	{
+		LOG_SOCKET_UNIX,				// Unix domain stream socket, address is a path
+		LOG_SOCKET_UNIX_DGRAM,			// Unix domain datagram socket, address is a path
+		LOG_SOCKET_TCP,					// TCP, address is a host
+		LOG_SOCKET_UDP,					// UDP, address is a host
+	};
+
+	// Framing of the entries on the wire
+	enum class LOG_FRAME : const int
+	{
+		LOG_FRAME_TEXT,					// One newline terminated line per entry
+		LOG_FRAME_BINARY,				// LogFrameHeader followed by the text
+	};
+
+	// Header in front of every binary framed entry, host byte order.
+	struct LogFrameHeader
+	{
+		uint32_t		length;			// Text length
+		uint32_t		level;			// LOG_LEVEL of the entry
+		uint64_t		seq;			// Sequence number of the entry
+	};
+
+	class LogSocketSink : public LogSink
+	{
+	public:
+		//! @brief Constructor
+		//! @param type - transport used to reach the agent.
+		//! @param address - socket path for Unix sockets, host name otherwise.
+		//! @param port - port for TCP and UDP, ignored for Unix sockets.
+		//! @param framing - text lines or binary frames.
+		//! @param spillFile - file receiving entries while the agent is unavailable.
+		LogSocketSink(LOG_SOCKET type, std::string address, uint16_t port, LOG_FRAME framing, std::string spillFile);
+
+		//! @brief Deconstructor
+		~LogSocketSink();
+
+		//! @brief Sends a batch without blocking, or spills it when the agent cannot be reached
+		//!		   or is not keeping up.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Syncs the spill file if entries are waiting in it.
+		void	Sync() override;
+
+		//! @brief Closes the socket and spill file, dropping the replayed part of the spill.
+		void	Close() override;
+
+		//! @brief Limits the size of the spill file, entries past it are dropped.
+		//! @param bytes - maximum spill size.
+		void	SetSpillLimit(uint64_t bytes);
+
+		//! @brief Number of entries dropped because the spill file was full.
+		uint64_t Dropped() const { return mDropped; }
+
+	protected:
+	private:
+		//! @brief Opens and connects the socket, honoring the reconnect backoff.
+		bool	Connect();
+
+		//! @brief Closes the socket and schedules the next reconnect.
+		void	Disconnect();
+
+		//! @brief Sends entries over the connected socket, disconnecting on an error.
+		//! @return entries sent, or owned by mUnsent
+		size_t	Send(const std::vector<LogEntry>& batch);
+
+		//! @brief Sends entries as vectored writes on a stream socket.
+		//! @param blocked - set if the socket was full rather than failed.
+		size_t	SendStream(const std::vector<LogEntry>& batch, bool& blocked);
+
+		//! @brief Sends entries packed into datagrams.
+		//! @param blocked - set if the socket was full rather than failed.
+		size_t	SendDatagrams(const std::vector<LogEntry>& batch, bool& blocked);
+
+		//! @brief Sends the rest of an entry the stream socket took only part of.
+		//! @return false if some of it is still waiting
+		bool	SendUnsent();
+
+		//! @brief Appends entries to the spill file.
+		void	Spill(const std::vector<LogEntry>& batch, size_t first);
+
+		//! @brief Sends the spill file contents from the read offset once the agent is back.
+		//! @return true once the spill is drained
+		bool	ReplaySpill();
+
+		//! @brief Rewrites the spill file without its replayed part.
+		//! @param head - frame written ahead of the waiting entries, may be empty.
+		void	CompactSpill(const std::string& head);
+
+		//! @brief Appends one framed entry to a buffer.
+		void	AppendFrame(std::string& buffer, const LogEntry& entry);
+
+		LOG_SOCKET		mType;											// Transport
+		LOG_FRAME		mFraming;										// Wire framing
+		std::string		mAddress;										// Path or host
+		uint16_t		mPort;											// TCP / UDP port
+		int				mSocket;										// Connected non-blocking socket, -1 if none
+		std::string		mUnsent;										// Frame of an entry the stream socket took part of
+		size_t			mUnsentSent;									// Bytes of mUnsent on the current connection
+		size_t			mDatagramBytes;									// Largest datagram payload
+		std::chrono::steady_clock::time_point mNextAttempt;				// Earliest reconnect time
+		uint32_t		mBackoffMSecs;									// Current reconnect backoff
+		std::string		mSpillPath;										// Spill file location
+		FILE*			mSpill;											// Open spill file
+		uint64_t		mSpillBytes;									// Bytes waiting in the spill file
+		uint64_t		mSpillRead;										// Spill file offset of the first waiting byte
+		uint64_t		mSpillLimit;									// Maximum spill size
+		uint64_t		mDropped;										// Entries dropped on a full spill
+		bool			mSpillDirty;									// Spill written since the last sync
+	};
+}
+#endif // CPP_LOGGER_SOCKET_SINK
@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogTrace.cpp
+//!
+//! @brief		Implementation of the span recorder and trace file
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogTrace.h"				// Trace classes
+#ifdef _WIN32
+#include	<process.h>					// _getpid
+#else
+#include	<unistd.h>					// getpid
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	std::atomic<bool> LogTrace::mEnabled(false);
+	thread_local LogTrace::Local LogTrace::tLocal;
+
+	// Phase letters of the trace event format, on one thread and across threads by id
+	static const char* const ThreadPhase[] = { "B", "E", "i" };
+	static const char* const AsyncPhase[] = { "b", "e", "n" };
+
+	//! @brief Writes a string as a JSON string body, escaping what JSON requires.
+	static void WriteEscaped(FILE* file, const char* text)
+	{
+		for (const char* c = text; *c != '\0'; ++c)
+		{
+			unsigned char ch = static_cast<unsigned char>(*c);
+			if (ch == '"' || ch == '\\')
+			{
+				fputc('\\', file);
+				fputc(ch, file);
+			}
+			else if (ch < 0x20)
+			{
+				fprintf(file, "\\u%04x", ch);
+			}
+			else
+			{
+				fputc(ch, file);
+			}
+		}
+	}
+
+	LogTrace* LogTrace::Instance()
+	{
+		static LogTrace* trace = new LogTrace;
+		return trace;
+	}
+
+	LogTrace::Local::~Local()
+	{
+		if (ring != nullptr)
+		{
+			ring->exited.store(true, std::memory_order_release);
+		}
+	}
+
+	LogTrace::Ring* LogTrace::Register(uint32_t thread)
+	{
+		Ring* ring = new Ring;
+		ring->thread = thread;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRings.push_back(ring);
+		return ring;
+	}
+
+	bool LogTrace::Record(const char* name, uint64_t id, LOG_SPAN phase, uint32_t thread)
+	{
+		Ring* ring = tLocal.ring;
+		if (ring == nullptr)
+		{
+			ring = tLocal.ring = Instance()->Register(thread);
+		}
+
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		if (head - ring->tail.load(std::memory_order_acquire) >= LOG_TRACE_RING_EVENTS)
+		{
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		LogSpanEvent& event = ring->events[head & (LOG_TRACE_RING_EVENTS - 1)];
+		event.usecs = LogTraceClock::NowUSecs();
+		event.id = id;
+		event.name = name;
+		event.thread = ring->thread;
+		event.phase = phase;
+		ring->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	uint64_t LogTrace::Drain(std::vector<LogSpanEvent>& events)
+	{
+		uint64_t dropped = 0;
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (size_t i = 0; i < mRings.size();)
+		{
+			// Read exited first, so a ring is only freed after its last event was seen
+			Ring* ring = mRings[i];
+			bool exited = ring->exited.load(std::memory_order_acquire);
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+			for (; tail < head; ++tail)
+			{
+				events.push_back(ring->events[tail & (LOG_TRACE_RING_EVENTS - 1)]);
+			}
+			ring->tail.store(tail, std::memory_order_release);
+			dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+
+			if (exited)
+			{
+				delete ring;
+				mRings[i] = mRings.back();
+				mRings.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+		return dropped;
+	}
+
+	LogTraceFile::LogTraceFile(const std::string& path, uint64_t clockBase)
+	{
+		mClockBase = clockBase;
+		mFirst = true;
+#ifdef _WIN32
+		mPid = _getpid();
+#else
+		mPid = getpid();
+#endif
+		mFile = fopen(path.c_str(), "wb");
+		if (mFile != nullptr)
+		{
+			fputs("[\n", mFile);
+		}
+	}
+
+	LogTraceFile::~LogTraceFile()
+	{
+		Close();
+	}
+
+	void LogTraceFile::Begin()
+	{
+		fputs(mFirst ? "" : ",\n", mFile);
+		mFirst = false;
+	}
+
+	void LogTraceFile::Write(const std::vector<LogSpanEvent>& events, const std::vector<std::string>& names, uint64_t dropped)
+	{
+		if (mFile == nullptr)
+		{
+			return;
+		}
+
+		for (const LogSpanEvent& event : events)
+		{
+			// Metadata events name the thread tracks, written again if a thread is renamed
+			std::string name = (event.thread < names.size() && !names[event.thread].empty()) ?
+				names[event.thread] : "thread " + std::to_string(event.thread);
+			if (event.thread >= mNamed.size())
+			{
+				mNamed.resize(event.thread + 1);
+			}
+			if (mNamed[event.thread] != name)
+			{
+				Begin();
+				fprintf(mFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"", mPid, event.thread);
+				WriteEscaped(mFile, name.c_str());
+				fputs("\"}}", mFile);
+				mNamed[event.thread] = name;
+			}
+
+			// Spans with an id may end on another thread, the viewer pairs them by id
+			int phase = static_cast<int>(event.phase);
+			unsigned long long ts = static_cast<unsigned long long>(event.usecs - mClockBase);
+			Begin();
+			fputs("{\"name\":\"", mFile);
+			WriteEscaped(mFile, event.name);
+			if (event.id != 0)
+			{
+				fprintf(mFile, "\",\"cat\":\"span\",\"ph\":\"%s\",\"id\":\"0x%llx\",\"ts\":%llu,\"pid\":%d,\"tid\":%u}",
+					AsyncPhase[phase], static_cast<unsigned long long>(event.id), ts, mPid, event.thread);
+			}
+			else
+			{
+				fprintf(mFile, "\",\"cat\":\"span\",\"ph\":\"%s\",%s\"ts\":%llu,\"pid\":%d,\"tid\":%u}",
+					ThreadPhase[phase], (event.phase == LOG_SPAN::LOG_SPAN_INSTANT) ? "\"s\":\"t\"," : "", ts, mPid, event.thread);
+			}
+		}
+
+		if (dropped > 0)
+		{
+			unsigned long long ts = events.empty() ? 0 : static_cast<unsigned long long>(events.back().usecs - mClockBase);
+			Begin();
+			fprintf(mFile, "{\"name\":\"spans dropped\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%llu,\"pid\":%d,\"tid\":0,\"args\":{\"count\":%llu}}",
+				ts, mPid, static_cast<unsigned long long>(dropped));
+		}
+	}
+
+	void LogTraceFile::Flush()
+	{
+		if (mFile != nullptr)
+		{
+			fflush(mFile);
+		}
+	}
+
+	void LogTraceFile::Close()
+	{
+		if (mFile != nullptr)
+		{
+			fputs("\n]\n", mFile);
+			fclose(mFile);
+			mFile = nullptr;
+		}
+	}
+}
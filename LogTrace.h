@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogTrace.h
+//!
+//! @brief		Latency spans recorded into per-thread rings and written by
+//!				the log writer as a Chrome trace event file, which loads in
+//!				chrome://tracing and Perfetto. Recording is a clock read and
+//!				a ring store, nothing is formatted on the calling thread.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<atomic>					// Ring positions
+#include	<cstdio>					// Trace file
+#include	<mutex>						// Ring registry
+#include	<string>					// Strings
+#include	<type_traits>				// Trace clock selection
+#include	<vector>					// Drained events
+#include	"LogClock.h"				// Span timestamps
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_TRACE			// Define the span recorder and trace file.
+#define     CPP_LOGGER_TRACE
+//
+constexpr const char* LOG_TRACE_EXTENSION = ".trace.json";		//! Appended to the log file name
+constexpr size_t LOG_TRACE_RING_EVENTS = 4096;					//! Events buffered per thread, power of two
+constexpr uint32_t LOG_TRACE_DRAIN_MSECS = 100;					//! Longest the writer leaves spans in the rings
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	// Kind of span event
+	enum class LOG_SPAN : const int
+	{
+		LOG_SPAN_BEGIN,					// Span starts
+		LOG_SPAN_END,					// Span ends
+		LOG_SPAN_INSTANT,				// Point in time without a duration
+	};
+
+	// One recorded event. The name is not copied, it must outlive the logger - a literal.
+	struct LogSpanEvent
+	{
+		uint64_t		usecs;			// LogTraceClock reading
+		uint64_t		id;				// Span id, 0 for a span that begins and ends on one thread
+		const char*		name;			// Span name
+		uint32_t		thread;			// Compact id of the recording thread
+		LOG_SPAN		phase;			// Begin, end or instant
+	};
+
+	// Spans need a clock even when log timestamps are compiled out
+	typedef std::conditional<LogClock::Enabled, LogClock, LogClockSteady>::type LogTraceClock;
+
+	class LogTrace
+	{
+	public:
+		//! @brief The process wide recorder. Never destroyed, rings may outlive the logger.
+		static LogTrace* Instance();
+
+		//! @brief Whether spans are being recorded, checked before every Record.
+		static bool		Enabled() { return mEnabled.load(std::memory_order_relaxed); }
+
+		//! @brief Turns recording on or off.
+		static void		SetEnabled(bool enable) { mEnabled.store(enable, std::memory_order_relaxed); }
+
+		//! @brief Stores an event in the calling thread's ring. A full ring drops the event.
+		//! @param name - span name, not copied.
+		//! @param id - span id, 0 if the span stays on this thread.
+		//! @param phase - begin, end or instant.
+		//! @param thread - compact id of the calling thread.
+		//! @return false if the ring was full
+		static bool		Record(const char* name, uint64_t id, LOG_SPAN phase, uint32_t thread);
+
+		//! @brief Moves every recorded event out of the rings, freeing rings of exited threads.
+		//! @param events - receives the events, appended.
+		//! @return events dropped on full rings since the last drain
+		uint64_t		Drain(std::vector<LogSpanEvent>& events);
+
+		//! @brief Holds the ring registry still across fork.
+		void			Lock() { mMutex.lock(); }
+
+		//! @brief Releases Lock.
+		void			Unlock() { mMutex.unlock(); }
+
+	protected:
+	private:
+		// One thread's events. The thread owns head, the writer owns tail.
+		struct Ring
+		{
+			LogSpanEvent			events[LOG_TRACE_RING_EVENTS];
+			uint32_t				thread = 0;			// Compact id of the owning thread
+			std::atomic<bool>		exited{ false };	// Owner exited, free once drained
+			std::atomic<uint64_t>	dropped{ 0 };		// Events dropped on a full ring
+			alignas(64) std::atomic<uint64_t> head{ 0 };	// Events recorded
+			alignas(64) std::atomic<uint64_t> tail{ 0 };	// Events drained
+		};
+
+		// Marks the calling thread's ring for freeing when the thread exits
+		struct Local
+		{
+			Ring*		ring = nullptr;
+
+			~Local();
+		};
+
+		LogTrace() {}
+
+		//! @brief Creates and registers a ring for the calling thread.
+		Ring*			Register(uint32_t thread);
+
+		static std::atomic<bool>	mEnabled;		// Recording spans ?
+		static thread_local Local	tLocal;			// Calling thread's ring
+		std::mutex					mMutex;			// Protects the ring list
+		std::vector<Ring*>			mRings;			// Every live ring
+	};
+
+	// Writes drained events as Chrome trace event JSON. The file is a bare event array,
+	// which the viewers accept without the closing bracket, so a crash leaves it loadable.
+	class LogTraceFile
+	{
+	public:
+		//! @brief Constructor - creates the file.
+		//! @param path - file to create.
+		//! @param clockBase - LogTraceClock reading that becomes timestamp 0.
+		LogTraceFile(const std::string& path, uint64_t clockBase);
+
+		//! @brief Deconstructor - closes the file.
+		~LogTraceFile();
+
+		//! @brief Whether the file was created.
+		bool	IsOpen() const { return mFile != nullptr; }
+
+		//! @brief Appends events, naming each thread the first time it shows up.
+		//! @param events - drained events.
+		//! @param names - registered thread names by compact id.
+		//! @param dropped - events lost on full rings, recorded as an instant event.
+		void	Write(const std::vector<LogSpanEvent>& events, const std::vector<std::string>& names, uint64_t dropped);
+
+		//! @brief Hands buffered events to the OS.
+		void	Flush();
+
+		//! @brief Ends the event array and closes the file.
+		void	Close();
+
+	protected:
+	private:
+		//! @brief Starts the next event, writing the separator.
+		void	Begin();
+
+		FILE*						mFile;			// Trace file, nullptr if not created
+		uint64_t					mClockBase;		// Clock reading of timestamp 0
+		int							mPid;			// Process id written with every event
+		bool						mFirst;			// No event written yet ?
+		std::vector<std::string>	mNamed;			// Name written for each thread so far
+	};
+}
+#endif // CPP_LOGGER_TRACE
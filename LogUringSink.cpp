@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogUringSink.cpp
+//!
+//! @brief		Implementation of the io_uring log file backend
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogUringSink.h"			// io_uring sink class
+#include	<cstring>					// memcpy / memset
+#include	<cstdlib>					// Aligned allocation
+#include	<cerrno>					// Error codes
+#ifdef __linux__
+#include	<fcntl.h>					// open / O_DIRECT
+#include	<unistd.h>					// syscall / ftruncate
+#include	<sys/mman.h>				// Ring mappings
+#include	<sys/syscall.h>				// io_uring syscall numbers
+#include	<linux/io_uring.h>			// io_uring structures
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	LogUringSink::LogUringSink(const std::string& path, bool direct)
+	{
+		mFd = -1;
+		mRingFd = -1;
+		mDirect = direct;
+		mPadded = false;
+		mFill = 0;
+		mFillBytes = 0;
+		mOffset = 0;
+		mSubmitted = 0;
+		mInFlight = 0;
+		mQueued = 0;
+		mErrors = 0;
+		mSqRing = nullptr;
+		mSqRingBytes = 0;
+		mCqRing = nullptr;
+		mCqRingBytes = 0;
+		mSqes = nullptr;
+		mSqesBytes = 0;
+
+		for (size_t i = 0; i < LOG_URING_BUFFERS; ++i)
+		{
+			mBuffers[i] = nullptr;
+			mBusy[i] = false;
+			mLengths[i] = 0;
+			mOffsets[i] = 0;
+		}
+
+#ifdef __linux__
+		if (!SetupRing())
+		{
+			return;
+		}
+
+		mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (direct ? O_DIRECT : 0), 0644);
+		if (mFd < 0)
+		{
+			CloseRing();
+			return;
+		}
+
+		for (size_t i = 0; i < LOG_URING_BUFFERS; ++i)
+		{
+			mBuffers[i] = static_cast<char*>(aligned_alloc(LOG_WRITE_BUFFER_ALIGN, LOG_WRITE_BUFFER_BYTES));
+		}
+#endif
+	}
+
+	LogUringSink::~LogUringSink()
+	{
+		Close();
+
+		for (size_t i = 0; i < LOG_URING_BUFFERS; ++i)
+		{
+			free(mBuffers[i]);
+		}
+	}
+
+	void LogUringSink::Write(const std::vector<LogEntry>& batch)
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		for (const LogEntry& entry : batch)
+		{
+			const char* text = entry.text.data();
+			size_t length = entry.text.size();
+
+			// Copy the text in pieces if it straddles a buffer boundary
+			while (length + 1 > LOG_WRITE_BUFFER_BYTES - mFillBytes)
+			{
+				size_t part = LOG_WRITE_BUFFER_BYTES - mFillBytes;
+				part = (part < length) ? part : length;
+				memcpy(mBuffers[mFill] + mFillBytes, text, part);
+				mFillBytes += part;
+				text += part;
+				length -= part;
+				QueueFill(false);
+				Enter(0);
+			}
+
+			memcpy(mBuffers[mFill] + mFillBytes, text, length);
+			mFillBytes += length;
+			mBuffers[mFill][mFillBytes++] = '\n';
+		}
+
+		// Pick up finished writes without blocking so their buffers come back
+		Reap();
+	}
+
+	void LogUringSink::Flush()
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		QueueFill(false);
+		WaitIdle();
+
+#ifdef __linux__
+		// Direct writes are whole blocks, cut the padding off the last one
+		if (mPadded)
+		{
+			if (ftruncate(mFd, mOffset + mFillBytes) != 0)
+			{
+				++mErrors;
+			}
+			mPadded = false;
+		}
+#endif
+	}
+
+	void LogUringSink::Sync()
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		if (mDirect)
+		{
+			// The length fix up has to land before the sync so the size is durable too
+			Flush();
+		}
+		else
+		{
+			QueueFill(true);
+		}
+		QueueSync();
+		WaitIdle();
+	}
+
+	void LogUringSink::Close()
+	{
+		if (mFd < 0)
+		{
+			return;
+		}
+
+		Sync();
+		CloseRing();
+
+#ifdef __linux__
+		close(mFd);
+#endif
+		mFd = -1;
+	}
+
+	bool LogUringSink::SetupRing()
+	{
+#ifdef __linux__
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		mRingFd = static_cast<int>(syscall(__NR_io_uring_setup, LOG_URING_ENTRIES, &params));
+		if (mRingFd < 0)
+		{
+			return false;
+		}
+
+		// FAST_POLL arrived in 5.7, after IORING_OP_WRITE in 5.6
+		if ((params.features & IORING_FEAT_FAST_POLL) == 0)
+		{
+			CloseRing();
+			return false;
+		}
+
+		mSqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		mCqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single)
+		{
+			mSqRingBytes = (mSqRingBytes > mCqRingBytes) ? mSqRingBytes : mCqRingBytes;
+			mCqRingBytes = mSqRingBytes;
+		}
+
+		mSqRing = mmap(nullptr, mSqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQ_RING);
+		if (mSqRing == MAP_FAILED)
+		{
+			mSqRing = nullptr;
+			CloseRing();
+			return false;
+		}
+
+		mCqRing = single ? mSqRing : mmap(nullptr, mCqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING);
+		if (mCqRing == MAP_FAILED)
+		{
+			mCqRing = nullptr;
+			CloseRing();
+			return false;
+		}
+
+		mSqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+		mSqes = mmap(nullptr, mSqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+		if (mSqes == MAP_FAILED)
+		{
+			mSqes = nullptr;
+			CloseRing();
+			return false;
+		}
+
+		char* sq = static_cast<char*>(mSqRing);
+		char* cq = static_cast<char*>(mCqRing);
+		mSqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		mSqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		mCqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		mCqes = cq + params.cq_off.cqes;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void LogUringSink::CloseRing()
+	{
+#ifdef __linux__
+		if (mSqes != nullptr)
+		{
+			munmap(mSqes, mSqesBytes);
+		}
+		if (mCqRing != nullptr && mCqRing != mSqRing)
+		{
+			munmap(mCqRing, mCqRingBytes);
+		}
+		if (mSqRing != nullptr)
+		{
+			munmap(mSqRing, mSqRingBytes);
+		}
+		if (mRingFd >= 0)
+		{
+			close(mRingFd);
+		}
+#endif
+		mSqes = nullptr;
+		mCqRing = nullptr;
+		mSqRing = nullptr;
+		mRingFd = -1;
+	}
+
+	bool LogUringSink::QueueFill(bool linked)
+	{
+		// Nothing new since the last write - a direct tail carried over is already on its way
+		uint64_t end = mOffset + mFillBytes;
+		if (mFillBytes == 0 || end == mSubmitted)
+		{
+			return false;
+		}
+
+		// Direct writes must cover whole blocks, zero the padding past the data
+		size_t length = mFillBytes;
+		if (mDirect)
+		{
+			length = (mFillBytes + LOG_WRITE_BUFFER_ALIGN - 1) & ~(LOG_WRITE_BUFFER_ALIGN - 1);
+			memset(mBuffers[mFill] + mFillBytes, 0, length - mFillBytes);
+		}
+
+		// Find the next fill buffer first, waiting here is what pushes back on the writer
+		size_t next = LOG_URING_BUFFERS;
+		while (next == LOG_URING_BUFFERS)
+		{
+			for (size_t i = 0; i < LOG_URING_BUFFERS; ++i)
+			{
+				if (i != mFill && !mBusy[i])
+				{
+					next = i;
+					break;
+				}
+			}
+
+			if (next == LOG_URING_BUFFERS && Enter(1))
+			{
+				Reap();
+			}
+		}
+
+#ifdef __linux__
+		if (mRingFd >= 0)
+		{
+			unsigned tail = *mSqTail;
+			unsigned index = tail & *mSqMask;
+			io_uring_sqe* sqe = static_cast<io_uring_sqe*>(mSqes) + index;
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->fd = mFd;
+			sqe->addr = reinterpret_cast<uint64_t>(mBuffers[mFill]);
+			sqe->len = static_cast<uint32_t>(length);
+			sqe->off = mOffset;
+			sqe->flags = linked ? IOSQE_IO_LINK : 0;
+			sqe->user_data = mFill;
+			mSqArray[index] = index;
+			__atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+
+			mBusy[mFill] = true;
+			mLengths[mFill] = static_cast<uint32_t>(length);
+			mOffsets[mFill] = mOffset;
+			++mInFlight;
+			++mQueued;
+		}
+		else if (!WriteAt(mFd, mBuffers[mFill], length, mOffset))
+		{
+			++mErrors;
+		}
+#endif
+
+		mSubmitted = end;
+		mPadded = (length != mFillBytes);
+
+		// A partial direct block is written again from the next buffer once more data arrives
+		size_t carry = mPadded ? (mFillBytes & (LOG_WRITE_BUFFER_ALIGN - 1)) : 0;
+		memcpy(mBuffers[next], mBuffers[mFill] + mFillBytes - carry, carry);
+		mOffset += mFillBytes - carry;
+		mFillBytes = carry;
+		mFill = next;
+		return true;
+	}
+
+	void LogUringSink::QueueSync()
+	{
+#ifdef __linux__
+		if (mRingFd < 0)
+		{
+			SyncDescriptor(mFd);
+			return;
+		}
+
+		unsigned tail = *mSqTail;
+		unsigned index = tail & *mSqMask;
+		io_uring_sqe* sqe = static_cast<io_uring_sqe*>(mSqes) + index;
+		memset(sqe, 0, sizeof(*sqe));
+		// The link only orders the write just before it, the drain holds the sync back until
+		// every earlier write has completed as well
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = mFd;
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		sqe->flags = IOSQE_IO_DRAIN;
+		sqe->user_data = LOG_URING_BUFFERS;
+		mSqArray[index] = index;
+		__atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+
+		++mInFlight;
+		++mQueued;
+#endif
+	}
+
+	bool LogUringSink::Enter(unsigned wait)
+	{
+#ifdef __linux__
+		while (mRingFd >= 0 && (mQueued > 0 || wait > 0))
+		{
+			long submitted = syscall(__NR_io_uring_enter, mRingFd, mQueued, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+			if (submitted >= 0)
+			{
+				mQueued -= static_cast<unsigned>(submitted);
+				return true;
+			}
+
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EBUSY)
+			{
+				// The completion queue is full, make room and try again
+				Reap();
+				continue;
+			}
+
+			++mErrors;
+			Fallback();
+			return false;
+		}
+		return mRingFd >= 0;
+#else
+		return false;
+#endif
+	}
+
+	void LogUringSink::Reap()
+	{
+#ifdef __linux__
+		if (mRingFd < 0)
+		{
+			return;
+		}
+
+		unsigned head = *mCqHead;
+		unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(mCqes) + (head & *mCqMask);
+			size_t index = static_cast<size_t>(cqe->user_data);
+			int result = cqe->res;
+
+			if (index < LOG_URING_BUFFERS)
+			{
+				// Finish short or failed writes with a blocking write
+				size_t done = (result > 0) ? static_cast<size_t>(result) : 0;
+				if (done < mLengths[index])
+				{
+					if (result < 0)
+					{
+						++mErrors;
+					}
+					if (!WriteAt(mFd, mBuffers[index] + done, mLengths[index] - done, mOffsets[index] + done))
+					{
+						++mErrors;
+					}
+				}
+				mBusy[index] = false;
+			}
+			else if (result < 0)
+			{
+				// A broken link cancels the sync, so do it here instead
+				if (result != -ECANCELED)
+				{
+					++mErrors;
+				}
+				SyncDescriptor(mFd);
+			}
+
+			--mInFlight;
+			++head;
+		}
+		__atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+#endif
+	}
+
+	void LogUringSink::WaitIdle()
+	{
+		Enter(0);
+		while (mInFlight > 0 && Enter(1))
+		{
+			Reap();
+		}
+	}
+
+	void LogUringSink::Fallback()
+	{
+		// Anything the kernel may not have taken is written again, writes at an offset are idempotent
+		for (size_t i = 0; i < LOG_URING_BUFFERS; ++i)
+		{
+			if (mBusy[i])
+			{
+				if (!WriteAt(mFd, mBuffers[i], mLengths[i], mOffsets[i]))
+				{
+					++mErrors;
+				}
+				mBusy[i] = false;
+			}
+		}
+
+		SyncDescriptor(mFd);
+		mInFlight = 0;
+		mQueued = 0;
+		CloseRing();
+	}
+}
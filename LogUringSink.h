@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogUringSink.h
+//! 
+//! @brief		Linux io_uring log file backend that keeps several buffer 
+//!				writes in flight so disk stalls do not block the writer thread.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<string>					// Strings
+#include	"LogSink.h"					// Sink interface
+#include	"LogFileSink.h"				// Buffer sizes
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_URING_SINK		// Define the io_uring sink class. 
+#define     CPP_LOGGER_URING_SINK
+//
+constexpr size_t LOG_URING_BUFFERS = 4;						//! Buffers, all but the fill buffer may be in flight
+constexpr unsigned LOG_URING_ENTRIES = 16;					//! Submission queue size
+//
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Essentials
+{
+	class LogUringSink : public LogSink
+	{
+	public:
+		//! @brief Constructor - creates the file and sets up the ring.
+		//! @param path - file to create.
+		//! @param direct - open with O_DIRECT, bypassing the page cache.
+		LogUringSink(const std::string& path, bool direct);
+
+		//! @brief Deconstructor
+		~LogUringSink();
+
+		//! @brief Copies entries into the fill buffer, submitting full buffers without waiting.
+		void	Write(const std::vector<LogEntry>& batch) override;
+
+		//! @brief Submits the partial fill buffer and waits for every write to complete.
+		void	Flush() override;
+
+		//! @brief Submits the fill buffer linked to an fdatasync and waits for both.
+		void	Sync() override;
+
+		//! @brief Flushes, syncs and tears down the ring.
+		void	Close() override;
+
+		//! @brief Whether the file was created and the ring was set up.
+		bool	IsOpen() const override { return mFd >= 0; }
+
+		//! @brief Number of writes or syncs the kernel failed.
+		//! @return failed operation count
+		uint64_t Errors() const override { return mErrors; }
+
+	protected:
+	private:
+		//! @brief Creates the ring and maps its queues.
+		//! @return true if the ring is usable
+		bool	SetupRing();
+
+		//! @brief Queues a write of the fill buffer and moves on to a free buffer.
+		//! @param linked - link the write to the next queued operation.
+		//! @return true if a write was queued
+		bool	QueueFill(bool linked);
+
+		//! @brief Queues an fdatasync of the file that starts once every write queued before it has completed.
+		void	QueueSync();
+
+		//! @brief Submits queued operations, optionally waiting for completions.
+		//! @param wait - number of completions to wait for.
+		//! @return false if the ring failed and was dropped
+		bool	Enter(unsigned wait);
+
+		//! @brief Consumes completions, freeing their buffers.
+		void	Reap();
+
+		//! @brief Waits until nothing is in flight.
+		void	WaitIdle();
+
+		//! @brief Finishes in flight buffers with blocking writes and drops the ring.
+		void	Fallback();
+
+		//! @brief Unmaps and closes the ring.
+		void	CloseRing();
+
+		int			mFd;												// File descriptor
+		int			mRingFd;											// io_uring descriptor
+		bool		mDirect;											// File opened with O_DIRECT
+		bool		mPadded;											// File has padding past mOffset + mFillBytes
+		char*		mBuffers[LOG_URING_BUFFERS];						// Aligned write buffers
+		bool		mBusy[LOG_URING_BUFFERS];							// Buffer is being written
+		uint32_t	mLengths[LOG_URING_BUFFERS];						// Bytes submitted from each buffer
+		uint64_t	mOffsets[LOG_URING_BUFFERS];						// File offset of each submitted buffer
+		size_t		mFill;												// Index of the buffer being filled
+		size_t		mFillBytes;											// Bytes in the fill buffer
+		uint64_t	mOffset;											// File offset of the fill buffer
+		uint64_t	mSubmitted;											// File length covered by submitted writes
+		unsigned	mInFlight;											// Operations not yet completed
+		unsigned	mQueued;											// Operations not yet submitted
+		uint64_t	mErrors;											// Failed operations
+
+		void*		mSqRing;											// Submission ring mapping
+		size_t		mSqRingBytes;										// Submission ring mapping size
+		void*		mCqRing;											// Completion ring mapping
+		size_t		mCqRingBytes;										// Completion ring mapping size
+		void*		mSqes;												// Submission entries mapping
+		size_t		mSqesBytes;											// Submission entries mapping size
+		unsigned*	mSqTail;											// Submission ring tail
+		unsigned*	mSqMask;											// Submission ring mask
+		unsigned*	mSqArray;											// Submission ring index array
+		unsigned*	mCqHead;											// Completion ring head
+		unsigned*	mCqTail;											// Completion ring tail
+		unsigned*	mCqMask;											// Completion ring mask
+		void*		mCqes;												// Completion entries
+	};
+}
+#endif // CPP_LOGGER_URING_SINK
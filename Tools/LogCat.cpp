@@ -0,0 +1,211 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCat.cpp
+//!
+//! @brief		Decompresses log files written by the compressed backend to
+//!				stdout, from any block, from a pipe, or following a file the
+//!				logger is still writing.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogCompress.h"			// Compressed file reader
+#include	<chrono>					// Follow polling
+#include	<cstdio>					// Output
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// String compares
+#include	<string>					// Strings
+#include	<thread>					// Follow polling
+#ifdef _WIN32
+#include	<io.h>						// _setmode
+#include	<fcntl.h>					// _O_BINARY
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+constexpr int FOLLOW_POLL_MSECS = 200;	// Wait between looks for new frames with -f
+
+// What to do with the file
+struct Options
+{
+	bool		index = false;			// Print the block index instead of the text
+	bool		test = false;			// Decode everything, print only the totals
+	bool		follow = false;			// Keep reading as the logger adds frames
+	uint64_t	seq = 0;				// Start at the first block that can hold this sequence, 0 for the first
+	size_t		block = 0;				// Start at this block
+};
+
+static void PrintIndex(const LogCompressReader& reader)
+{
+	uint64_t packed = 0;
+	uint64_t raw = 0;
+	printf("%8s %14s %14s %12s %12s %10s %10s\n", "block", "file offset", "text offset", "min seq", "max seq", "packed", "text");
+	for (size_t i = 0; i < reader.Blocks().size(); ++i)
+	{
+		const LogCompressIndexRecord& record = reader.Blocks()[i];
+		printf("%8zu %14llu %14llu %12llu %12llu %10u %10u\n", i,
+			static_cast<unsigned long long>(record.fileOffset), static_cast<unsigned long long>(record.rawOffset),
+			static_cast<unsigned long long>(record.minSeq), static_cast<unsigned long long>(record.maxSeq),
+			record.packedBytes, record.rawBytes);
+		packed += record.packedBytes;
+		raw += record.rawBytes;
+	}
+	printf("%zu blocks, %llu bytes of text in %llu (%.2fx)%s\n", reader.Blocks().size(),
+		static_cast<unsigned long long>(raw), static_cast<unsigned long long>(packed),
+		(packed > 0) ? static_cast<double>(raw) / packed : 0.0, reader.Closed() ? "" : ", file not closed");
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	const char* path = nullptr;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		bool hasValue = arg + 1 < argc;
+		if (strcmp(argv[arg], "-i") == 0)
+		{
+			options.index = true;
+		}
+		else if (strcmp(argv[arg], "-t") == 0)
+		{
+			options.test = true;
+		}
+		else if (strcmp(argv[arg], "-f") == 0)
+		{
+			options.follow = true;
+		}
+		else if (strcmp(argv[arg], "-q") == 0 && hasValue)
+		{
+			options.seq = strtoull(argv[++arg], nullptr, 10);
+		}
+		else if (strcmp(argv[arg], "-b") == 0 && hasValue)
+		{
+			options.block = strtoull(argv[++arg], nullptr, 10);
+		}
+		else if (argv[arg][0] != '-' || strcmp(argv[arg], "-") == 0)
+		{
+			path = argv[arg];
+		}
+		else
+		{
+			path = nullptr;
+			break;
+		}
+	}
+
+	if (path == nullptr)
+	{
+		fprintf(stderr, "usage: %s [-i] [-t] [-f] [-b block] [-q sequence] <compressed log file|->\n", argv[0]);
+		fprintf(stderr, "  -i prints the block index, -t checks every block, -f follows a file still being written\n");
+		return 1;
+	}
+
+	LogCompressReader reader;
+	bool stream = strcmp(path, "-") == 0;
+	if (stream)
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		if (!reader.OpenStream(stdin))
+		{
+			fprintf(stderr, "stdin is not a compressed log\n");
+			return 1;
+		}
+	}
+	else if (!reader.Open(path))
+	{
+		fprintf(stderr, "%s is missing or not a compressed log\n", path);
+		return 1;
+	}
+
+	if (options.index && !stream)
+	{
+		PrintIndex(reader);
+		return 0;
+	}
+
+	// Seek to the starting block. Priority lanes write urgent lines ahead of older ones, so block
+	// ranges overlap and are not sorted - the first block whose range covers the sequence wins,
+	// or the first one past it if the sequence was never written.
+	if (!stream && (options.block > 0 || options.seq > 0))
+	{
+		const std::vector<LogCompressIndexRecord>& blocks = reader.Blocks();
+		size_t start = options.block;
+		if (options.seq > 0)
+		{
+			size_t after = blocks.size();
+			start = blocks.size();
+			for (size_t i = 0; i < blocks.size() && start == blocks.size(); ++i)
+			{
+				if (blocks[i].minSeq <= options.seq && options.seq <= blocks[i].maxSeq)
+				{
+					start = i;
+				}
+				else if (blocks[i].minSeq > options.seq && after == blocks.size())
+				{
+					after = i;
+				}
+			}
+			start = (start < blocks.size()) ? start : after;
+		}
+		if (start >= blocks.size())
+		{
+			fprintf(stderr, "%s has %zu blocks\n", path, blocks.size());
+			return 1;
+		}
+		reader.Seek(blocks[start].fileOffset);
+	}
+
+	std::string text;
+	LogCompressFrame frame;
+	uint64_t blocks = 0;
+	uint64_t packed = 0;
+	uint64_t raw = 0;
+	while (true)
+	{
+		frame = {};
+		if (reader.ReadNext(text, frame))
+		{
+			blocks++;
+			packed += frame.packedBytes;
+			raw += frame.rawBytes;
+			if (!options.test)
+			{
+				fwrite(text.data(), 1, text.size(), stdout);
+			}
+			continue;
+		}
+
+		// A bad block stops here, the end of a file still being written waits for more with -f
+		if (reader.Corrupt())
+		{
+			fprintf(stderr, "Corrupt block ending at offset %llu\n", static_cast<unsigned long long>(reader.Position()));
+			return 1;
+		}
+		if (!options.follow || stream || frame.flags == static_cast<uint32_t>(LOG_BLOCK::LOG_BLOCK_INDEX))
+		{
+			break;
+		}
+		fflush(stdout);
+		std::this_thread::sleep_for(std::chrono::milliseconds(FOLLOW_POLL_MSECS));
+	}
+
+	if (options.test)
+	{
+		printf("%llu blocks ok, %llu bytes of text in %llu (%.2fx)\n", static_cast<unsigned long long>(blocks),
+			static_cast<unsigned long long>(raw), static_cast<unsigned long long>(packed),
+			(packed > 0) ? static_cast<double>(raw) / packed : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogCollector.cpp
+//! 
+//! @brief		Standalone collector that drains the shared memory rings of 
+//!				every producer on a channel into one time ordered file.
+//! 
+//! @author		Chip Brommer
+//! 
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogShared.h"			// Shared ring class
+#include	<cstdio>					// File output
+#include	<cstring>					// String compares
+#include	<csignal>					// Shutdown signals
+#include	<ctime>						// Wall clock formatting
+#include	<cerrno>					// Dead producer detection
+#include	<chrono>					// Reorder window
+#include	<map>						// Attached rings
+#include	<memory>					// Ring ownership
+#include	<queue>						// Merge heap
+#include	<string>					// Strings
+#include	<thread>					// Poll sleeps
+#include	<vector>					// Pending records
+#include	<dirent.h>					// Scanning /dev/shm
+#include	<signal.h>					// kill
+#include	<unistd.h>					// getopt
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+// A drained record waiting for its reorder window to pass
+struct PendingRecord
+{
+	uint64_t	timestamp;
+	int			pid;
+	uint64_t	seq;
+	std::string	text;
+
+	bool operator>(const PendingRecord& other) const
+	{
+		return (timestamp != other.timestamp) ? timestamp > other.timestamp : seq > other.seq;
+	}
+};
+
+static volatile sig_atomic_t gRunning = 1;
+
+static void HandleSignal(int)
+{
+	gRunning = 0;
+}
+
+static uint64_t NowNSec()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void WriteRecord(FILE* out, const PendingRecord& record)
+{
+	time_t secs = static_cast<time_t>(record.timestamp / 1000000000ULL);
+	unsigned usecs = static_cast<unsigned>((record.timestamp / 1000ULL) % 1000000ULL);
+	std::tm ttm = { 0 };
+	localtime_r(&secs, &ttm);
+
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y.%m.%d-%H.%M.%S", &ttm);
+	fprintf(out, "%s.%06u - %6d - %s\n", stamp, usecs, record.pid, record.text.c_str());
+}
+
+// Attach any producer rings on the channel not already being drained
+static void ScanProducers(const std::string& channel, std::map<std::string, std::unique_ptr<LogSharedRing>>& rings)
+{
+	const std::string prefix = std::string(LOG_RING_PREFIX) + channel + ".";
+
+	DIR* dir = opendir("/dev/shm");
+	if (dir == nullptr)
+	{
+		return;
+	}
+
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name.compare(0, prefix.size(), prefix) != 0 || rings.count("/" + name) > 0)
+		{
+			continue;
+		}
+
+		std::unique_ptr<LogSharedRing> ring(new LogSharedRing);
+		if (ring->Attach("/" + name))
+		{
+			fprintf(stderr, "Attached producer %d [%s]\n", ring->Header()->pid, name.c_str());
+			rings["/" + name] = std::move(ring);
+		}
+	}
+
+	closedir(dir);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <channel> <output file> [reorder window msec]\n", argv[0]);
+		return 1;
+	}
+
+	std::string channel = argv[1];
+	FILE* out = fopen(argv[2], "a");
+	if (out == nullptr)
+	{
+		fprintf(stderr, "Error opening %s: %s\n", argv[2], strerror(errno));
+		return 1;
+	}
+	setvbuf(out, nullptr, _IOFBF, 1 << 20);
+
+	uint64_t window = (argc > 3 ? strtoull(argv[3], nullptr, 10) : 50) * 1000000ULL;
+
+	signal(SIGINT, HandleSignal);
+	signal(SIGTERM, HandleSignal);
+
+	std::map<std::string, std::unique_ptr<LogSharedRing>> rings;
+	std::map<std::string, uint64_t> dropped;
+	std::priority_queue<PendingRecord, std::vector<PendingRecord>, std::greater<PendingRecord>> pending;
+	auto lastScan = std::chrono::steady_clock::time_point();
+
+	while (gRunning)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastScan > std::chrono::milliseconds(100))
+		{
+			ScanProducers(channel, rings);
+			lastScan = now;
+		}
+
+		// Drain every ring into the merge heap
+		size_t drained = 0;
+		for (auto it = rings.begin(); it != rings.end();)
+		{
+			LogSharedRing* ring = it->second.get();
+			LogRingHeader* header = ring->Header();
+
+			// Read the exit state before draining so nothing pushed in between is lost
+			bool closed = header->closed.load(std::memory_order_acquire) != 0;
+			bool dead = (kill(header->pid, 0) != 0 && errno == ESRCH);
+
+			while (const LogRingRecord* record = ring->Peek())
+			{
+				pending.push(PendingRecord{ record->timestamp, header->pid, record->seq,
+					std::string(reinterpret_cast<const char*>(record + 1), record->length) });
+				ring->Release(record);
+				drained++;
+			}
+
+			uint64_t drops = header->dropped.load(std::memory_order_relaxed);
+			if (drops != dropped[it->first])
+			{
+				pending.push(PendingRecord{ NowNSec(), header->pid, 0,
+					"Collector - ring full, " + std::to_string(drops - dropped[it->first]) + " entries dropped" });
+				dropped[it->first] = drops;
+			}
+
+			if (closed || dead)
+			{
+				if (dead && !closed)
+				{
+					pending.push(PendingRecord{ NowNSec(), header->pid, 0, "Collector - producer exited without closing" });
+				}
+				fprintf(stderr, "Detached producer %d\n", header->pid);
+				ring->Unlink();
+				dropped.erase(it->first);
+				it = rings.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		// Emit everything older than the reorder window in timestamp order
+		uint64_t horizon = NowNSec() - window;
+		bool wrote = false;
+		while (!pending.empty() && pending.top().timestamp <= horizon)
+		{
+			WriteRecord(out, pending.top());
+			pending.pop();
+			wrote = true;
+		}
+
+		if (wrote)
+		{
+			fflush(out);
+		}
+
+		if (drained == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	// Drain what is left and leave the rings for the next collector
+	for (auto& ring : rings)
+	{
+		while (const LogRingRecord* record = ring.second->Peek())
+		{
+			pending.push(PendingRecord{ record->timestamp, ring.second->Header()->pid, record->seq,
+				std::string(reinterpret_cast<const char*>(record + 1), record->length) });
+			ring.second->Release(record);
+		}
+	}
+
+	while (!pending.empty())
+	{
+		WriteRecord(out, pending.top());
+		pending.pop();
+	}
+
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogGrep.cpp
+//!
+//! @brief		Searches log files for lines by level, user and text. Files
+//!				are mapped and split into chunks searched in parallel with
+//!				SIMD, matches are printed in file order.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogLine.h"					// Line parsing
+#include	<algorithm>					// std::min
+#include	<cerrno>					// Open errors
+#include	<condition_variable>		// Ordered output hand off
+#include	<cstdio>					// Output
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// memcmp / memchr
+#include	<mutex>						// Ordered output hand off
+#include	<string>					// Strings
+#include	<thread>					// Search threads
+#include	<vector>					// Files and chunks
+#include	<fcntl.h>					// open
+#include	<sys/mman.h>				// mmap
+#include	<sys/stat.h>				// File size
+#include	<unistd.h>					// close
+#if (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+#include	<immintrin.h>				// SSE2 / AVX2 intrinsics
+#define		LOG_GREP_X86
+#endif
+//
+///////////////////////////////////////////////////////////////////////////////
+
+constexpr size_t CHUNK_BYTES = 8 << 20;			// Bytes searched per task
+constexpr size_t CHUNKS_AHEAD_PER_THREAD = 4;	// Finished chunks that may wait for the printer
+constexpr size_t NOT_FOUND = ~static_cast<size_t>(0);
+
+// Returns the offset of the first needle in the haystack, NOT_FOUND if none
+typedef size_t (*FindFunction)(const char* hay, size_t n, const char* needle, size_t m);
+
+static size_t FindScalar(const char* hay, size_t n, const char* needle, size_t m)
+{
+	if (m > n)
+	{
+		return NOT_FOUND;
+	}
+
+	for (size_t i = 0; i + m <= n; ++i)
+	{
+		const char* first = static_cast<const char*>(memchr(hay + i, needle[0], n - m + 1 - i));
+		if (first == nullptr)
+		{
+			break;
+		}
+		i = first - hay;
+		if (memcmp(first + 1, needle + 1, m - 1) == 0)
+		{
+			return i;
+		}
+	}
+	return NOT_FOUND;
+}
+
+#ifdef LOG_GREP_X86
+// Compares the needle's first and last bytes against a whole vector of positions at once and
+// only runs memcmp where both match, which on log text is rarely a false hit
+__attribute__((target("sse2")))
+static size_t FindSse2(const char* hay, size_t n, const char* needle, size_t m)
+{
+	if (m > n)
+	{
+		return NOT_FOUND;
+	}
+
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[m - 1]);
+	size_t i = 0;
+	for (; i + m - 1 + 16 <= n; i += 16)
+	{
+		__m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+		__m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+		while (mask != 0)
+		{
+			unsigned bit = __builtin_ctz(mask);
+			if (m <= 2 || memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+			{
+				return i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	size_t rest = FindScalar(hay + i, n - i, needle, m);
+	return (rest == NOT_FOUND) ? NOT_FOUND : i + rest;
+}
+
+__attribute__((target("avx2")))
+static size_t FindAvx2(const char* hay, size_t n, const char* needle, size_t m)
+{
+	if (m > n)
+	{
+		return NOT_FOUND;
+	}
+
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+	size_t i = 0;
+	for (; i + m - 1 + 32 <= n; i += 32)
+	{
+		__m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+		__m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+		unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast)));
+		while (mask != 0)
+		{
+			unsigned bit = __builtin_ctz(mask);
+			if (m <= 2 || memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+			{
+				return i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	size_t rest = FindSse2(hay + i, n - i, needle, m);
+	return (rest == NOT_FOUND) ? NOT_FOUND : i + rest;
+}
+#endif
+
+static FindFunction gFind = FindScalar;
+
+// What to match
+struct Filter
+{
+	int				maxLevel = 4;		// Most verbose level printed
+	std::string		user;				// Only lines of this user, empty for all
+	std::string		text;				// Only lines containing this, empty for all
+	std::string		needle;				// Literal searched for, empty to visit every line
+};
+
+// A mapped log file
+struct MappedFile
+{
+	std::string		path;
+	const char*		data;
+	size_t			size;
+	size_t			firstChunk;			// Index of the file's first chunk
+};
+
+// Output of a chunk, printed once every earlier chunk is
+struct ChunkResult
+{
+	std::string		text;
+	size_t			matches = 0;
+	bool			done = false;
+};
+
+static bool Matches(const Filter& filter, const char* text, size_t length)
+{
+	LogLine line;
+	if (!ParseLogLine(text, length, line) || line.level > filter.maxLevel)
+	{
+		return false;
+	}
+
+	if (!filter.user.empty() && (line.userLength != filter.user.size() || memcmp(line.user, filter.user.data(), line.userLength) != 0))
+	{
+		return false;
+	}
+
+	// The needle may have been the level or user, so the text is checked on its own
+	return filter.text.empty() || filter.text == filter.needle || gFind(text, length, filter.text.data(), filter.text.size()) != NOT_FOUND;
+}
+
+// Chunks start on the line after their nominal offset, so no line is split between two
+static size_t ChunkStart(const MappedFile& file, size_t chunk)
+{
+	size_t offset = chunk * CHUNK_BYTES;
+	if (chunk == 0)
+	{
+		return 0;
+	}
+	if (offset >= file.size)
+	{
+		return file.size;
+	}
+
+	const char* newline = static_cast<const char*>(memchr(file.data + offset - 1, '\n', file.size - offset + 1));
+	return (newline == nullptr) ? file.size : newline - file.data + 1;
+}
+
+static void SearchChunk(const MappedFile& file, size_t chunk, const Filter& filter, const std::string& prefix, bool countOnly, ChunkResult& result)
+{
+	size_t pos = ChunkStart(file, chunk);
+	size_t end = ChunkStart(file, chunk + 1);
+	const char* data = file.data;
+
+	auto report = [&](size_t lineStart, size_t lineEnd)
+	{
+		result.matches++;
+		if (!countOnly)
+		{
+			result.text += prefix;
+			result.text.append(data + lineStart, lineEnd - lineStart);
+			result.text += '\n';
+		}
+	};
+
+	while (pos < end)
+	{
+		if (filter.needle.empty())
+		{
+			// Visit every line, the newline search is the same SIMD scan with a one byte needle
+			size_t newline = gFind(data + pos, end - pos, "\n", 1);
+			size_t lineEnd = (newline == NOT_FOUND) ? end : pos + newline;
+			if (Matches(filter, data + pos, lineEnd - pos))
+			{
+				report(pos, lineEnd);
+			}
+			pos = lineEnd + 1;
+			continue;
+		}
+
+		size_t hit = gFind(data + pos, end - pos, filter.needle.data(), filter.needle.size());
+		if (hit == NOT_FOUND)
+		{
+			break;
+		}
+		hit += pos;
+
+		size_t lineStart = hit;
+		while (lineStart > pos && data[lineStart - 1] != '\n')
+		{
+			lineStart--;
+		}
+		const char* newline = static_cast<const char*>(memchr(data + hit, '\n', end - hit));
+		size_t lineEnd = (newline == nullptr) ? end : newline - data;
+
+		if (Matches(filter, data + lineStart, lineEnd - lineStart))
+		{
+			report(lineStart, lineEnd);
+		}
+		pos = lineEnd + 1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Filter filter;
+	bool countOnly = false;
+	int prefixMode = -1;
+	unsigned threads = std::thread::hardware_concurrency();
+	std::vector<MappedFile> files;
+	bool usage = false;
+
+	for (int arg = 1; arg < argc && !usage; ++arg)
+	{
+		std::string option = argv[arg];
+		bool hasValue = arg + 1 < argc;
+		if (option == "-l" && hasValue)
+		{
+			filter.maxLevel = ParseLogLevel(argv[arg + 1], strlen(argv[arg + 1]));
+			usage = filter.maxLevel <= 0;
+			arg++;
+		}
+		else if (option == "-u" && hasValue)
+		{
+			filter.user = argv[++arg];
+		}
+		else if (option == "-e" && hasValue)
+		{
+			filter.text = argv[++arg];
+		}
+		else if (option == "-j" && hasValue)
+		{
+			threads = static_cast<unsigned>(atoi(argv[++arg]));
+		}
+		else if (option == "-c")
+		{
+			countOnly = true;
+		}
+		else if (option == "-H" || option == "-h")
+		{
+			prefixMode = (option == "-H");
+		}
+		else if (option[0] == '-')
+		{
+			usage = true;
+		}
+		else
+		{
+			files.push_back(MappedFile{ option, nullptr, 0, 0 });
+		}
+	}
+
+	if (usage || files.empty())
+	{
+		fprintf(stderr, "usage: %s [-l ERROR|WARN|INFO|DEBUG] [-u user] [-e text] [-c] [-H|-h] [-j threads] <log file>...\n", argv[0]);
+		return 2;
+	}
+
+#ifdef LOG_GREP_X86
+	__builtin_cpu_init();
+	gFind = __builtin_cpu_supports("avx2") ? FindAvx2 : FindSse2;
+#endif
+
+	// Search for the longest literal the filter implies and check the rest on the lines it hits
+	std::string candidates[] = { filter.text, filter.user.empty() ? std::string() : " - " + filter.user + " - ",
+		(filter.maxLevel == 1) ? std::string("ERROR - ") : std::string() };
+	for (const std::string& candidate : candidates)
+	{
+		if (candidate.size() > filter.needle.size())
+		{
+			filter.needle = candidate;
+		}
+	}
+
+	// Map every file, numbering the chunks across all of them
+	size_t chunks = 0;
+	for (MappedFile& file : files)
+	{
+		file.firstChunk = chunks;
+		int fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0)
+		{
+			fprintf(stderr, "Error opening %s: %s\n", file.path.c_str(), strerror(errno));
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+			continue;
+		}
+
+		file.size = static_cast<size_t>(st.st_size);
+		if (file.size > 0)
+		{
+			void* map = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map == MAP_FAILED)
+			{
+				fprintf(stderr, "Error mapping %s: %s\n", file.path.c_str(), strerror(errno));
+				file.size = 0;
+			}
+			else
+			{
+				// Advice values are not flags - read ahead is asked for chunk by chunk as workers take them
+				madvise(map, file.size, MADV_SEQUENTIAL);
+				file.data = static_cast<const char*>(map);
+			}
+		}
+		close(fd);
+
+		chunks += (file.size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+	}
+
+	threads = std::max(1u, threads);
+	bool prefix = (prefixMode < 0) ? files.size() > 1 : prefixMode == 1;
+	size_t ahead = threads * CHUNKS_AHEAD_PER_THREAD;
+	std::vector<ChunkResult> results(chunks);
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t nextChunk = 0;
+	size_t printedChunk = 0;
+
+	// Workers take chunks in order, staying a bounded distance ahead of the printer
+	auto worker = [&]
+	{
+		while (true)
+		{
+			size_t chunk;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return nextChunk >= chunks || nextChunk < printedChunk + ahead; });
+				if (nextChunk >= chunks)
+				{
+					return;
+				}
+				chunk = nextChunk++;
+			}
+
+			size_t index = 0;
+			while (index + 1 < files.size() && files[index + 1].firstChunk <= chunk)
+			{
+				index++;
+			}
+			const MappedFile& file = files[index];
+
+			// Chunk offsets are multiples of CHUNK_BYTES, so page aligned within the mapping
+			size_t offset = (chunk - file.firstChunk) * CHUNK_BYTES;
+			madvise(const_cast<char*>(file.data) + offset, std::min(CHUNK_BYTES, file.size - offset), MADV_WILLNEED);
+
+			ChunkResult result;
+			SearchChunk(file, chunk - file.firstChunk, filter, prefix ? file.path + ":" : std::string(), countOnly, result);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				results[chunk].text.swap(result.text);
+				results[chunk].matches = result.matches;
+				results[chunk].done = true;
+			}
+			cv.notify_all();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 0; i < threads; ++i)
+	{
+		pool.emplace_back(worker);
+	}
+
+	static char outBuffer[1 << 20];
+	setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+	size_t total = 0;
+	size_t fileIndex = 0;
+	size_t fileMatches = 0;
+	for (size_t chunk = 0; chunk <= chunks; ++chunk)
+	{
+		// Per file counts are reported as the printer passes each file's last chunk
+		while (fileIndex < files.size() && (fileIndex + 1 == files.size() ? chunk == chunks : files[fileIndex + 1].firstChunk <= chunk))
+		{
+			if (countOnly)
+			{
+				if (prefix)
+				{
+					printf("%s:%zu\n", files[fileIndex].path.c_str(), fileMatches);
+				}
+				else if (fileIndex + 1 == files.size())
+				{
+					printf("%zu\n", total);
+				}
+			}
+			fileMatches = 0;
+			fileIndex++;
+		}
+		if (chunk == chunks)
+		{
+			break;
+		}
+
+		std::string text;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return results[chunk].done; });
+			text.swap(results[chunk].text);
+			fileMatches += results[chunk].matches;
+			total += results[chunk].matches;
+			printedChunk = chunk + 1;
+		}
+		cv.notify_all();
+		fwrite(text.data(), 1, text.size(), stdout);
+	}
+
+	for (std::thread& thread : pool)
+	{
+		thread.join();
+	}
+	fflush(stdout);
+
+	for (MappedFile& file : files)
+	{
+		if (file.data != nullptr)
+		{
+			munmap(const_cast<char*>(file.data), file.size);
+		}
+	}
+
+	return (total > 0) ? 0 : 1;
+}
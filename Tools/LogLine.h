@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogLine.h
+//!
+//! @brief		Parses the fields of a log file line for the command line
+//!				tools.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	<stdint.h>					// Standard integer types
+#include	<cstddef>					// size_t
+#include	<cstring>					// String compares
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_LINE				// Define the line parser.
+#define     CPP_LOGGER_LINE
+//
+constexpr uint64_t LOG_LINE_NO_TIME = ~0ull;	//! Line without a timestamp
+constexpr int LOG_LINE_LEVELS = 5;				//! LOG_LEVEL values
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Fields of a parsed line
+struct LogLine
+{
+	uint64_t		relUSecs;			// Line timestamp, LOG_LINE_NO_TIME if the line has none
+	int				level;				// LOG_LEVEL, -1 if not recognized
+	const char*		user;				// Start of the user name
+	size_t			userLength;			// Length of the user name
+};
+
+static const char* const gLogLineLevels[LOG_LINE_LEVELS] = { "NONE", "ERROR", "WARN", "INFO", "DEBUG" };
+
+//! @brief Level of a level name.
+//! @return LOG_LEVEL value, -1 if not a level name
+static inline int ParseLogLevel(const char* text, size_t length)
+{
+	for (int level = 0; level < LOG_LINE_LEVELS; ++level)
+	{
+		if (strlen(gLogLineLevels[level]) == length && strncmp(text, gLogLineLevels[level], length) == 0)
+		{
+			return level;
+		}
+	}
+	return -1;
+}
+
+//! @brief Splits "[#seq ][{thread} ][[ts] ]LEVEL - user - message".
+//! @param text - line without its newline.
+//! @param length - bytes in the line.
+//! @param line - receives the fields.
+//! @return false if the line is not in the logger's format
+static inline bool ParseLogLine(const char* text, size_t length, LogLine& line)
+{
+	const char* p = text;
+	const char* end = text + length;
+	line.relUSecs = LOG_LINE_NO_TIME;
+
+	if (p < end && *p == '#')
+	{
+		while (p < end && *p != ' ') p++;
+		p++;
+	}
+
+	if (p < end && *p == '{')
+	{
+		while (p < end && *p != '}') p++;
+		p += 2;
+	}
+
+	if (p < end && *p == '[')
+	{
+		uint64_t msecs = 0;
+		uint64_t usecs = 0;
+		p++;
+		while (p < end && *p == ' ') p++;
+		while (p < end && *p >= '0' && *p <= '9') msecs = msecs * 10 + (*p++ - '0');
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && *p >= '0' && *p <= '9') usecs = usecs * 10 + (*p++ - '0');
+		}
+		if (p >= end || *p != ']')
+		{
+			return false;
+		}
+		line.relUSecs = msecs * 1000 + usecs;
+		p += 2;
+	}
+
+	const char* level = p;
+	while (p < end && *p != ' ') p++;
+	line.level = ParseLogLevel(level, p - level);
+	if (line.level < 0 || end - p < 3 || strncmp(p, " - ", 3) != 0)
+	{
+		return false;
+	}
+
+	p += 3;
+	line.user = p;
+	while (p + 3 <= end && strncmp(p, " - ", 3) != 0) p++;
+	line.userLength = p - line.user;
+	return true;
+}
+#endif // CPP_LOGGER_LINE
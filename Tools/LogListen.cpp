@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogListen.cpp
+//!
+//! @brief		Stand-in aggregation agent for trying the socket sink by
+//!				hand. Receives entries on a Unix domain, TCP or UDP socket,
+//!				prints what arrived every second and can go down on a
+//!				schedule to exercise the sink's backoff and spill replay.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"LogListener.h"				// Stand-in listener
+#include	<chrono>					// Reports and outages
+#include	<csignal>					// Stopping on Ctrl-C
+#include	<cstdio>					// Output
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// String compares
+#include	<thread>					// Outages
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+static volatile sig_atomic_t gStop = 0;		// Set by SIGINT / SIGTERM
+
+static void OnSignal(int)
+{
+	gStop = 1;
+}
+
+static void PrintCounts(const LogListenCounts& counts, uint64_t outages)
+{
+	printf("%llu entries in %llu reads (%.1f per read), %llu bytes, %llu connections, %llu outages",
+		static_cast<unsigned long long>(counts.entries), static_cast<unsigned long long>(counts.reads),
+		(counts.reads > 0) ? static_cast<double>(counts.entries) / counts.reads : 0.0,
+		static_cast<unsigned long long>(counts.bytes), static_cast<unsigned long long>(counts.connections),
+		static_cast<unsigned long long>(outages));
+	if (counts.lastSeq > 0)
+	{
+		printf(", last seq %llu, %llu missing, %llu out of order", static_cast<unsigned long long>(counts.lastSeq),
+			static_cast<unsigned long long>(counts.gaps), static_cast<unsigned long long>(counts.outOfOrder));
+	}
+	printf(", %llu cut off\n", static_cast<unsigned long long>(counts.partial));
+	fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+	LOG_SOCKET type = LOG_SOCKET::LOG_SOCKET_UNIX;
+	std::string address;
+	uint16_t port = 0;
+	bool binary = false;
+	bool echo = false;
+	uint64_t outageEvery = 0;
+	uint32_t outageMSecs = 1000;
+	bool usage = false;
+
+	for (int arg = 1; arg < argc && !usage; ++arg)
+	{
+		bool hasValue = arg + 1 < argc;
+		if (strcmp(argv[arg], "-u") == 0 && hasValue)
+		{
+			type = LOG_SOCKET::LOG_SOCKET_UNIX;
+			address = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "-d") == 0 && hasValue)
+		{
+			type = LOG_SOCKET::LOG_SOCKET_UNIX_DGRAM;
+			address = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "-t") == 0 && hasValue)
+		{
+			type = LOG_SOCKET::LOG_SOCKET_TCP;
+			port = static_cast<uint16_t>(strtoul(argv[++arg], nullptr, 10));
+		}
+		else if (strcmp(argv[arg], "-p") == 0 && hasValue)
+		{
+			type = LOG_SOCKET::LOG_SOCKET_UDP;
+			port = static_cast<uint16_t>(strtoul(argv[++arg], nullptr, 10));
+		}
+		else if (strcmp(argv[arg], "-b") == 0)
+		{
+			binary = true;
+		}
+		else if (strcmp(argv[arg], "-e") == 0)
+		{
+			echo = true;
+		}
+		else if (strcmp(argv[arg], "-k") == 0 && hasValue)
+		{
+			outageEvery = strtoull(argv[++arg], nullptr, 10);
+		}
+		else if (strcmp(argv[arg], "-o") == 0 && hasValue)
+		{
+			outageMSecs = static_cast<uint32_t>(strtoul(argv[++arg], nullptr, 10));
+		}
+		else
+		{
+			usage = true;
+		}
+	}
+
+	if (usage || (address.empty() && port == 0))
+	{
+		fprintf(stderr, "usage: %s (-u path | -d path | -t port | -p port) [-b] [-e] [-k entries] [-o msecs]\n", argv[0]);
+		fprintf(stderr, "  -u/-d Unix stream/datagram, -t/-p TCP/UDP on loopback, -b binary frames, -e echo entries\n");
+		fprintf(stderr, "  -k goes down for -o msecs (default 1000) after every N entries, so the sink spills and replays\n");
+		return 1;
+	}
+
+	LogListener listener(type, address, port, binary);
+	if (!listener.Open())
+	{
+		fprintf(stderr, "Could not listen on %s\n", address.empty() ? std::to_string(port).c_str() : address.c_str());
+		return 1;
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	// The per second report is left out while the entries themselves are echoed
+	uint64_t outages = 0;
+	uint64_t nextOutage = outageEvery;
+	auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (!gStop)
+	{
+		listener.Poll(100, echo ? stdout : nullptr);
+
+		if (outageEvery > 0 && listener.Counts().entries >= nextOutage)
+		{
+			listener.Close();
+			outages++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(outageMSecs));
+			if (!listener.Open())
+			{
+				fprintf(stderr, "Could not listen again\n");
+				return 1;
+			}
+			nextOutage = listener.Counts().entries + outageEvery;
+		}
+
+		if (!echo && std::chrono::steady_clock::now() >= nextReport)
+		{
+			PrintCounts(listener.Counts(), outages);
+			nextReport += std::chrono::seconds(1);
+		}
+	}
+
+	PrintCounts(listener.Counts(), outages);
+	return 0;
+}
@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogListener.h
+//!
+//! @brief		A stand-in for the aggregation agent the socket sink ships
+//!				to. Accepts Unix domain, TCP and UDP senders, counts the
+//!				batches and entries received and checks the sequence order
+//!				of binary framed entries. POSIX only.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+#pragma once
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogSocketSink.h"		// Transports and binary frame header
+#include	<stdint.h>					// Standard integer types
+#include	<cstdio>					// Echoed entries
+#include	<cstring>					// memcpy
+#include	<string>					// Strings
+#include	<vector>					// Connections
+#include	<sys/socket.h>				// Sockets
+#include	<sys/un.h>					// Unix domain addresses
+#include	<netinet/in.h>				// Loopback addresses
+#include	<poll.h>					// Waiting for senders
+#include	<unistd.h>					// close / unlink
+//
+//	Defines:
+//          name                        reason defined
+//          --------------------        ---------------------------------------
+#ifndef     CPP_LOGGER_LISTENER			// Define the stand-in listener.
+#define     CPP_LOGGER_LISTENER
+//
+constexpr size_t LOG_LISTEN_READ_BYTES = 64 * 1024;		//! Largest single read or datagram
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// What the listener has received so far
+struct LogListenCounts
+{
+	uint64_t		reads = 0;			// Reads or datagrams that carried data, one batch or more each
+	uint64_t		bytes = 0;			// Bytes received
+	uint64_t		entries = 0;		// Complete entries received
+	uint64_t		lastSeq = 0;		// Highest sequence seen, binary framing only
+	uint64_t		gaps = 0;			// Sequences skipped over, binary framing only
+	uint64_t		outOfOrder = 0;		// Entries at or below a sequence already seen, binary framing only
+	uint64_t		partial = 0;		// Connections that closed mid entry
+	uint64_t		connections = 0;	// Stream connections accepted
+};
+
+class LogListener
+{
+public:
+	//! @brief Constructor
+	//! @param type - transport to listen on.
+	//! @param address - socket path for Unix sockets, ignored otherwise (loopback).
+	//! @param port - port for TCP and UDP.
+	//! @param binary - senders use LogFrameHeader framing instead of text lines.
+	LogListener(Essentials::LOG_SOCKET type, const std::string& address, uint16_t port, bool binary)
+	{
+		mType = type;
+		mAddress = address;
+		mPort = port;
+		mBinary = binary;
+		mSocket = -1;
+	}
+
+	//! @brief Deconstructor - closes every socket.
+	~LogListener()
+	{
+		Close();
+	}
+
+	//! @brief Binds the socket, and listens on it for stream transports.
+	//! @return false if the address could not be bound
+	bool Open()
+	{
+		bool unixSocket = IsUnix();
+		bool stream = IsStream();
+		mSocket = socket(unixSocket ? AF_UNIX : AF_INET, stream ? SOCK_STREAM : SOCK_DGRAM, 0);
+		if (mSocket < 0)
+		{
+			return false;
+		}
+
+		int bound = -1;
+		if (unixSocket)
+		{
+			sockaddr_un addr = {};
+			addr.sun_family = AF_UNIX;
+			strncpy(addr.sun_path, mAddress.c_str(), sizeof(addr.sun_path) - 1);
+			unlink(mAddress.c_str());
+			bound = bind(mSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		}
+		else
+		{
+			int reuse = 1;
+			setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+			sockaddr_in addr = {};
+			addr.sin_family = AF_INET;
+			addr.sin_port = htons(mPort);
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bound = bind(mSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		}
+
+		if (bound != 0 || (stream && listen(mSocket, 8) != 0))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	//! @brief Closes the listening socket and every connection, as an agent going down would.
+	void Close()
+	{
+		for (Connection& connection : mConnections)
+		{
+			Drop(connection);
+		}
+		mConnections.clear();
+
+		if (mSocket >= 0)
+		{
+			close(mSocket);
+			mSocket = -1;
+			if (IsUnix())
+			{
+				unlink(mAddress.c_str());
+			}
+		}
+	}
+
+	//! @brief Whether the listener is up.
+	bool IsOpen() const { return mSocket >= 0; }
+
+	//! @brief Accepts senders and reads what arrived, waiting up to the given time for the first data.
+	//! @param msecs - longest wait.
+	//! @param echo - receives each entry's text as a line, nullptr to only count.
+	//! @return entries received by this call
+	uint64_t Poll(int msecs, FILE* echo)
+	{
+		if (mSocket < 0)
+		{
+			return 0;
+		}
+
+		std::vector<pollfd> fds;
+		fds.push_back(pollfd{ mSocket, POLLIN, 0 });
+		for (const Connection& connection : mConnections)
+		{
+			fds.push_back(pollfd{ connection.fd, POLLIN, 0 });
+		}
+		if (poll(fds.data(), fds.size(), msecs) <= 0)
+		{
+			return 0;
+		}
+
+		uint64_t before = mCounts.entries;
+		std::vector<char> buffer(LOG_LISTEN_READ_BYTES);
+		if (fds[0].revents & POLLIN)
+		{
+			if (IsStream())
+			{
+				int fd = accept(mSocket, nullptr, nullptr);
+				if (fd >= 0)
+				{
+					mConnections.push_back(Connection{ fd, std::string() });
+					mCounts.connections++;
+				}
+			}
+			else
+			{
+				// Each datagram holds whole entries
+				ssize_t length;
+				while ((length = recv(mSocket, buffer.data(), buffer.size(), MSG_DONTWAIT)) > 0)
+				{
+					std::string datagram(buffer.data(), static_cast<size_t>(length));
+					mCounts.reads++;
+					mCounts.bytes += static_cast<uint64_t>(length);
+					Consume(datagram, echo);
+				}
+			}
+		}
+
+		for (size_t i = 1; i < fds.size(); ++i)
+		{
+			if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+			{
+				continue;
+			}
+
+			Connection& connection = mConnections[i - 1];
+			ssize_t length = recv(connection.fd, buffer.data(), buffer.size(), 0);
+			if (length > 0)
+			{
+				connection.pending.append(buffer.data(), static_cast<size_t>(length));
+				mCounts.reads++;
+				mCounts.bytes += static_cast<uint64_t>(length);
+				Consume(connection.pending, echo);
+			}
+			else
+			{
+				Drop(connection);
+			}
+		}
+
+		// Forget the connections the senders closed
+		for (size_t i = 0; i < mConnections.size();)
+		{
+			if (mConnections[i].fd < 0)
+			{
+				mConnections[i] = mConnections.back();
+				mConnections.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+		return mCounts.entries - before;
+	}
+
+	//! @brief Totals since construction.
+	const LogListenCounts& Counts() const { return mCounts; }
+
+protected:
+private:
+	// An accepted stream sender
+	struct Connection
+	{
+		int				fd;				// Connected socket, -1 once closed
+		std::string		pending;		// Bytes of an entry not yet complete
+	};
+
+	bool IsUnix() const
+	{
+		return mType == Essentials::LOG_SOCKET::LOG_SOCKET_UNIX || mType == Essentials::LOG_SOCKET::LOG_SOCKET_UNIX_DGRAM;
+	}
+
+	bool IsStream() const
+	{
+		return mType == Essentials::LOG_SOCKET::LOG_SOCKET_UNIX || mType == Essentials::LOG_SOCKET::LOG_SOCKET_TCP;
+	}
+
+	//! @brief Closes a connection, counting an entry cut off by the close.
+	void Drop(Connection& connection)
+	{
+		if (connection.fd >= 0)
+		{
+			close(connection.fd);
+			connection.fd = -1;
+		}
+		if (!connection.pending.empty())
+		{
+			mCounts.partial++;
+			connection.pending.clear();
+		}
+	}
+
+	//! @brief Counts the complete entries at the front of the data and removes them.
+	void Consume(std::string& data, FILE* echo)
+	{
+		size_t offset = 0;
+		while (offset < data.size())
+		{
+			const char* text = nullptr;
+			size_t length = 0;
+			if (mBinary)
+			{
+				Essentials::LogFrameHeader header;
+				if (data.size() - offset < sizeof(header))
+				{
+					break;
+				}
+				memcpy(&header, data.data() + offset, sizeof(header));
+				if (data.size() - offset - sizeof(header) < header.length)
+				{
+					break;
+				}
+
+				if (header.seq <= mCounts.lastSeq)
+				{
+					mCounts.outOfOrder++;
+				}
+				else
+				{
+					mCounts.gaps += header.seq - mCounts.lastSeq - 1;
+					mCounts.lastSeq = header.seq;
+				}
+				text = data.data() + offset + sizeof(header);
+				length = header.length;
+				offset += sizeof(header) + header.length;
+			}
+			else
+			{
+				size_t end = data.find('\n', offset);
+				if (end == std::string::npos)
+				{
+					break;
+				}
+				text = data.data() + offset;
+				length = end - offset;
+				offset = end + 1;
+			}
+
+			mCounts.entries++;
+			if (echo != nullptr)
+			{
+				fwrite(text, 1, length, echo);
+				fputc('\n', echo);
+			}
+		}
+		data.erase(0, offset);
+	}
+
+	Essentials::LOG_SOCKET		mType;			// Transport
+	std::string					mAddress;		// Socket path for Unix sockets
+	uint16_t					mPort;			// TCP / UDP port
+	bool						mBinary;		// Binary framing ?
+	int							mSocket;		// Listening or datagram socket, -1 while down
+	std::vector<Connection>		mConnections;	// Accepted stream senders
+	LogListenCounts				mCounts;		// Totals
+};
+#endif // CPP_LOGGER_LISTENER
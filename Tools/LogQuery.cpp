@@ -0,0 +1,366 @@
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! @file		LogQuery.cpp
+//!
+//! @brief		Prints the lines of a time window from one or more log files,
+//!				using their time indexes to read only the buckets that can
+//!				hold matching lines.
+//!
+//! @author		Chip Brommer
+//!
+//! @date		< 12 / 15 / 2022 > Initial Start Date
+//!
+/*****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Includes:
+//          name                        reason included
+//          --------------------        ---------------------------------------
+#include	"../LogIndex.h"				// Index records
+#include	"LogLine.h"					// Line parsing
+#include	<algorithm>					// Sorting segments
+#include	<cstdio>					// Output
+#include	<cstdlib>					// Arguments
+#include	<cstring>					// String compares
+#include	<ctime>						// Wall clock parsing and formatting
+#include	<fstream>					// Reading log files
+#include	<string>					// Strings
+#include	<vector>					// Segments and ranges
+//
+///////////////////////////////////////////////////////////////////////////////
+
+using namespace Essentials;
+
+constexpr size_t READ_CHUNK_BYTES = 1 << 20;						// Log file read size
+constexpr uint64_t STAMP_WRAP_USECS = 4294967296ull * 1000;			// Line timestamps wrap at 2^32 msecs
+constexpr uint64_t NO_TIME = LOG_LINE_NO_TIME;						// Line or bucket without a wall clock
+
+// A log file and its index
+struct Segment
+{
+	std::string					path;
+	bool						indexed;
+	LogIndexHeader				header;
+	std::vector<LogIndexRecord>	records;
+};
+
+// What to print
+struct Query
+{
+	uint64_t		start = 0;				// Window start, usecs since the epoch
+	uint64_t		end = NO_TIME;			// Window end, usecs since the epoch
+	uint64_t		slackUSecs = 1000000;	// Longest an entry may wait in the queue, only used for lines without timestamps
+	int				maxLevel = 4;			// Most verbose level printed
+	std::string		user;					// Only lines of this user, empty for all
+};
+
+// Line timestamps are msecs in 32 bits - pick the wrap closest to the bucket's wall clock
+static uint64_t LineWall(const Segment& segment, uint64_t relUSecs, uint64_t bucketWall)
+{
+	uint64_t base = segment.header.wallBaseUSecs;
+	uint64_t wraps = 0;
+	if (bucketWall != NO_TIME && bucketWall > base + relUSecs)
+	{
+		wraps = (bucketWall - base - relUSecs + STAMP_WRAP_USECS / 2) / STAMP_WRAP_USECS;
+	}
+	return base + relUSecs + wraps * STAMP_WRAP_USECS;
+}
+
+static void PrintWall(uint64_t wallUSecs)
+{
+	time_t secs = static_cast<time_t>(wallUSecs / 1000000);
+	std::tm ttm = {};
+#ifdef _WIN32
+	localtime_s(&ttm, &secs);
+#else
+	localtime_r(&secs, &ttm);
+#endif
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y.%m.%d-%H.%M.%S", &ttm);
+	printf("%s.%06u ", stamp, static_cast<unsigned>(wallUSecs % 1000000));
+}
+
+// Prints the matching lines in [begin, end) of a segment, returns the lines printed.
+// oldest receives the earliest line timestamp in the range, NO_TIME if no line has one.
+static size_t ScanRange(const Segment& segment, std::ifstream& file, uint64_t begin, uint64_t end, uint64_t bucketWall, const Query& query, uint64_t& oldest)
+{
+	std::vector<char> buffer(READ_CHUNK_BYTES);
+	std::string carry;
+	size_t printed = 0;
+
+	file.clear();
+	file.seekg(static_cast<std::streamoff>(begin));
+	while (begin < end && file)
+	{
+		size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), end - begin));
+		file.read(buffer.data(), want);
+		size_t got = static_cast<size_t>(file.gcount());
+		if (got == 0)
+		{
+			break;
+		}
+		begin += got;
+
+		// Lines straddling chunks are stitched through the carry
+		carry.append(buffer.data(), got);
+		size_t lineStart = 0;
+		size_t newline;
+		while ((newline = carry.find('\n', lineStart)) != std::string::npos)
+		{
+			const char* text = carry.data() + lineStart;
+			size_t length = newline - lineStart;
+			lineStart = newline + 1;
+
+			LogLine line;
+			if (!ParseLogLine(text, length, line))
+			{
+				continue;
+			}
+
+			// Lines without a timestamp fall back to the time of their bucket
+			uint64_t wall = bucketWall;
+			if (line.relUSecs != NO_TIME && segment.indexed)
+			{
+				wall = LineWall(segment, line.relUSecs, bucketWall);
+				oldest = std::min(oldest, wall);
+			}
+
+			if (line.level > query.maxLevel)
+			{
+				continue;
+			}
+
+			if (!query.user.empty() && (line.userLength != query.user.size() || strncmp(line.user, query.user.data(), line.userLength) != 0))
+			{
+				continue;
+			}
+
+			if (wall != NO_TIME && (wall < query.start || wall > query.end))
+			{
+				continue;
+			}
+
+			if (wall != NO_TIME)
+			{
+				PrintWall(wall);
+			}
+			fwrite(text, 1, length, stdout);
+			putchar('\n');
+			printed++;
+		}
+		carry.erase(0, lineStart);
+
+		// A mapped file still being written ends in zeros
+		if (!carry.empty() && carry[0] == '\0')
+		{
+			break;
+		}
+	}
+	return printed;
+}
+
+// Reads only the buckets of a segment that can hold matching lines
+static void ScanSegment(const Segment& segment, const Query& query, uint64_t& bytesRead, size_t& printed)
+{
+	std::ifstream file(segment.path, std::ios::binary);
+	if (!file.is_open())
+	{
+		fprintf(stderr, "Error opening %s\n", segment.path.c_str());
+		return;
+	}
+
+	file.seekg(0, std::ios::end);
+	uint64_t fileBytes = static_cast<uint64_t>(file.tellg());
+
+	if (!segment.indexed)
+	{
+		uint64_t oldest = NO_TIME;
+		bytesRead += fileBytes;
+		printed += ScanRange(segment, file, 0, fileBytes, NO_TIME, query, oldest);
+		return;
+	}
+
+	uint32_t wanted = 0;
+	for (int level = 1; level <= query.maxLevel; ++level)
+	{
+		wanted |= 1u << level;
+	}
+
+	// Bucket i holds lines written from its time until the next bucket's. The last one
+	// runs to the end of the file, which covers lines written after the index was flushed.
+	const std::vector<LogIndexRecord>& records = segment.records;
+	uint64_t lastWrite = (query.end > NO_TIME - query.slackUSecs) ? NO_TIME : query.end + query.slackUSecs;
+	bool stamped = false;
+	size_t i = 0;
+	uint64_t firstOffset = records.empty() ? 0 : records[0].offset;
+	if (firstOffset > 0)
+	{
+		uint64_t oldest = NO_TIME;
+		bytesRead += firstOffset;
+		printed += ScanRange(segment, file, 0, firstOffset, NO_TIME, query, oldest);
+	}
+
+	while (i < records.size())
+	{
+		const LogIndexRecord& record = records[i];
+		uint64_t writtenUntil = (i + 1 < records.size()) ? records[i + 1].wallUSecs : NO_TIME;
+		uint64_t endOffset = (i + 1 < records.size()) ? records[i + 1].offset : fileBytes;
+
+		// Lines are written after they are logged - with priority lanes a backlog line can trail the
+		// window by any amount, so buckets written after it are read until one holds only later lines.
+		// The lanes write the backlog in logging order, so every bucket after that one does too.
+		// Lines without timestamps cannot say when they were logged, the slack bounds the wait instead.
+		if (writtenUntil >= query.start && (record.levels & wanted) != 0)
+		{
+			uint64_t oldest = NO_TIME;
+			bytesRead += endOffset - record.offset;
+			printed += ScanRange(segment, file, record.offset, endOffset, record.wallUSecs, query, oldest);
+			stamped |= (oldest != NO_TIME);
+			if (record.wallUSecs > query.end && (stamped ? oldest > query.end : record.wallUSecs > lastWrite))
+			{
+				break;
+			}
+		}
+		else if (!stamped && record.wallUSecs > lastWrite)
+		{
+			break;
+		}
+		i++;
+	}
+}
+
+// Accepts "YYYY.MM.DD-HH.MM.SS", "HH:MM[:SS]" on the day of the first segment, or "@<epoch seconds>"
+static bool ParseTime(const char* text, uint64_t dayUSecs, uint64_t& usecs)
+{
+	std::tm ttm = {};
+	int year, month, day, hour, minute, second = 0;
+	if (text[0] == '@')
+	{
+		usecs = static_cast<uint64_t>(strtod(text + 1, nullptr) * 1000000.0);
+		return true;
+	}
+
+	if (sscanf(text, "%d.%d.%d-%d.%d.%d", &year, &month, &day, &hour, &minute, &second) == 6)
+	{
+		ttm.tm_year = year - 1900;
+		ttm.tm_mon = month - 1;
+		ttm.tm_mday = day;
+	}
+	else if (sscanf(text, "%d:%d:%d", &hour, &minute, &second) >= 2)
+	{
+		time_t secs = static_cast<time_t>(dayUSecs / 1000000);
+#ifdef _WIN32
+		localtime_s(&ttm, &secs);
+#else
+		localtime_r(&secs, &ttm);
+#endif
+	}
+	else
+	{
+		return false;
+	}
+
+	ttm.tm_hour = hour;
+	ttm.tm_min = minute;
+	ttm.tm_sec = second;
+	ttm.tm_isdst = -1;
+	usecs = static_cast<uint64_t>(mktime(&ttm)) * 1000000;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	Query query;
+	const char* startText = nullptr;
+	const char* endText = nullptr;
+	std::vector<Segment> segments;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+		bool hasValue = arg + 1 < argc;
+		if (option == "-s" && hasValue)
+		{
+			startText = argv[++arg];
+		}
+		else if (option == "-e" && hasValue)
+		{
+			endText = argv[++arg];
+		}
+		else if (option == "-l" && hasValue)
+		{
+			query.maxLevel = ParseLogLevel(argv[arg + 1], strlen(argv[arg + 1]));
+			arg++;
+		}
+		else if (option == "-u" && hasValue)
+		{
+			query.user = argv[++arg];
+		}
+		else if (option == "-w" && hasValue)
+		{
+			query.slackUSecs = strtoull(argv[++arg], nullptr, 10) * 1000;
+		}
+		else if (option[0] == '-')
+		{
+			segments.clear();
+			break;
+		}
+		else
+		{
+			Segment segment;
+			segment.path = option;
+			segment.indexed = ReadLogIndex(option + LOG_INDEX_EXTENSION, segment.header, segment.records);
+			if (segment.indexed && segment.header.format != static_cast<uint32_t>(LOG_INDEX_FORMAT::LOG_INDEX_TEXT))
+			{
+				fprintf(stderr, "%s: unsupported index format %u\n", option.c_str(), segment.header.format);
+				return 1;
+			}
+			segments.push_back(segment);
+		}
+	}
+
+	if (segments.empty() || query.maxLevel <= 0)
+	{
+		fprintf(stderr, "usage: %s [-s start] [-e end] [-l ERROR|WARN|INFO|DEBUG] [-u user] [-w max queue msec] <log file>...\n", argv[0]);
+		fprintf(stderr, "  times are YYYY.MM.DD-HH.MM.SS, HH:MM[:SS] on the day of the first file, or @<epoch seconds>\n");
+		fprintf(stderr, "  -w bounds how long a line may wait to be written (default 1000), only for files without timestamps\n");
+		return 1;
+	}
+
+	// Rotated segments go in time order, unindexed files last
+	std::stable_sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b)
+	{
+		if (a.indexed != b.indexed)
+		{
+			return a.indexed;
+		}
+		return a.indexed && a.header.wallBaseUSecs < b.header.wallBaseUSecs;
+	});
+
+	uint64_t day = segments[0].indexed ? segments[0].header.wallBaseUSecs : 0;
+	if ((startText != nullptr && !ParseTime(startText, day, query.start)) ||
+		(endText != nullptr && !ParseTime(endText, day, query.end)))
+	{
+		fprintf(stderr, "Unrecognized time\n");
+		return 1;
+	}
+
+	uint64_t bytesRead = 0;
+	uint64_t bytesTotal = 0;
+	size_t printed = 0;
+	for (const Segment& segment : segments)
+	{
+		if (!segment.indexed && (startText != nullptr || endText != nullptr))
+		{
+			fprintf(stderr, "%s has no index, filtering by level and user only\n", segment.path.c_str());
+		}
+
+		std::ifstream sizer(segment.path, std::ios::binary | std::ios::ate);
+		bytesTotal += sizer.is_open() ? static_cast<uint64_t>(sizer.tellg()) : 0;
+		ScanSegment(segment, query, bytesRead, printed);
+	}
+
+	fprintf(stderr, "%zu lines, read %llu of %llu bytes\n", printed,
+		static_cast<unsigned long long>(bytesRead), static_cast<unsigned long long>(bytesTotal));
+	return 0;
+}